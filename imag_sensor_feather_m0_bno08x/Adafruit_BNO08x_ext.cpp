@@ -64,3 +64,62 @@ bool Adafruit_BNO08x_ext::getSensorsPerformingDynamicCalibration (uint8_t& senso
 {
     return sh2_getCalConfig (&sensors) == SH2_OK;
 }
+
+
+bool Adafruit_BNO08x_ext::readUserRecord (uint32_t* data, uint16_t& words)
+{
+    return sh2_getFrs (USER_RECORD, data, &words) == SH2_OK;
+}
+
+
+bool Adafruit_BNO08x_ext::writeUserRecord (uint32_t* data, uint16_t words)
+{
+    return sh2_setFrs (USER_RECORD, data, words) == SH2_OK;
+}
+
+
+bool Adafruit_BNO08x_ext::attachSensorHandler()
+{
+    return sh2_setSensorCallback (sensorHandler, this) == SH2_OK;
+}
+
+
+bool Adafruit_BNO08x_ext::getSensorEvent (sh2_SensorValue_t* value)
+{
+    pendingValue = value;
+    eventReceived = false;
+
+    sh2_service();
+
+    pendingValue = nullptr;
+
+    return eventReceived;
+}
+
+
+void Adafruit_BNO08x_ext::sensorHandler (void* cookie, sh2_SensorEvent_t* event)
+{
+    auto* self = static_cast<Adafruit_BNO08x_ext*> (cookie);
+
+    // events outside of getSensorEvent() are dropped
+    if (self->pendingValue == nullptr)
+        return;
+
+    self->lastEvent = *event;
+
+    if (self->decodeFloats)
+    {
+        self->eventReceived = sh2_decodeSensorEvent (self->pendingValue, event) == SH2_OK;
+        return;
+    }
+
+    // header only, same as sh2_decodeSensorEvent()
+    auto* value = self->pendingValue;
+    value->timestamp = event->timestamp_uS;
+    value->sensorId = event->reportId;
+    value->sequence = event->report[1];
+    value->status = event->report[2] & 0x03;
+    value->delay = ((event->report[2] & 0xfc) << 6) + event->report[3];
+
+    self->eventReceived = true;
+}
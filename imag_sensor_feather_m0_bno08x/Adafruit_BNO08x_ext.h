@@ -33,4 +33,37 @@ public:
 
     bool getSensorsPerformingDynamicCalibration (uint8_t& sensors);
 
+    bool readUserRecord (uint32_t* data, uint16_t& words);
+
+    bool writeUserRecord (uint32_t* data, uint16_t words);
+
+    // replace sh-2 sensor callback installed by begin_*() to keep raw reports
+    bool attachSensorHandler();
+
+    // query sensor event, hides Adafruit_BNO08x::getSensorEvent()
+    /* with float decoding disabled only id, sequence, status, delay and
+       timestamp of value are set, data is left to getLastEvent()
+    */
+    bool getSensorEvent (sh2_SensorValue_t* value);
+
+    // enable/disable float decoding of sensor events, enabled by default
+    void setDecodeFloats (bool decode) { decodeFloats = decode; }
+
+    // raw sh-2 report of last sensor event
+    const sh2_SensorEvent_t& getLastEvent() const { return lastEvent; }
+
+    // signed 16-bit little endian report field at byte offset
+    int16_t getLastEventValue (size_t offset) const
+    {
+        return int16_t (lastEvent.report[offset] | lastEvent.report[offset + 1] << 8);
+    }
+
+private:
+    static void sensorHandler (void* cookie, sh2_SensorEvent_t* event);
+
+    sh2_SensorEvent_t lastEvent;
+    sh2_SensorValue_t* pendingValue = nullptr;
+    bool eventReceived = false;
+    bool decodeFloats = true;
+
 }; // class Adafruit_BNO08x_ext
@@ -23,6 +23,10 @@
 #define DBGHEX    ;
 #endif // #if ! IMAG_BATTERY_DEBUG
 
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::battery
+
 namespace imag
 {
 
@@ -30,7 +34,12 @@ Battery::Battery (uint8_t batPin, bool shouldPullup)
     : pin (batPin),
       pullup (shouldPullup),
       voltage (0.0f),
-      readTime (0)
+      voltageMean (stats::ExpMean<float>::fromLength (6)),
+      readTime (0),
+      trendTime (0),
+      trendPercentage (-1.0f),
+      dischargeRate (stats::ExpMean<float>::fromLength (3)),
+      low (false)
 {}
 
 
@@ -44,34 +53,127 @@ void Battery::update()
     readTime = now + readInterval;
 
     readNow();
+    updateTrend (now);
 }
 
 
 void Battery::readNow()
 {
     pinMode (pin, INPUT); // disable potential pullup
-    voltage = analogRead (pin);
+    const auto raw = readAdc();
 
     if (pullup)
         pinMode (pin, INPUT_PULLUP); // re-enable pullup if requested
 
-    // we assume a 0.5 voltage divider, 3.3V reference and 10bit measurement
-    static constexpr auto multiplier = 2.0f * 3.3f / 1024.0f;
+    // we assume a 0.5 voltage divider, 3.3V reference and 14bit averaged measurement
+    static constexpr auto multiplier = 2.0f * 3.3f / 16384.0f;
 
-    voltage *= multiplier;
+    voltageMean.add (raw * multiplier);
+    voltage = voltageMean.get();
 
-    DBG("Battery: read voltage "); DBGNLN(voltage);
+    DBG("Battery: read voltage "); DBGN(raw * multiplier); DBG(", smoothed "); DBGNLN(voltage);
 }
 
 
 uint8_t Battery::getPercentage() const
 {
-    // using an approximation from
-    // https://stackoverflow.com/questions/56266857/how-do-i-convert-battery-voltage-into-battery-percentage-on-a-4-15v-li-ion-batte
-    if (voltage > 4.0f)
-        return map (constrain (voltage, 4.0f, 4.2f), 4.0f, 4.2f, 80, 99);
+    return uint8_t (getExactPercentage() + 0.5f);
+}
+
+
+float Battery::getExactPercentage() const
+{
+    const auto millivolts = voltage * 1000.0f;
+
+    if (millivolts <= dischargeCurve.front().millivolts)
+        return dischargeCurve.front().percentage;
+
+    for (size_t i = 1; i < dischargeCurve.size(); ++i)
+    {
+        const auto& upper = dischargeCurve[i];
+
+        if (millivolts >= upper.millivolts)
+            continue;
+
+        const auto& lower = dischargeCurve[i - 1];
+
+        return lower.percentage + (millivolts - lower.millivolts) * (upper.percentage - lower.percentage)
+                                  / float (upper.millivolts - lower.millivolts);
+    }
+
+    return dischargeCurve.back().percentage;
+}
+
+
+int32_t Battery::getMinutesToEmpty() const
+{
+    // need at least one trend, below 0.01 %/min treat as not discharging (> 160 h)
+    if (dischargeRate.getCount() == 0 || dischargeRate.get() < 0.01f)
+        return -1;
+
+    return int32_t (getPercentage() / dischargeRate.get());
+}
+
+
+uint16_t Battery::readAdc()
+{
+#ifdef ARDUINO_ARCH_SAMD
+    // hardware averaging of 16 12-bit conversions, adjusted to 14 bit
+    // analogRead() does not touch these settings, so mapResolution (12 -> 12) passes the result
+    analogReadResolution (12);
+
+    ADC->CTRLB.bit.RESSEL = ADC_CTRLB_RESSEL_16BIT_Val;
+    while (ADC->STATUS.bit.SYNCBUSY);
+
+    ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_16 | ADC_AVGCTRL_ADJRES (2);
+    while (ADC->STATUS.bit.SYNCBUSY);
+
+    return analogRead (pin);
+#else
+    // software averaging of 10-bit conversions
+    uint32_t sum = 0;
+
+    for (auto i = 0; i < oversampling; ++i)
+        sum += analogRead (pin);
+
+    return sum;
+#endif
+}
+
+
+void Battery::updateTrend (uint32_t now)
+{
+    const auto percentage = getExactPercentage();
+
+    // low state with 5 % hysteresis
+    if (percentage <= config::Battery::lowPercentage)
+        low = true;
+    else if (percentage >= config::Battery::lowPercentage + 5)
+        low = false;
+
+    if (trendPercentage < 0.0f)
+    {
+        trendTime = now;
+        trendPercentage = percentage;
+        return;
+    }
+
+    if (now - trendTime < trendInterval)
+        return;
+
+    const auto minutes = (now - trendTime) / 60000.0f;
+    const auto rate = (trendPercentage - percentage) / minutes;
+
+    trendTime = now;
+    trendPercentage = percentage;
+
+    // charging resets the estimate
+    if (rate < 0.0f)
+        dischargeRate.reset();
     else
-        return map (constrain (voltage, 3.6f, 4.0f), 3.6f, 4.0f, 1, 80);
+        dischargeRate.add (rate);
+
+    DBG("Battery: discharge rate %/min "); DBGN(rate); DBG(", minutes to empty "); DBGNLN(getMinutesToEmpty());
 }
 
 } // namespace imag
@@ -9,6 +9,9 @@
 #pragma once
 
 #include "imag_config.h"
+#include "imag_stats.h"
+
+#include <array>
 
 namespace imag
 {
@@ -19,6 +22,12 @@ public:
     // battery measurement refresh rate
     static constexpr auto readInterval = 10000UL;
 
+    // time between discharge trend points [ms]
+    static constexpr auto trendInterval = 300000UL;
+
+    // samples averaged per reading (hardware averaging on samd21)
+    static constexpr auto oversampling = 16;
+
     // constructor
     // if shoudPullup is set to true, batPin will be set back to INPUT_PULLUP after each analogRead()
     // this is handy if batPin is used, e.g., as a button pin at the same time
@@ -30,24 +39,64 @@ public:
     // measure the voltage right now, query with getVoltage()
     void readNow();
 
-    // return last measured voltage
+    // return smoothed measured voltage
     float getVoltage() const { return voltage; }
 
-    // return an estimate of the capacity left
+    // return an estimate of the capacity left from lipo discharge curve
     uint8_t getPercentage() const;
 
+    // return an estimate of the runtime left from the discharge trend [min]
+    // negative while unknown, e.g. after startup or when charging
+    int32_t getMinutesToEmpty() const;
+
+    // low battery state, with hysteresis
+    bool isLow() const { return low; }
+
 private:
+    // voltage to capacity lookup, typical lipo at light load
+    struct CurvePoint
+    {
+        uint16_t millivolts;
+        uint8_t percentage;
+    };
+
+    static constexpr std::array<CurvePoint, 21> dischargeCurve {{
+        { 3270,   0 }, { 3610,   5 }, { 3690,  10 }, { 3710,  15 }, { 3730,  20 },
+        { 3750,  25 }, { 3770,  30 }, { 3790,  35 }, { 3800,  40 }, { 3820,  45 },
+        { 3840,  50 }, { 3850,  55 }, { 3870,  60 }, { 3910,  65 }, { 3950,  70 },
+        { 3980,  75 }, { 4020,  80 }, { 4080,  85 }, { 4110,  90 }, { 4150,  95 },
+        { 4200, 100 }
+    }};
+
+    // interpolated capacity for sub-percent trend resolution
+    float getExactPercentage() const;
+
+    // averaged adc reading, 14 bit
+    uint16_t readAdc();
+
+    // update discharge trend and low state from current voltage
+    void updateTrend (uint32_t now);
+
     // measurement pin
     uint8_t pin;
 
     // concurrent read flag
     bool pullup;
 
-    // last measured result
+    // smoothed measured voltage
     float voltage;
+    stats::ExpMean<float> voltageMean;
 
     // measurement time
     uint32_t readTime;
+
+    // discharge trend: last trend point and smoothed rate [%/min]
+    uint32_t trendTime;
+    float trendPercentage;
+    stats::ExpMean<float> dischargeRate;
+
+    // low battery flag
+    bool low;
 };
 
 } // namespace imag
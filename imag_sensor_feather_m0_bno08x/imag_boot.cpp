@@ -0,0 +1,38 @@
+/* imag_boot.cpp
+ * 
+ * imagination sensor firmware
+ * boot phase timing
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_boot.h"
+#include "imag_debug.h"
+
+namespace imag
+{
+
+Boot boot;
+
+
+void Boot::stamp (Phase phase)
+{
+    const auto index = static_cast<size_t> (phase);
+
+    times[index] = micros();
+    reached |= 1u << index;
+
+    DBG("Boot: "); DBGN(getName (phase)); DBG(" at ms "); DBGNLN(times[index] / 1000.0f);
+}
+
+
+const char* Boot::getName (Phase phase)
+{
+    static constexpr std::array<const char*, phaseNum> names {
+        "setup", "display", "imu", "ready", "first sample", "first midi", "wifi", "connected", "first osc"
+    };
+
+    return names[static_cast<size_t> (phase)];
+}
+
+} // namespace imag
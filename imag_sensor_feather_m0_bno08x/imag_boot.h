@@ -0,0 +1,88 @@
+/* imag_boot.h
+ * 
+ * imagination sensor firmware
+ * boot phase timing
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+
+namespace imag
+{
+/* Time of each boot phase, stamped with micros() when first reached, so
+   times count from the start of the sketch (bootloader not included).
+   Later marks of a phase are ignored, which keeps marking on the
+   per-sample path cheap.
+
+   osc reply to /boot, one message per reached phase:
+     /boot s:phase i:time [us]
+*/
+class Boot
+{
+public:
+    enum class Phase : uint8_t
+    {
+        setup,       // setup() entered
+        display,     // splash shown
+        imu,         // sensor initialised and configured
+        ready,       // setup() done, main loop runs
+        firstSample, // first sensor sample read
+        firstMidi,   // first rotation sent via usb midi
+        wifi,        // access point started
+        connected,   // client connected, osc ready to send
+        firstOsc,    // first rotation sent via osc
+        totalNum
+    };
+
+    // stamp phase if not reached yet
+    void mark (Phase phase)
+    {
+        if (! isReached (phase))
+            stamp (phase);
+    }
+
+    bool isReached (Phase phase) const { return reached & (1u << static_cast<uint8_t> (phase)); }
+
+    // [us], 0 if not reached
+    uint32_t getTime (Phase phase) const { return times[static_cast<size_t> (phase)]; }
+
+    static const char* getName (Phase phase);
+
+    // send one /boot message per reached phase via osc sender, e.g. WINC150x
+    template <typename Sender>
+    bool sendTimes (Sender& sender, const char* oscAddress) const
+    {
+        auto res = true;
+
+        for (size_t i = 0; i < phaseNum; ++i)
+        {
+            if (! isReached (Phase (i)))
+                continue;
+
+            auto& msg = sender.beginMessage (oscAddress);
+            res &= msg.addString (getName (Phase (i)));
+            res &= msg.addInt (int32_t (times[i]));
+            res &= sender.sendMessage();
+        }
+
+        return res;
+    }
+
+private:
+    static constexpr auto phaseNum = static_cast<size_t> (Phase::totalNum);
+
+    void stamp (Phase phase);
+
+    std::array<uint32_t, phaseNum> times {};
+    uint16_t reached = 0;
+};
+
+// boot timing of this run
+extern Boot boot;
+
+} // namespace imag
@@ -0,0 +1,176 @@
+/* imag_capture.cpp
+ * 
+ * imagination sensor firmware
+ * binary capture of raw sensor reports
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_capture.h"
+
+namespace imag
+{
+
+namespace
+{
+// append value to payload buffer, little endian on samd
+template <typename T>
+uint8_t* put (uint8_t* dest, const T& value)
+{
+    memcpy (dest, &value, sizeof (T));
+    return dest + sizeof (T);
+}
+
+bool isRotationReport (uint8_t sensorId)
+{
+    return sensorId == SH2_ROTATION_VECTOR ||
+        sensorId == SH2_GAME_ROTATION_VECTOR ||
+        sensorId == SH2_GEOMAGNETIC_ROTATION_VECTOR ||
+        sensorId == SH2_ARVR_STABILIZED_RV ||
+        sensorId == SH2_ARVR_STABILIZED_GRV;
+}
+
+bool isVectorReport (uint8_t sensorId)
+{
+    return sensorId == SH2_ACCELEROMETER ||
+        sensorId == SH2_GYROSCOPE_CALIBRATED ||
+        sensorId == SH2_MAGNETIC_FIELD_CALIBRATED ||
+        sensorId == SH2_LINEAR_ACCELERATION ||
+        sensorId == SH2_GRAVITY;
+}
+} // namespace
+
+
+Capture::Capture (Print& newOut)
+    : out (newOut),
+      enabled (false),
+      hostConnected (false),
+      startPending (false),
+      loopReports (0),
+      dropped (0)
+{}
+
+
+void Capture::setEnabled (bool shouldCapture)
+{
+    if (shouldCapture && ! enabled)
+        startPending = true;
+
+    enabled = shouldCapture;
+}
+
+
+void Capture::setHostConnected (bool connected)
+{
+    // port opened, e.g. by tools/imag_capture.py record: begin a new capture
+    if (connected && ! hostConnected)
+        startPending = true;
+
+    hostConnected = connected;
+}
+
+
+bool Capture::writeStart()
+{
+    if (! startPending)
+        return true;
+
+    if (! hostConnected)
+        return false;
+
+    static constexpr uint8_t start[] { 'I', 'M', 'A', 'G', 'C', 'A', 'P', version };
+
+    if (! writeFrame (Kind::start, start, sizeof (start)))
+        return false;
+
+    startPending = false;
+    dropped = 0;
+    loopReports = 0;
+
+    return true;
+}
+
+
+void Capture::addReport (const sh2_SensorValue_t& value)
+{
+    if (! enabled || ! writeStart())
+        return;
+
+    uint8_t payload[32];
+    auto* p = payload;
+
+    *p++ = value.sensorId;
+    *p++ = value.sequence;
+    *p++ = value.status;
+    *p++ = 0;
+    p = put (p, uint32_t (value.timestamp));
+    p = put (p, uint32_t (micros()));
+
+    if (isRotationReport (value.sensorId))
+    {
+        const auto& rv = value.un.rotationVector;
+
+        for (auto v : { rv.i, rv.j, rv.k, rv.real, rv.accuracy })
+            p = put (p, v);
+    }
+    else if (isVectorReport (value.sensorId))
+    {
+        // all calibrated vector reports share the same layout
+        const auto& v = value.un.accelerometer;
+
+        for (auto c : { v.x, v.y, v.z })
+            p = put (p, c);
+    }
+    else
+    {
+        memcpy (p, &value.un, 16);
+        p += 16;
+    }
+
+    if (writeFrame (Kind::report, payload, p - payload))
+        ++loopReports;
+}
+
+
+void Capture::addLoop (uint32_t start, uint32_t duration)
+{
+    if (! enabled || ! writeStart())
+        return;
+
+    uint8_t payload[12];
+    auto* p = payload;
+
+    p = put (p, start);
+    p = put (p, duration);
+    p = put (p, loopReports);
+    p = put (p, uint16_t (std::min<uint32_t> (dropped, UINT16_MAX)));
+
+    loopReports = 0;
+
+    writeFrame (Kind::loop, payload, p - payload);
+}
+
+
+bool Capture::writeFrame (Kind kind, const uint8_t* payload, uint8_t length)
+{
+    // never block if buffer is full
+    if (out.availableForWrite() < length + 4)
+    {
+        ++dropped;
+        return false;
+    }
+
+    uint8_t header[3] { sync, static_cast<uint8_t> (kind), length };
+    uint8_t checksum = header[1] + header[2];
+
+    for (uint8_t i = 0; i < length; ++i)
+        checksum += payload[i];
+
+    out.write (header, sizeof (header));
+    out.write (payload, length);
+    out.write (checksum);
+
+    return true;
+}
+
+} // namespace imag
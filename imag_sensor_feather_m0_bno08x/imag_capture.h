@@ -0,0 +1,93 @@
+/* imag_capture.h
+ * 
+ * imagination sensor firmware
+ * binary capture of raw sensor reports
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Adafruit_BNO08x.h>
+
+#include "imag_config.h"
+
+namespace imag
+{
+/* Binary capture stream, decoded by tools/imag_capture.py
+
+   frame:   0xa5, kind, length, payload[length], checksum
+            checksum is the 8-bit sum of kind, length and payload
+   kinds:   start  : "IMAGCAP", version u8
+            report : sensorId u8, sequence u8, status u8, reserved u8,
+                     sensor timestamp u32 [us], host timestamp u32 [us],
+                     rotation vectors: i, j, k, real, accuracy (float)
+                     vector reports:   x, y, z (float)
+                     other reports:    first 16 bytes of sh2 value union
+            loop   : start u32 [us], duration u32 [us], reports u16, dropped u16
+
+   all values little endian. Frames are only written if they fit into
+   the output buffer, otherwise they are dropped and counted, so the
+   capture never blocks the regular output path.
+
+   Nothing is written until a host has opened the port (DTR), so the
+   start frame is not lost before. Each time the port is opened again, a
+   new capture begins with a start frame.
+*/
+class Capture
+{
+public:
+    static constexpr uint8_t sync = 0xa5;
+    static constexpr uint8_t version = 1;
+
+    enum class Kind : uint8_t
+    {
+        start  = 0x01,
+        report = 0x02,
+        loop   = 0x03
+    };
+
+    // constructor
+    Capture (Print& out);
+
+    // start or stop capturing, a start frame is sent first once a host is connected
+    void setEnabled (bool shouldCapture);
+    bool isEnabled() const { return enabled; }
+
+    // host port state, e.g. Serial.dtr(), call once per loop cycle
+    void setHostConnected (bool connected);
+
+    // add a sensor report as received from the sensor hub
+    void addReport (const sh2_SensorValue_t& value);
+
+    // add loop timing, call once per loop cycle
+    void addLoop (uint32_t start, uint32_t duration);
+
+    // frames dropped since the last start frame
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    // write frame if it fits into output buffer
+    bool writeFrame (Kind kind, const uint8_t* payload, uint8_t length);
+
+    // true once the start frame of this capture is written
+    bool writeStart();
+
+    // output stream
+    Print& out;
+
+    // capture flag
+    bool enabled;
+
+    // host connected, start frame still to be written
+    bool hostConnected;
+    bool startPending;
+
+    // reports written in current loop cycle
+    uint16_t loopReports;
+
+    // dropped frames counter
+    uint32_t dropped;
+};
+
+} // namespace imag
@@ -0,0 +1,139 @@
+/* imag_clock_sync.cpp
+ * 
+ * imagination sensor firmware
+ * host clock synchronisation
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_clock_sync.h"
+#include "imag_debug.h"
+#include "imag_log.h"
+
+#include <algorithm>
+
+// redefine DBG output macros for this module only
+#if ! IMAG_NET_DEBUG
+#undef DBG
+#define DBG       ;
+#undef DBGLN
+#define DBGLN     ;
+#undef DBGN
+#define DBGN      ;
+#undef DBGNLN
+#define DBGNLN    ;
+#undef DBGHEX
+#define DBGHEX    ;
+#endif // #if ! IMAG_NET_DEBUG
+
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::net
+
+namespace imag
+{
+
+ClockSync clockSync;
+
+namespace
+{
+// plausible drift of the crystals involved [ppb]
+constexpr int64_t maxDrift = 500000;
+
+// span of estimates the drift is measured over [us]
+constexpr int64_t minDriftSpan = 10000000;  // 10 s
+constexpr int64_t maxDriftSpan = 600000000; // 10 min
+} // namespace
+
+
+uint64_t ClockSync::getLocalTime()
+{
+    const auto now = micros();
+
+    if (now < lastMicros)
+        wraps += uint64_t (1) << 32;
+
+    lastMicros = now;
+
+    return wraps + now;
+}
+
+
+void ClockSync::addExchange (uint64_t hostReceive)
+{
+    const auto t1 = int64_t (fromTimetag (pending.hostSend));
+    const auto t2 = int64_t (pending.localReceive);
+    const auto t3 = int64_t (pending.localSend);
+    const auto t4 = int64_t (hostReceive);
+
+    // round trip without the time spent on the sensor, negative if the host clock stepped
+    const auto exchangeRoundTrip = (t4 - t1) - (t3 - t2);
+
+    if (exchangeRoundTrip < 0 || exchangeRoundTrip >= UINT32_MAX)
+        return;
+
+    if (exchangeRoundTrip < windowRoundTrip)
+    {
+        windowRoundTrip = uint32_t (exchangeRoundTrip);
+        windowOffset = ((t2 - t1) + (t3 - t4)) / 2;
+        windowTime = uint64_t ((t2 + t3) / 2);
+    }
+
+    if (++windowCount < config::Sync::window)
+        return;
+
+    // drift from offset change since the anchor estimate, the longer the span the less noisy
+    const auto span = int64_t (windowTime - anchorTime);
+
+    if (! valid)
+    {
+        anchorOffset = windowOffset;
+        anchorTime = windowTime;
+    }
+    else if (span >= minDriftSpan)
+    {
+        drift = int32_t (std::clamp ((windowOffset - anchorOffset) * 1000000000 / span, -maxDrift, maxDrift));
+
+        // follow slow drift changes, e.g. by temperature
+        if (span >= maxDriftSpan)
+        {
+            anchorOffset = windowOffset;
+            anchorTime = windowTime;
+        }
+    }
+
+    offset = windowOffset;
+    reference = windowTime;
+    roundTrip = windowRoundTrip;
+    estimateTime = millis();
+    valid = true;
+    ++estimates;
+
+    windowCount = 0;
+    windowRoundTrip = UINT32_MAX;
+}
+
+
+uint64_t ClockSync::toHostTime (uint64_t localTime) const
+{
+    const auto elapsed = int64_t (localTime - reference);
+    const auto hostTime = int64_t (localTime) - (offset + elapsed * drift / 1000000000);
+
+    return toTimetag (uint64_t (hostTime));
+}
+
+
+void ClockSync::printStats()
+{
+    if (! isSynchronised())
+    {
+        DBGLN("ClockSync: not synchronised");
+        return;
+    }
+
+    DBG("ClockSync: estimates "); DBGN(estimates);
+    DBG(", round trip us "); DBGN(roundTrip);
+    DBG(", drift ppb "); DBGNLN(drift);
+}
+
+} // namespace imag
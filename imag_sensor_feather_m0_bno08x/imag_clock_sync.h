@@ -0,0 +1,129 @@
+/* imag_clock_sync.h
+ * 
+ * imagination sensor firmware
+ * host clock synchronisation
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "imag_config.h"
+
+namespace imag
+{
+/* NTP style estimate of offset and drift of the sensor clock (micros(),
+   extended to 64 bit) against a host clock, so samples can be stamped
+   with host time. The host pings, the sensor replies with its receive
+   and send time:
+
+     host:   /sync t:t1 [t:t1 t:t4 of the previous exchange]
+     sensor: /sync t:t1 t:t2 t:t3 [t:t3 as host time, while synchronised]
+
+   t1 and t4 are host timetags, t2 and t3 sensor times as timetags since
+   boot. The host passes the receive time t4 of the previous reply along
+   with the next ping, so the sensor has all four times of an exchange:
+   offset ((t2 - t1) + (t3 - t4)) / 2 and round trip (t4 - t1) - (t3 - t2).
+   Of each window of exchanges, the one with the shortest round trip is
+   taken as estimate, the drift follows from the offset change over at
+   least 10 s. The exchange should be repeated about every 100 ms.
+*/
+class ClockSync
+{
+public:
+    // local time [us], micros() extended to 64 bit, needs calling at least every 71 minutes
+    uint64_t getLocalTime();
+
+    // handle /sync ping received at local time via osc sender, e.g. WINC150x
+    template <typename Sender, typename Message>
+    bool handlePing (const Message& msg, uint64_t receiveTime, Sender& sender, const char* oscAddress)
+    {
+        if (msg.getArgCount() < 1 || ! msg.isTime (0))
+            return false;
+
+        // completed previous exchange
+        if (msg.getArgCount() >= 3 && msg.isTime (1) && msg.isTime (2) && msg.getTime (1) == pending.hostSend)
+            addExchange (fromTimetag (msg.getTime (2)));
+
+        auto& reply = sender.beginMessage (oscAddress);
+        auto res = reply.addTime (msg.getTime (0));
+        res &= reply.addTime (toTimetag (receiveTime));
+
+        // stamped as late as possible
+        const auto sendTime = getLocalTime();
+        res &= reply.addTime (toTimetag (sendTime));
+
+        if (isSynchronised())
+            res &= reply.addTime (toHostTime (sendTime));
+
+        pending = { msg.getTime (0), receiveTime, sendTime };
+
+        return res && sender.sendMessage();
+    }
+
+    // estimate valid, i.e. renewed within config::Sync::timeout
+    bool isSynchronised() const { return valid && millis() - estimateTime < config::Sync::timeout; }
+
+    // host time of local time as osc timetag, only meaningful while synchronised
+    uint64_t toHostTime (uint64_t localTime) const;
+
+    // current estimate: sensor minus host [us], drift [ppb], round trip of the estimate [us]
+    int64_t getOffset() const { return offset; }
+    int32_t getDrift() const { return drift; }
+    uint32_t getRoundTrip() const { return roundTrip; }
+
+    void printStats();
+
+    // timetag (ntp format, 32.32 seconds) conversions of [us]
+    static uint64_t toTimetag (uint64_t us)
+    {
+        return ((us / 1000000) << 32) | (((us % 1000000) << 32) / 1000000);
+    }
+
+    static uint64_t fromTimetag (uint64_t timetag)
+    {
+        return (timetag >> 32) * 1000000 + (((timetag & 0xffffffff) * 1000000) >> 32);
+    }
+
+private:
+    // all four times known, add to window
+    void addExchange (uint64_t hostReceive);
+
+    // last ping answered: host send timetag, local receive and send [us]
+    struct Exchange
+    {
+        uint64_t hostSend = 0;
+        uint64_t localReceive = 0;
+        uint64_t localSend = 0;
+    } pending;
+
+    // micros() extension
+    uint32_t lastMicros = 0;
+    uint64_t wraps = 0;
+
+    // best exchange of the current window
+    uint8_t windowCount = 0;
+    int64_t windowOffset = 0;
+    uint64_t windowTime = 0;
+    uint32_t windowRoundTrip = UINT32_MAX;
+
+    // estimate the drift is measured against
+    int64_t anchorOffset = 0;
+    uint64_t anchorTime = 0;
+
+    // estimate, valid from local time reference on
+    bool valid = false;
+    int64_t offset = 0;
+    uint64_t reference = 0;
+    int32_t drift = 0;
+    uint32_t roundTrip = 0;
+    uint32_t estimates = 0;
+    uint32_t estimateTime = 0; // millis()
+};
+
+// host clock of this run
+extern ClockSync clockSync;
+
+} // namespace imag
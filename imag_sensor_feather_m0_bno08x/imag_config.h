@@ -17,6 +17,15 @@
 #define IMAG_NET_DEBUG 0 // Wifi low-level debug
 #define IMAG_DISPLAY_DEBUG 0 // display low-level debug
 #define IMAG_BATTERY_DEBUG 0 // battery low-level debug
+#define IMAG_MIDI_DEBUG 0 // usb midi low-level debug
+#define IMAG_POWER_DEBUG 0 // sleep/duty cycle low-level debug
+
+// stream raw sensor reports as binary capture via usb serial?
+// (uses the serial port exclusively, so not together with IMAG_DEBUG)
+#define IMAG_CAPTURE   0
+
+// measure per-stage loop timing, queried via osc /stats
+#define IMAG_PROFILE   0
 
 namespace imag::config
 {
@@ -34,12 +43,42 @@ static constexpr auto versionMajor = 0;
 static constexpr auto versionMinor = 5;
 static constexpr auto versionSub   = 3;
 
-// seconds to wait at bootup for serial debug console
-static constexpr auto serialTimeout = 5;
-  
+// startup sequence
+/* Nothing waits for fixed delays or the serial console, usb midi streams
+   as soon as the sensor is up. The access point is started afterwards,
+   its bring-up blocks the loop once.
+*/
+struct Boot
+{
+    // the display is polled until it responds, at most [ms]
+    static constexpr uint32_t displayTimeout = 250;
+
+    // start access point after first sensor sample, or at the latest after [ms]
+    static constexpr uint32_t wifiStartTimeout = 1000;
+};
+
 // serial baudrate
 static constexpr auto serialBaudrate = 115200;
 
+// deferred debug log, IMAG_DEBUG only
+struct Log
+{
+    // record severity
+    enum class Level : uint8_t { error, warning, info, debug };
+
+    // records above this level are discarded, settable at runtime
+    static constexpr auto level = Level::debug;
+
+    // ring buffer size in bytes, power of two
+    static constexpr size_t bufferSize = 2048;
+
+    // max bytes written to serial per loop cycle
+    static constexpr size_t drainBudget = 256;
+
+    // send binary records for tools/imag_log.py instead of text
+    static constexpr auto binary = false;
+};
+
 // display configuration
 struct Display
 {
@@ -54,6 +93,28 @@ struct Net
 
     static constexpr std::array<byte, 4> remoteIP { 192, 168, 1, 100 }; // target ip address
     static constexpr auto remotePort = 9336; // target port
+
+    // wifi power profile at startup, cycled at runtime by long press on button A
+    /* lowLatency: radio always on, every rotation sent
+       balanced: automatic power save (previous default), every rotation sent
+       longestBattery: deep automatic power save, rotations sent in pairs as one osc bundle
+       (the low battery policy, see Battery, forces longestBattery while active)
+    */
+    enum class PowerProfile : uint8_t { lowLatency, balanced, longestBattery, totalNum };
+    static constexpr auto powerProfile = PowerProfile::balanced;
+};
+
+// host clock synchronisation via osc /sync exchanges (see imag_clock_sync.h)
+struct Sync
+{
+    // exchanges per offset estimate, the one with the shortest round trip is taken
+    static constexpr uint8_t window = 8;
+
+    // estimate is dropped if not renewed within [ms]
+    static constexpr uint32_t timeout = 30000;
+
+    // append the sample time as host timetag to /rot while synchronised
+    static constexpr auto rotationTimetag = true;
 };
 
 // wifi configuration
@@ -64,14 +125,114 @@ struct WiFi
     static constexpr uint8_t channel = sensorIndex;
 };
 
+// imu backend configuration
+struct Imu
+{
+    // bno08x: sensor hardware, synthetic: generated motion, replay: recorded trace
+    enum class Backend { bno08x, synthetic, replay };
+    static constexpr auto backend = Backend::bno08x;
+
+    // synthetic motion profile
+    enum class Motion { still, yawSweep, nod, wander };
+    static constexpr auto syntheticMotion = Motion::wander;
+    static constexpr uint16_t syntheticRate = 100;      // [Hz]
+    static constexpr float syntheticAmplitude = 1.0f;  // [rad]
+    static constexpr float syntheticFrequency = 0.25f; // [Hz]
+
+    // restart replay at end of trace
+    static constexpr auto replayLoop = true;
+
+    // longest wait for the sensor per loop cycle, keeps buttons, display and wifi going [ms]
+    static constexpr uint32_t loopTimeout = 20;
+
+    // stall watchdog: no sample within stallTimeout [ms] re-enables the reports,
+    // then the sensor is reset every recoveryInterval [ms] until samples are back
+    static constexpr uint32_t stallTimeout = 250;
+    static constexpr uint32_t recoveryInterval = 1000;
+};
+
 // bno08x hardware configuration
 struct BNO08x
 {
+    // sh-2 transport bus
+    /* spi requires the sensor's PS0/PS1 straps set high and shares
+       the bus with the wifi module, i2c shares the bus with the display
+    */
+    enum class Bus { i2c, spi };
+    static constexpr auto bus = Bus::i2c;
+
+    // fuse orientation on the host (fixed-point mahony) from calibrated accel, gyro and mag
+    /* instead of the sensor's own fusion; custom north (sensor tare) and the
+       gyro osc stream are not available in this mode
+    */
+    static constexpr auto softwareFusion = false;
+
     static constexpr uint8_t i2cAddr = 0x4b; // adafruit breakout: 0x4a, slimevr: 0x4b
+    static constexpr uint8_t spiCsPin = 10;
     static constexpr uint8_t intPin = 11;
     static constexpr uint8_t resetPin = 12;
 };
 
+// sensor report streams
+struct Stream
+{
+    // rotation (primary) report rate [Hz]
+    static constexpr uint16_t rotationRate = 100;
+
+    // additional vector report rates sent via osc only [Hz], 0 disables the stream
+    static constexpr uint16_t angularVelocityRate = 0;
+    static constexpr uint16_t linearAccelerationRate = 0;
+    static constexpr uint16_t magneticFieldRate = 0;
+
+    // adaptive rotation rate driven by the sensor's stability classifier (bno08x backend)
+    /* the rate drops to idleRotationRate once the wearer has been still for idleDelay,
+       and is back at rotationRate on motion, or at once on a rotation step above wakeAngle
+    */
+    static constexpr auto adaptiveRate = false;
+    static constexpr uint16_t idleRotationRate = 20; // [Hz]
+    static constexpr uint16_t stabilityRate = 10;    // classifier reports [Hz]
+    static constexpr uint32_t idleDelay = 2000;      // [ms]
+    static constexpr float wakeAngle = 1.0f;         // between two idle samples [deg]
+
+    // alternative rotation formats sent via wifi osc along with the rotation, subscribable at runtime (see README)
+    // euler angles are intrinsic in the given rotation order, e.g. zyx is yaw, pitch, roll
+    enum class EulerOrder : uint8_t { xyz, xzy, yxz, yzx, zxy, zyx };
+    static constexpr auto euler = false;
+    static constexpr auto eulerOrder = EulerOrder::zyx;
+    static constexpr auto matrix = false;
+};
+
+// usb midi configuration
+struct Midi
+{
+    // cc: 14-bit controllers, mrheadtracker compatible
+    // sysex: whole quaternion in one 21-bit per component message, see README
+    enum class Format { cc, sysex };
+    static constexpr auto format = Format::cc;
+
+    static constexpr uint8_t channel = 0x01; // 0-based
+    static constexpr uint8_t coarseCc = 16;  // first cc of quaternion w, x, y, z msb
+    static constexpr uint8_t fineCc = 48;    // first cc of quaternion w, x, y, z lsb
+    static constexpr uint8_t sysexDeviceId = sensorIndex; // distinguishes sensors in sysex mode
+
+    // resend all controllers after this time even if unchanged [ms], 0 disables
+    static constexpr uint32_t refreshInterval = 1000;
+};
+
+// wired osc/binary output via usb serial (SLIP framed)
+// (uses the serial port exclusively, so not together with IMAG_DEBUG or IMAG_CAPTURE)
+struct UsbSerial
+{
+    static constexpr auto enabled = false;
+
+    // osc: same packets as sent via wifi, binary: compact rotation frames, see imag_osc_usb_serial.h
+    enum class Format { osc, binary };
+    static constexpr auto format = Format::osc;
+
+    // rotation rate [Hz], limited by Stream::rotationRate, 0 sends every sample
+    static constexpr uint16_t rotationRate = 100;
+};
+
 // button configuration
 struct Button
 {
@@ -81,10 +242,30 @@ struct Button
     static constexpr uint32_t debounce = 35;
 };
 
+// power management configuration
+struct Power
+{
+    // idle the cpu while waiting for the sensor instead of polling
+    static constexpr auto sleepWhileWaiting = true;
+
+    // rough mcu supply currents for charge per sample estimates [mA]
+    // (samd21 at 48 MHz, peripherals and other chips not included)
+    static constexpr float activeCurrent = 6.5f;
+    static constexpr float idleCurrent = 3.5f;
+};
+
 // battery measurement configuration
 struct Battery
 {
     static constexpr uint8_t pin = A7; // == D9, so be aware of concurrency w/ button A
+
+    // capacity below which the battery counts as low [%], cleared 5 % above
+    static constexpr uint8_t lowPercentage = 15;
+
+    // trade rotation rate, display use and wifi latency for runtime while low
+    static constexpr auto lowPowerPolicy = false;
+    static constexpr uint16_t lowRotationRate = 50;   // [Hz]
+    static constexpr uint32_t lowDisplayAutoOff = 10000; // [ms]
 };
 
 } // namespace imag::config
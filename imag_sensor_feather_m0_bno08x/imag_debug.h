@@ -11,54 +11,71 @@
 #include <Arduino.h>
 
 #include "imag_config.h"
+#include "imag_log.h"
 
-// debug print to serial
+// source module of log records, redefined per module
+#ifndef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::main
+#endif
+
+// debug print to deferred serial log, see imag_log.h
 #if IMAG_DEBUG
-#define DBG(STR)     Serial.print (F(STR))
-#define DBGLN(STR)   Serial.println (F(STR))
-#define DBGN(VAR)    Serial.print (VAR)
-#define DBGNLN(VAR)  Serial.println (VAR)
-#define DBGHEX(NUM)  Serial.print (NUM, HEX)
+#define DBG(...)     imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::debug, false, ##__VA_ARGS__)
+#define DBGLN(...)   imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::debug, true, ##__VA_ARGS__)
+#define DBGN(VAR)    imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::debug, false, VAR)
+#define DBGNLN(VAR)  imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::debug, true, VAR)
+#define DBGHEX(NUM)  imag::log::logger.putHex (IMAG_LOG_MODULE, imag::log::Level::debug, false, NUM)
+
+// single line messages with level
+#define LOGE(STR)    imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::error, true, STR)
+#define LOGW(STR)    imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::warning, true, STR)
+#define LOGI(STR)    imag::log::logger.put (IMAG_LOG_MODULE, imag::log::Level::info, true, STR)
 #else
 #define DBG          ;
 #define DBGLN        ;
 #define DBGN         ;
 #define DBGNLN       ;
 #define DBGHEX       ;
+
+#define LOGE         ;
+#define LOGW         ;
+#define LOGI         ;
 #endif // IMAG_DEBUG
 
 namespace imag
 {
 struct Debug
 {
-    // wait for serial console and init or timeout
+    // open serial console, does not wait for a terminal
+    /* records are kept in the log buffer until a terminal is attached */
     static bool init()
     {
 #if ! IMAG_DEBUG
         return true;
 #else
-        // wait for serial to become ready
-        for (int i = 0; i < config::serialTimeout * 5; ++i)
-        {
-            if (Serial)
-            {
-                digitalWrite (LED_BUILTIN, LOW);
-                Serial.begin (config::serialBaudrate);
-                return true;
-            }
-            delay (200);
-            digitalWrite (LED_BUILTIN, ! digitalRead (LED_BUILTIN));
-        }
-
-        digitalWrite (LED_BUILTIN, LOW);
+        Serial.begin (config::serialBaudrate);
+        return Serial.dtr();
+#endif // IMAG_DEBUG
+    }
 
-        return false;
+    // write pending log records to serial, non-blocking
+    static void drain()
+    {
+#if IMAG_DEBUG
+        // dtr(), as operator bool() of the usb serial delays
+        if (Serial.dtr())
+            log::logger.drain();
 #endif // IMAG_DEBUG
     }
 
     // halt machine and indicate by led flickering
     static void halt()
     {
+#if IMAG_DEBUG
+        if (Serial.dtr())
+            log::logger.flush();
+#endif // IMAG_DEBUG
+
         while (1)
         {
             digitalWrite (LED_BUILTIN, ! digitalRead (LED_BUILTIN));
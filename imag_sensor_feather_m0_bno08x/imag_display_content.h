@@ -13,6 +13,8 @@
 #include <Arduino_Helpers.h>
 #include <AH/Math/Quaternion.hpp>
 
+#include "imag_fixed_quaternion.h"
+
 namespace imag::display
 {
 // content page selector
@@ -37,7 +39,6 @@ struct Message
     {
         static constexpr auto title = "ImagSens";
         static constexpr auto versionLabel = "version ";
-        static constexpr auto debugSerialWait = "Waiting for serial...";
         static constexpr auto initialising = "Initialising...";
     };
 
@@ -61,6 +62,13 @@ struct Message
         static constexpr auto magneticNorth = "[magn]";
         static constexpr auto customNorth = "[cstm]";
 
+        // wifi power profile indicators
+        static constexpr std::array<const char*, 3> powerProfile {
+            "[lat]", // low latency
+            "[bal]", // balanced
+            "[bat]"  // longest battery
+        };
+
         // connection/sender labels
         static constexpr auto senderOsc = "OSC";
         static constexpr auto senderMidi = "MIDI";
@@ -113,7 +121,9 @@ struct Content
     float reliability = 0.0f;
     float accuracy = 0.0f;
 
-    Quaternion rotation;
+    FixedQuaternion rotation;
+
+    uint8_t powerProfile = 1;
 
     float batteryVoltage = 0.0f;
     uint8_t batteryPercentage = 0;
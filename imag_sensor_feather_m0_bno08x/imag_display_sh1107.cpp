@@ -7,6 +7,7 @@
  */
 
 #include "imag_display_sh1107.h"
+#include "imag_trig.h"
 #include "imag_debug.h"
 
 // redefine DBG output macros for this module only
@@ -23,6 +24,10 @@
 #define DBGHEX    ;
 #endif // #if ! IMAG_DISPLAY_DEBUG
 
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::display
+
 namespace imag::display
 {
 
@@ -30,7 +35,8 @@ SH1107::SH1107 (TwoWire* twi)
     : display (displayHeight, displayWidth, twi),
       page (Page::splash),
       displayOn (true),
-      refreshTime (0)
+      refreshTime (0),
+      autoOffDelay (displayAutoOff)
 {
     resetAutoOff();
 }
@@ -115,11 +121,7 @@ void SH1107::showSplash()
 
     display.println();
 
-#if IMAG_DEBUG
-    display.println (Message::Splash::debugSerialWait);
-#else
     display.println (Message::Splash::initialising);
-#endif
 
     display.println();
 
@@ -145,6 +147,13 @@ void SH1107::showMain()
     // battery
     printBattery();
 
+    { // wifi power profile, next to battery
+        static const auto powerProfile { Message::Main::powerProfile };
+
+        display.setCursor (8 * charWidth + charWidth / 2, displayHeight - 8);
+        display.print (powerProfile[content.powerProfile]);
+    } // wifi power profile
+
     { // sender
         display.setCursor (0 * charWidth, lineSkip);
         display.print (Message::Main::senderOsc);
@@ -203,20 +212,24 @@ void SH1107::showMain()
     { // north direction indicator
         static constexpr uint16_t centreX = 63;
         static constexpr uint16_t centreY = 44;
-        static constexpr auto radius = 13.0f;
-        static constexpr auto opening = 17.0f * PI / 180.0f;
+        static constexpr int32_t radius = 13;
+        static constexpr auto opening = trig::fromDegrees (17.0);
 
-        const auto north = PI - EulerAngles (content.rotation).yaw;
+        // table based, angles wrap around
+        const trig::Angle north = trig::halfTurn - trig::yaw (content.rotation);
         
-        const auto backCorner1 = north + PI + opening;
-        const auto backCorner2 = north + PI - opening;
+        const trig::Angle backCorner1 = north + trig::halfTurn + opening;
+        const trig::Angle backCorner2 = north + trig::halfTurn - opening;
+
+        // Q15 times radius, rounded
+        auto scale = [] (int16_t value) { return int16_t ((value * radius + (1 << (trig::fracBits - 1))) >> trig::fracBits); };
         
-        display.fillTriangle (centreX + round (sin (north) * radius),
-                              centreY + round (cos (north) * radius),
-                              centreX + round (sin (backCorner1) * radius),
-                              centreY + round (cos (backCorner1) * radius),
-                              centreX + round (sin (backCorner2) * radius),
-                              centreY + round (cos (backCorner2) * radius),
+        display.fillTriangle (centreX + scale (trig::sin (north)),
+                              centreY + scale (trig::cos (north)),
+                              centreX + scale (trig::sin (backCorner1)),
+                              centreY + scale (trig::cos (backCorner1)),
+                              centreX + scale (trig::sin (backCorner2)),
+                              centreY + scale (trig::cos (backCorner2)),
                               SH110X_WHITE);
     } // north direction indicator
 
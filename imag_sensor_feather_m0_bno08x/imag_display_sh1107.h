@@ -53,7 +53,10 @@ public:
     Content& getContent() { return content; }
     
     // restart auto-off timeout
-    void resetAutoOff() { autoOffTime = millis() + displayAutoOff; }
+    void resetAutoOff() { autoOffTime = millis() + autoOffDelay; }
+
+    // change auto-off timeout [ms], applied with next restart
+    void setAutoOffDelay (uint32_t delay) { autoOffDelay = delay; }
 
 private:
     // show splash screen
@@ -83,8 +86,9 @@ private:
     // refresh time
     uint32_t refreshTime;
 
-    // auto off time
+    // auto off time and timeout
     uint32_t autoOffTime;
+    uint32_t autoOffDelay;
 };
 
 } // namespace imag::display
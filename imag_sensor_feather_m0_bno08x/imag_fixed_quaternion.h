@@ -0,0 +1,114 @@
+/* imag_fixed_quaternion.h
+ * 
+ * imagination sensor firmware
+ * fixed point quaternion
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Arduino_Helpers.h>
+#include <AH/Math/Quaternion.hpp>
+
+#include <algorithm>
+
+namespace imag
+{
+/* Rotation quaternion in Q30 fixed point for the per-sample path on the
+   FPU-less MCU. Sensor reports (Q14) and software fusion (Q28) convert
+   losslessly by shifting, floats are only produced at the outputs.
+*/
+struct FixedQuaternion
+{
+    static constexpr int fracBits = 30;
+    static constexpr int32_t one = int32_t (1) << fracBits;
+
+    int32_t w = one;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t z = 0;
+
+    // from components with fewer fractional bits, e.g. 14 for sh-2 rotation vectors
+    template <int sourceFracBits>
+    static FixedQuaternion fromFixed (int32_t w, int32_t x, int32_t y, int32_t z)
+    {
+        static_assert (sourceFracBits <= fracBits);
+        static constexpr auto shift = fracBits - sourceFracBits;
+
+        return { w * (int32_t (1) << shift), x * (int32_t (1) << shift),
+                 y * (int32_t (1) << shift), z * (int32_t (1) << shift) };
+    }
+
+    // from float quaternion (soft-float, not meant for the sensor path)
+    static FixedQuaternion fromQuaternion (const Quaternion& q)
+    {
+        static constexpr auto scale = float (one);
+
+        return { int32_t (q.w * scale), int32_t (q.x * scale), int32_t (q.y * scale), int32_t (q.z * scale) };
+    }
+
+    // to float quaternion (soft-float)
+    Quaternion toQuaternion() const
+    {
+        static constexpr auto scale = 1.0f / one;
+
+        return { w * scale, x * scale, y * scale, z * scale };
+    }
+
+    // 14-bit midi value of a component, -1..1 -> 0..16383, clamped outside
+    // same as uint16_t ((c + 1.0f) * 8192.0f) for sh-2 Q14 input below +1, but integer only
+    static uint16_t toMidi14 (int32_t c)
+    {
+        if (c <= -one)
+            return 0;
+
+        const auto offset = uint32_t (c) + uint32_t (one); // 0..3 * 2^30
+        return uint16_t (std::min<uint32_t> (offset >> (fracBits - 13), 16383));
+    }
+
+    // ieee 754 single precision bits of a component, integer only, rounded half up
+    static uint32_t toFloatBits (int32_t c)
+    {
+        if (c == 0)
+            return 0;
+
+        const uint32_t sign = c < 0 ? 0x80000000u : 0;
+        const uint32_t magnitude = c < 0 ? uint32_t (0) - uint32_t (c) : uint32_t (c);
+
+        const int msb = 31 - __builtin_clz (magnitude);
+        uint32_t exponent = uint32_t (msb - fracBits + 127);
+        uint32_t mantissa;
+
+        if (msb > 23)
+        {
+            const auto shift = msb - 23;
+            mantissa = (magnitude + (uint32_t (1) << (shift - 1))) >> shift;
+
+            // rounding overflow to next power of two
+            if (mantissa >> 24)
+            {
+                mantissa >>= 1;
+                ++exponent;
+            }
+        }
+        else
+        {
+            mantissa = magnitude << (23 - msb);
+        }
+
+        return sign | exponent << 23 | (mantissa & 0x7fffff);
+    }
+
+    // float of a component from its bits, no floating point operation involved
+    static float toFloat (int32_t c)
+    {
+        const auto bits = toFloatBits (c);
+        float f;
+        memcpy (&f, &bits, sizeof (f));
+        return f;
+    }
+};
+
+} // namespace imag
@@ -0,0 +1,78 @@
+/* imag_imu.h
+ * 
+ * imagination sensor firmware
+ * compile time imu backend selection
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include "imag_config.h"
+#include "imag_imu_bno08x.h"
+#include "imag_imu_synthetic.h"
+#include "imag_imu_replay.h"
+
+#include <type_traits>
+
+namespace imag::imu
+{
+// backend type per configuration
+template <config::Imu::Backend backend> struct BackendType;
+template <> struct BackendType<config::Imu::Backend::bno08x>    { using type = BNO08x; };
+template <> struct BackendType<config::Imu::Backend::synthetic> { using type = Synthetic; };
+template <> struct BackendType<config::Imu::Backend::replay>    { using type = Replay; };
+
+// configured imu backend
+using Imu = BackendType<config::Imu::backend>::type;
+
+// check the per-sample part of the backend interface, see ImuBase
+template <typename T, typename = void>
+struct IsImu : std::false_type {};
+
+template <typename T>
+struct IsImu<T, std::void_t<decltype (bool (std::declval<T&>().isDataReady())),
+                            decltype (bool (std::declval<T&>().read())),
+                            decltype (DataType (std::declval<T&>().getLastDataType())),
+                            decltype (bool (std::declval<T&>().getLastData (std::declval<FixedQuaternion&>()))),
+                            decltype (bool (std::declval<T&>().getLastData (std::declval<Quaternion&>()))),
+                            decltype (bool (std::declval<T&>().getLastData (std::declval<Vec3f&>()))),
+                            decltype (bool (std::declval<T&>().getLastData (std::declval<Stability&>())))>>
+    : std::true_type {};
+
+static_assert (IsImu<BNO08x>::value && IsImu<Synthetic>::value && IsImu<Replay>::value,
+               "imu backend does not implement the imu interface");
+
+// construct configured backend
+template <typename T = Imu>
+T createImu()
+{
+    if constexpr (std::is_same_v<T, BNO08x>)
+        return T { config::BNO08x::resetPin, config::BNO08x::intPin };
+    else if constexpr (std::is_same_v<T, Synthetic>)
+        return T { config::Imu::syntheticRate, config::Imu::syntheticMotion,
+                   config::Imu::syntheticAmplitude, config::Imu::syntheticFrequency };
+    else
+        return T { replayTrace, replayTraceSize, config::Imu::replayLoop };
+}
+
+// initialise backend
+template <typename T>
+bool initImu (T& imu)
+{
+    if constexpr (std::is_same_v<T, BNO08x>)
+    {
+        static constexpr auto bus = config::BNO08x::bus;
+        static constexpr auto busAddr = bus == config::BNO08x::Bus::spi
+            ? config::BNO08x::spiCsPin
+            : config::BNO08x::i2cAddr;
+
+        return imu.init (bus, busAddr);
+    }
+    else
+    {
+        return imu.init();
+    }
+}
+
+} // namespace imag::imu
@@ -0,0 +1,123 @@
+/* imag_imu_adaptive_rate.cpp
+ * 
+ * imagination sensor firmware
+ * rotation rate adaption to motion
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_imu_adaptive_rate.h"
+#include "imag_debug.h"
+
+// redefine DBG output macros for this module only
+#if ! IMAG_IMU_DEBUG
+#undef DBG
+#define DBG       ;
+#undef DBGLN
+#define DBGLN     ;
+#undef DBGN
+#define DBGN      ;
+#undef DBGNLN
+#define DBGNLN    ;
+#undef DBGHEX
+#define DBGHEX    ;
+#endif // #if ! IMAG_IMU_DEBUG
+
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::imu
+
+namespace imag::imu
+{
+
+namespace
+{
+// 1 - cos (angle / 2) of the wake angle as Q30, ~ angle^2 / 8 for small angles
+constexpr auto wakeRadians = double (config::Stream::wakeAngle) * 3.14159265358979324 / 180.0;
+constexpr auto wakeThreshold = int64_t (wakeRadians * wakeRadians / 8.0 * FixedQuaternion::one);
+} // namespace
+
+
+void AdaptiveRate::addStability (Stability stability, uint32_t now)
+{
+    switch (stability)
+    {
+    case Stability::motion:
+        still = false;
+
+        if (idle)
+            wake();
+        break;
+
+    case Stability::onTable:
+    case Stability::stationary:
+    case Stability::stable:
+        if (! still)
+        {
+            still = true;
+            stillSince = now;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+void AdaptiveRate::addRotation (const FixedQuaternion& rotation)
+{
+    const auto last = lastRotation;
+    lastRotation = rotation;
+
+    if (! idle)
+        return;
+
+    // |q1 . q2| = cos (angle / 2), so the step is above the wake angle if 1 - |dot| exceeds the threshold
+    const auto dot = (int64_t (rotation.w) * last.w + int64_t (rotation.x) * last.x
+                      + int64_t (rotation.y) * last.y + int64_t (rotation.z) * last.z) >> FixedQuaternion::fracBits;
+
+    if (FixedQuaternion::one - (dot < 0 ? -dot : dot) > wakeThreshold)
+    {
+        // the classifier has to report stillness anew
+        still = false;
+        wake();
+    }
+}
+
+
+bool AdaptiveRate::update (uint32_t now)
+{
+    if (! idle && still && now - stillSince >= Config::idleDelay)
+    {
+        idle = changed = true;
+        ++idles;
+
+        DBGLN("AdaptiveRate: idle");
+    }
+
+    const auto res = changed;
+    changed = false;
+
+    return res;
+}
+
+
+void AdaptiveRate::wake()
+{
+    idle = false;
+    changed = true;
+    ++wakeups;
+
+    DBGLN("AdaptiveRate: motion");
+}
+
+
+void AdaptiveRate::printStats()
+{
+    DBG("AdaptiveRate: "); DBGN(idle ? "idle" : "active");
+    DBG(", idles "); DBGN(idles);
+    DBG(", wakeups "); DBGNLN(wakeups);
+}
+
+} // namespace imag::imu
@@ -0,0 +1,64 @@
+/* imag_imu_adaptive_rate.h
+ * 
+ * imagination sensor firmware
+ * rotation rate adaption to motion
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "imag_imu_base.h"
+#include "imag_fixed_quaternion.h"
+#include "imag_config.h"
+
+namespace imag::imu
+{
+/* Idle state for the rotation rate, driven by the sensor's stability
+   classifier: idle once the classifier has reported the wearer still
+   (on table, stationary or stable) for idleDelay, active again as soon
+   as it reports motion. While idle, a rotation step above wakeAngle
+   between two samples ends idling right away, so a head movement does
+   not wait for the next classifier report.
+*/
+class AdaptiveRate
+{
+public:
+    using Config = config::Stream;
+
+    // classifier report received at time [ms]
+    void addStability (Stability stability, uint32_t now);
+
+    // rotation sample received
+    void addRotation (const FixedQuaternion& rotation);
+
+    // evaluate idle delay at time [ms], true if the idle state changed since the last call
+    bool update (uint32_t now);
+
+    bool isIdle() const { return idle; }
+
+    // state changes since start
+    uint32_t getIdles() const { return idles; }
+    uint32_t getWakeups() const { return wakeups; }
+
+    void printStats();
+
+private:
+    void wake();
+
+    bool idle = false;
+    bool changed = false;
+
+    // still since [ms], as reported by the classifier
+    bool still = false;
+    uint32_t stillSince = 0;
+
+    FixedQuaternion lastRotation;
+
+    uint32_t idles = 0;
+    uint32_t wakeups = 0;
+};
+
+} // namespace imag::imu
@@ -0,0 +1,215 @@
+/* imag_imu_base.h
+ * 
+ * imagination sensor firmware
+ * imu data types and common backend interface
+ * 
+ * 2021-2024 rumori
+ */
+
+#pragma once
+
+#include <Adafruit_BNO08x.h>
+
+#include <Arduino_Helpers.h>
+#include <AH/Math/Quaternion.hpp>
+
+#include "imag_fixed_quaternion.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace imag::imu
+{
+// data type aliases that can be queried from sensor
+enum class DataType
+{
+    none                = -1,
+    accel               = SH2_ACCELEROMETER,
+    gyro                = SH2_GYROSCOPE_CALIBRATED,
+    mag                 = SH2_MAGNETIC_FIELD_CALIBRATED,
+    linearAccel         = SH2_LINEAR_ACCELERATION,
+    gravity             = SH2_GRAVITY,
+    rotation            = SH2_ROTATION_VECTOR,
+    rotationGame        = SH2_GAME_ROTATION_VECTOR,
+    rotationGeo         = SH2_GEOMAGNETIC_ROTATION_VECTOR,
+    rotationArvr        = SH2_ARVR_STABILIZED_RV,
+    rotationGameArvr    = SH2_ARVR_STABILIZED_GRV,
+    detectTap           = SH2_TAP_DETECTOR,
+    detectShake         = SH2_SHAKE_DETECTOR,
+    detectStability     = SH2_STABILITY_DETECTOR,
+    detectStep          = SH2_STEP_DETECTOR,
+    countStep           = SH2_STEP_COUNTER,
+    classStability      = SH2_STABILITY_CLASSIFIER,
+    classActivity       = SH2_PERSONAL_ACTIVITY_CLASSIFIER,
+    significantMotion   = SH2_SIGNIFICANT_MOTION,
+
+    // host side fusion from accel, gyro and mag, not a sensor report
+    rotationSoft        = SH2_MAX_SENSOR_ID + 1,
+
+    totalNum            = SH2_MAX_SENSOR_ID + 2
+};
+
+// convenience method for datatype classes
+constexpr bool isAnyRotationDataType (DataType dataType)
+{
+    return dataType == DataType::rotation ||
+        dataType == DataType::rotationGame ||
+        dataType == DataType::rotationGeo ||
+        dataType == DataType::rotationArvr ||
+        dataType == DataType::rotationGameArvr ||
+        dataType == DataType::rotationSoft;
+};
+
+// convenience method for datatype classes
+constexpr bool isAnyVectorDataType (DataType dataType)
+{
+    return dataType == DataType::accel ||
+        dataType == DataType::gyro ||
+        dataType == DataType::mag ||
+        dataType == DataType::linearAccel ||
+        dataType == DataType::gravity;
+};
+
+// convenience method for datatype classes
+constexpr bool isAnyClassifierDataType (DataType dataType)
+{
+    return dataType == DataType::classStability;
+};
+
+// check whether a specific data type is supported by this implementation
+constexpr bool isSupportedDataType (DataType dataType)
+{
+    // rotation and 3d vector types, stability classifier
+    return isAnyRotationDataType (dataType) ||
+        isAnyVectorDataType (dataType) ||
+        isAnyClassifierDataType (dataType);
+}
+
+// stability classifier classes, sh-2 values
+enum class Stability : uint8_t { unknown, onTable, stationary, stable, motion };
+
+
+// sensor event transfer timing statistics [us]
+struct TransferTiming
+{
+    uint32_t last = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t sum = 0;
+    uint32_t count = 0;
+
+    void add (uint32_t duration)
+    {
+        last = duration;
+        min = std::min (min, duration);
+        max = std::max (max, duration);
+        sum += duration;
+        ++count;
+    }
+
+    uint32_t mean() const { return count > 0 ? uint32_t (sum / count) : 0; }
+};
+
+
+/* Imu backend interface
+   
+   Backends are selected at compile time (see imag_imu.h), so there are
+   no virtual calls on the per-sample path. Each backend provides
+
+     bool init()                                  (or specialises initImu())
+     bool isDataReady()                           data pending, i.e. read() will succeed
+     bool read()                                  fetch next sample, false if none
+     bool getLastData (FixedQuaternion& rotation) fixed point, per-sample output path
+     bool getLastData (Quaternion& rotation)
+     bool getLastData (Vec3f& vector)
+
+   and inherits defaults for all optional features from ImuBase, which
+   it may hide by its own implementations.
+*/
+class ImuBase
+{
+public:
+    // listener for raw sensor reports, e.g. for capturing
+    using ReportListener = void (*) (const sh2_SensorValue_t& value);
+
+    // raw reports are only available from sensor hardware backends
+    void setReportListener (ReportListener newListener) {}
+
+    // get type of previously queried data
+    DataType getLastDataType() const { return lastType; }
+
+    // return previously received data: 3d vector and classifier overloads, not supported by default
+    bool getLastData (Vec3f& vector) { return false; }
+    bool getLastData (Stability& stability) { return false; }
+
+    // set data types to query, unsupported types are dropped
+    bool setDataTypesToQuery (const std::vector<DataType>& dataTypes)
+    {
+        typesToQuery.clear();
+        std::copy_if (dataTypes.begin(), dataTypes.end(), std::back_inserter (typesToQuery), isSupportedDataType);
+
+        return typesToQuery.size() == dataTypes.size();
+    }
+
+    // get data types currently queried
+    const std::vector<DataType>& getDataTypesToQuery() const { return typesToQuery; }
+
+    // data rates, not supported by default
+    bool setDataRate (DataType dataType, uint16_t rate) { return false; }
+
+    // tare methods, not supported by default
+    bool setTareFull() { return false; }
+    bool setTareHeading() { return false; }
+    bool setTareTilt() { return false; }
+    bool resetTare() { return false; }
+    bool saveTare() { return false; }
+    bool isTared() const { return false; }
+
+    // reorientation methods
+    bool setReorientation (const Quaternion& newReorientation) { reorientation = newReorientation; return true; }
+    const Quaternion& getReorientation() const { return reorientation; }
+
+    // calibration methods, not supported by default
+    bool beginCalibration() { return false; }
+    bool endCalibration() { return true; }
+    bool saveCalibration() { return false; }
+    bool clearCalibration() { return false; }
+    bool isCalibrating() const { return false; }
+
+    // stall recovery: re-enable reports, or reset the sensor, not supported by default
+    bool recover (bool reset) { return false; }
+
+    // reliability 0.0..1.0 and accuracy in radians, negative if invalid
+    float getCurrentReliability() const { return 1.0f; }
+    float getCurrentAccuracy() const { return -1.0f; }
+
+    bool isInitialised() const { return initialised; }
+
+    // timing statistics, none by default
+    void resetTransferTiming() {}
+    void resetFusionTiming() {}
+
+    // debug printers
+    void printCalibrationReliability() {}
+    bool printSensorsPerformingDynamicCalibration() { return true; }
+    void printTransferTiming() {}
+    void printReconfigTiming() {}
+
+protected:
+    // apply reorientation on host side, as the sensor would do
+    Quaternion reorient (const Quaternion& rotation) const { return rotation + -reorientation; }
+
+    // initialised flag
+    bool initialised = false;
+
+    // type of last queried data
+    DataType lastType = DataType::none;
+
+    // reorientation quaternion
+    Quaternion reorientation;
+
+    // data types to query
+    std::vector<DataType> typesToQuery;
+}; // class ImuBase
+
+} // namespace imag::imu
@@ -23,40 +23,67 @@
 #define DBGHEX    ;
 #endif // #if ! IMAG_IMU_DEBUG
 
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::imu
+
 namespace imag::imu
 {
 
-BNO08x::BNO08x (uint8_t resetPin, uint8_t intPin)
+BNO08x::BNO08x (uint8_t resetPin, uint8_t newIntPin)
     : bno08x (resetPin),
+      intPin (newIntPin),
+      reportListener (nullptr),
+      bus (Bus::i2c),
+      fusionActive (false),
+      fusionAccel {},
+      fusionMag {},
+      fusionTimestamp (0),
       initialised (false),
       lastType (DataType::none),
+      tared (false),
+      tareSaved (false),
       reliability (0),
-      accuracy (-1.0f),
+      accuracy (-1),
       sourceOfReliability (DataType::none),
       sourceOfAccuracy (DataType::none),
       calibrating (false)
 {
     // configure interrupt pin
     pinMode (intPin, INPUT_PULLUP);
+    bno08x.setDecodeFloats (false);
     queryRates.fill (100);
+    clearEnabledReports();
 }
 
 
-bool BNO08x::init (uint8_t i2cAddr)
+bool BNO08x::init (Bus newBus, uint8_t busAddr)
 {
     initialised = false;
+    bus = newBus;
+
+    // init transport, checks whether chip is present
+    const auto found = bus == Bus::spi
+        ? bno08x.begin_SPI (busAddr, intPin)
+        : bno08x.begin_I2C (busAddr);
 
-    // init i2c, checks whether chip is present
-    if (! bno08x.begin_I2C (i2cAddr))
+    if (! found)
     {
 	DBGLN ("BNO08x: sensor not found");
 	return false;
     }
 
+    // keep raw reports for the fixed point data path
+    if (! bno08x.attachSensorHandler())
+    {
+        DBGLN("BNO08x: could not attach sensor event handler");
+        return false;
+    }
+
     // make sure reset took place
     if (! bno08x.wasReset())
     {
-	DBGLN("BNO08x: reset flag not set after i2c init (involving a hardware reset)");
+	DBGLN("BNO08x: reset flag not set after bus init (involving a hardware reset)");
 	return false;
     }
     
@@ -70,6 +97,14 @@ bool BNO08x::init (uint8_t i2cAddr)
         return false;
     }
 
+    clearEnabledReports();
+
+    // a saved tare is restored by the sensor itself after reset
+    if (! loadTare())
+    {
+        DBGLN("BNO08x: no saved tare found");
+    }
+
     return reinit();
 }
 
@@ -77,19 +112,35 @@ bool BNO08x::init (uint8_t i2cAddr)
 bool BNO08x::read()
 {
     // restore reports if sensor was reset
-    if (bno08x.wasReset() && ! reinit())
+    if (bno08x.wasReset())
     {
-        DBGLN ("BNO08x: reinit after reset failed");
-        return false;
+        clearEnabledReports();
+
+        // unsaved tare is lost
+        if (! tareSaved)
+            tared = false;
+
+        if (! reinit())
+        {
+            DBGLN ("BNO08x: reinit after reset failed");
+            return false;
+        }
     }
 
     // query sensor data, return false if none available
+    const auto transferStart = micros();
+
     if (! bno08x.getSensorEvent (&sensorValue))
     {
         // DBGLN ("BNO08x: getSensorEvent() did not yield any data");
         return false;
     }
 
+    transferTiming.add (micros() - transferStart);
+
+    if (reportListener != nullptr)
+        reportListener (sensorValue);
+
     // TODO: check for sequence number gap
 
     // set data type
@@ -102,6 +153,10 @@ bool BNO08x::read()
         return false;
     }
 
+    // gyro reports drive software fusion output
+    if (fusionActive && updateFusion())
+        lastType = DataType::rotationSoft;
+
     // store reliability
     if (lastType == sourceOfReliability)
     {
@@ -115,31 +170,97 @@ bool BNO08x::read()
         if (lastType == DataType::rotation ||
             lastType == DataType::rotationGeo ||
             lastType == DataType::rotationArvr)
-            accuracy = sensorValue.un.rotationVector.accuracy;
+            accuracy = getRawValue (4);
         else
-            accuracy = -1.0f;
-        DBG("BNO08x: received accuracy "); DBGNLN(accuracy * 180.0 / PI);
+            accuracy = -1;
+        DBG("BNO08x: received accuracy "); DBGNLN(getCurrentAccuracy() * 180.0 / PI);
     }
 
     return true;
 }
 
 
-bool BNO08x::getLastData (Quaternion& rotation)
+bool BNO08x::getLastData (FixedQuaternion& rotation)
 {
     if (! isAnyRotationDataType (lastType))
         return false;
 
-    rotation.w = sensorValue.un.rotationVector.real;
-    rotation.x = sensorValue.un.rotationVector.i;
-    rotation.y = sensorValue.un.rotationVector.j;
-    rotation.z = sensorValue.un.rotationVector.k;
+    if (lastType == DataType::rotationSoft)
+    {
+        const auto [w, x, y, z] = fusion.getFixedEnu();
+        rotation = FixedQuaternion::fromFixed<MahonyFusion::fracBits> (w, x, y, z);
+        return true;
+    }
+
+    // raw report order is i, j, k, real
+    rotation = FixedQuaternion::fromFixed<rotationFracBits> (getRawValue (3), getRawValue (0),
+                                                            getRawValue (1), getRawValue (2));
+
+    return true;
+}
+
+
+bool BNO08x::getLastData (Quaternion& rotation)
+{
+    FixedQuaternion fixedRotation;
+
+    if (! getLastData (fixedRotation))
+        return false;
+
+    rotation = fixedRotation.toQuaternion();
+
+    return true;
+}
+
+
+bool BNO08x::getLastData (Vec3f& vector)
+{
+    int fracBits;
+
+    switch (lastType)
+    {
+    case DataType::accel:
+    case DataType::linearAccel:
+    case DataType::gravity:
+        fracBits = accelFracBits;
+        break;
+
+    case DataType::gyro:
+        fracBits = gyroFracBits;
+        break;
+
+    case DataType::mag:
+        fracBits = magFracBits;
+        break;
+
+    default:
+        return false;
+    }
+
+    // all vector reports share the same layout
+    const auto scale = 1.0f / (1 << fracBits);
+
+    vector = { getRawValue (0) * scale, getRawValue (1) * scale, getRawValue (2) * scale };
+
+    return true;
+}
+
+
+bool BNO08x::getLastData (Stability& stability)
+{
+    if (lastType != DataType::classStability)
+        return false;
+
+    // classification is the first byte after the report header
+    const auto classification = bno08x.getLastEvent().report[4];
+
+    stability = classification <= static_cast<uint8_t> (Stability::motion) ? Stability (classification) : Stability::unknown;
 
     return true;
 }
 
 
-bool BNO08x::setDataTypesToQuery (const std::initializer_list<DataType>& dataTypes)
+bool BNO08x::setDataTypesToQuery (const std::vector<DataType>& dataTypes)
 {
     auto res = true;
 
@@ -153,28 +274,91 @@ bool BNO08x::setDataTypesToQuery (const std::initializer_list<DataType>& dataTyp
             res = false;
     }
 
+    // applied by init() if set before
+    if (! initialised)
+        return res;
+
     // try to update supported types even if also unsupported were requested
     return updateDataTypesToQuery() && res;
 }
 
 
+bool BNO08x::setDataRate (DataType dataType, uint16_t rate)
+{
+    if (! isSupportedDataType (dataType) || rate == 0)
+        return false;
+
+    const auto typeInt = static_cast<int> (dataType);
+
+    queryRates[typeInt] = rate;
+
+    // calibration uses its own report setup, new rate is applied on endCalibration()
+    // or by init() if set before
+    if (! initialised || calibrating || std::find (typesToQuery.begin(), typesToQuery.end(), dataType) == typesToQuery.end())
+        return true;
+
+    // only the changed report is sent
+    return updateDataTypesToQuery();
+}
+
+
 bool BNO08x::setReorientation (const Quaternion& newReorientation)
 {
     reorientation = newReorientation;
+    tared = false;
+
+    // applied by init() if set before, unless a saved tare is restored
+    if (! initialised)
+        return true;
+
     return updateReorientation();
 }
 
 
-bool BNO08x::beginCalibration()
+bool BNO08x::resetTare()
+{
+    tared = false;
+    return updateReorientation();
+}
+
+
+bool BNO08x::saveTare()
 {
-    auto res = disableAllSensors();
+    // persist sensor orientation, i.e. reorientation including tare
+    if (! bno08x.saveTare())
+    {
+        DBGLN("BNO08x: error persisting tare");
+        return false;
+    }
+
+    // remember tare state and plain reorientation for restoring at startup
+    std::array<uint32_t, 5> record { tareRecordMagic | (tared ? 1 : 0) };
+    const std::array<float, 4> reorientationFloats { reorientation.w, reorientation.x, reorientation.y, reorientation.z };
+    memcpy (&record[1], reorientationFloats.data(), sizeof (reorientationFloats));
 
+    if (! bno08x.writeUserRecord (record.data(), record.size()))
+    {
+        DBGLN("BNO08x: error writing tare user record");
+        return false;
+    }
+
+    tareSaved = tared;
+
+    return true;
+}
+
+
+bool BNO08x::beginCalibration()
+{
     // enable dynamic calibration according to BNO08x Sensor Calibration Procedure document
-    res &= bno08x.setSensorsPerformingDynamicCalibration (SH2_CAL_ACCEL | SH2_CAL_GYRO | SH2_CAL_MAG);
+    auto res = bno08x.setSensorsPerformingDynamicCalibration (SH2_CAL_ACCEL | SH2_CAL_GYRO | SH2_CAL_MAG);
 
     // enable only sensors according to BNO08x Sensor Calibration Procedure document
-    if (! (bno08x.enableReport (SH2_GAME_ROTATION_VECTOR) &&            // game rotation
-           bno08x.enableReport (SH2_MAGNETIC_FIELD_CALIBRATED, 20000))) // magnetic field @ 50Hz
+    ReportIntervals intervals {};
+    intervals[SH2_GAME_ROTATION_VECTOR] = 10000;      // game rotation @ 100Hz
+    intervals[SH2_MAGNETIC_FIELD_CALIBRATED] = 20000; // magnetic field @ 50Hz
+
+    if (! updateReports (intervals))
     {
         res = false;
         DBGLN("BNO08x: error enabling sensor reports for calibration");
@@ -182,6 +366,7 @@ bool BNO08x::beginCalibration()
 
     // get reliability from magnetic field
     sourceOfReliability = DataType::mag;
+    fusionActive = false;
 
     if (res)
         calibrating = true;
@@ -223,11 +408,37 @@ bool BNO08x::clearCalibration()
 
     // this will have caused a reset, so reinit.
     delay (250);
+    clearEnabledReports();
+
+    // a saved tare is restored by the sensor itself after reset
+    if (! loadTare())
+    {
+        DBGLN("BNO08x: no saved tare found");
+    }
 
     return reinit();
 }
 
 
+bool BNO08x::recover (bool reset)
+{
+    // sensor state is unknown, so all reports are sent again
+    clearEnabledReports();
+
+    if (! reset)
+        return reinit();
+
+    // reset command, via reset pin if the sensor does not even take commands
+    if (! bno08x.deviceReset())
+    {
+        DBGLN("BNO08x: device reset failed, resetting via pin");
+        bno08x.hardwareReset();
+    }
+
+    return true;
+}
+
+
 void BNO08x::printCalibrationReliability()
 {
 #if IMAG_IMU_DEBUG
@@ -276,10 +487,46 @@ bool BNO08x::printSensorsPerformingDynamicCalibration()
 }
 
 
+void BNO08x::printTransferTiming()
+{
+#if IMAG_IMU_DEBUG
+    DBG("BNO08x: transfer timing via "); DBGLN(bus == Bus::spi ? "spi" : "i2c");
+    DBG("BNO08x: events  : "); DBGNLN(transferTiming.count);
+    DBG("BNO08x: last us : "); DBGNLN(transferTiming.last);
+    DBG("BNO08x: min us  : "); DBGNLN(transferTiming.count > 0 ? transferTiming.min : 0);
+    DBG("BNO08x: mean us : "); DBGNLN(transferTiming.mean());
+    DBG("BNO08x: max us  : "); DBGNLN(transferTiming.max);
+
+    if (fusionActive)
+    {
+        DBG("BNO08x: fusion updates: "); DBGNLN(fusionTiming.count);
+        DBG("BNO08x: fusion mean us: "); DBGNLN(fusionTiming.mean());
+        DBG("BNO08x: fusion max us : "); DBGNLN(fusionTiming.max);
+    }
+#endif // IMAG_IMU_DEBUG
+}
+
+
+void BNO08x::printReconfigTiming()
+{
+#if IMAG_IMU_DEBUG
+    DBG("BNO08x: last report update us: "); DBGN(reportUpdateTiming.duration);
+    DBG(", transactions: "); DBGNLN(reportUpdateTiming.transactions);
+    DBG("BNO08x: last reinit us       : "); DBGN(reinitTiming.duration);
+    DBG(", transactions: "); DBGNLN(reinitTiming.transactions);
+#endif // IMAG_IMU_DEBUG
+}
+
+
 bool BNO08x::reinit()
 {
     initialised = false;
 
+    const auto startTime = micros();
+
+    // every sh-2 command counts, including failed ones
+    reinitTiming.transactions = 1;
+
     // set sensors which do auto-calibration
     if (! setDefaultAutoCalibration())
     {
@@ -288,42 +535,72 @@ bool BNO08x::reinit()
     }
 
     // enable reports
-    if (! updateDataTypesToQuery())
+    const auto reportsSet = updateDataTypesToQuery();
+    reinitTiming.transactions += reportUpdateTiming.transactions;
+
+    if (! reportsSet)
     {
         DBGLN("BNO08x: could not set reports");
         return false;
     }
 
-    // set reorientation
-    if (! updateReorientation())
+    // set reorientation, unless the sensor restored a saved tare on top of it
+    if (! tared)
     {
-        DBGLN("BNO08x: error setting reorientation to sensor");
-        return false;
+        ++reinitTiming.transactions;
+
+        if (! updateReorientation())
+        {
+            DBGLN("BNO08x: error setting reorientation to sensor");
+            return false;
+        }
     }
 
+    reinitTiming.duration = micros() - startTime;
+
     return initialised = true;
 }
 
 
 bool BNO08x::updateDataTypesToQuery (const std::vector<DataType>& newTypesToQuery)
 {
-    auto res = true;
+    // requested sensors only, all others disabled
+    ReportIntervals intervals {};
 
-    // disable all sensors
-    res = disableAllSensors();
+    // shortest interval wins if a report is requested twice
+    auto request = [&] (DataType type, uint16_t rate)
+    {
+        auto& interval = intervals[static_cast<size_t> (type)];
+        const auto newInterval = 1000000L / static_cast<uint32_t> (rate);
+
+        interval = interval > 0 ? std::min<uint32_t> (interval, newInterval) : newInterval;
+    };
+
+    fusionActive = false;
 
-    // enable requested sensors
     for (auto type : newTypesToQuery)
     {
-        const auto typeInt = static_cast<int> (type);
-        
-        if (! bno08x.enableReport (typeInt, 1000000L / static_cast<uint32_t> (queryRates[typeInt])))
+        if (type == DataType::rotationSoft)
         {
-            DBG("BNO08x: error while enabling sensor for data type "); DBGLN(typeInt);
-            res = false;
+            // software fusion input, gyro and accel at fusion rate
+            const auto rate = queryRates[static_cast<size_t> (type)];
+
+            request (DataType::gyro, rate);
+            request (DataType::accel, rate);
+            request (DataType::mag, queryRates[static_cast<size_t> (DataType::mag)]);
+
+            if (! fusionActive)
+                fusion.reset();
+
+            fusionActive = true;
+            continue;
         }
+
+        request (type, queryRates[static_cast<size_t> (type)]);
     }
 
+    const auto res = updateReports (intervals);
+
     // get reliability and accuracy from first type in query list
     sourceOfReliability = newTypesToQuery.size() > 0 ? newTypesToQuery[0] : DataType::none;
     sourceOfAccuracy = sourceOfReliability;
@@ -332,32 +609,97 @@ bool BNO08x::updateDataTypesToQuery (const std::vector<DataType>& newTypesToQuer
 }
 
 
-bool BNO08x::disableAllSensors()
+bool BNO08x::updateFusion()
+{
+    // raw gyro to fusion input scaling, accel and mag only need their direction
+    static constexpr auto gyroShift = MahonyFusion::gyroFracBits - gyroFracBits;
+
+    switch (lastType)
+    {
+    case DataType::accel:
+        fusionAccel = { getRawValue (0), getRawValue (1), getRawValue (2) };
+        return false;
+
+    case DataType::mag:
+        fusionMag = { getRawValue (0), getRawValue (1), getRawValue (2) };
+        return false;
+
+    case DataType::gyro:
+    {
+        const auto dt = fusionTimestamp > 0 ? uint32_t (sensorValue.timestamp - fusionTimestamp) : 0;
+
+        fusionTimestamp = sensorValue.timestamp;
+
+        const auto start = micros();
+        fusion.update ({ getRawValue (0) * (int32_t (1) << gyroShift),
+                         getRawValue (1) * (int32_t (1) << gyroShift),
+                         getRawValue (2) * (int32_t (1) << gyroShift) },
+                       fusionAccel,
+                       fusionMag,
+                       dt);
+        fusionTiming.add (micros() - start);
+
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+
+bool BNO08x::updateReports (const ReportIntervals& newIntervals)
 {
     auto res = true;
+    const auto startTime = micros();
+
+    reportUpdateTiming.transactions = 0;
 
-    // disable all sensors
-    for (size_t type = 0; type < static_cast<size_t> (DataType::totalNum); ++type)
+    for (size_t type = 0; type <= SH2_MAX_SENSOR_ID; ++type)
     {
-        if (! bno08x.enableReport (type, 0))
-        {
-            DBG("BNO08x: error while disabling sensor for data type "); DBGLN(type);
-            res = false;
-        }
+        if (enabledIntervals[type] == newIntervals[type])
+            continue;
+
+        res &= setReportInterval (type, newIntervals[type]);
     }
 
+    reportUpdateTiming.duration = micros() - startTime;
+
     return res;
 }
 
 
+bool BNO08x::setReportInterval (size_t type, uint32_t interval)
+{
+    ++reportUpdateTiming.transactions;
+
+    if (! bno08x.enableReport (type, interval))
+    {
+        DBG("BNO08x: error while setting report interval for data type "); DBGNLN(type);
+
+        // sensor state unknown, make sure it is resent next time
+        enabledIntervals[type] = intervalUnknown;
+        return false;
+    }
+
+    enabledIntervals[type] = interval;
+    return true;
+}
+
+
 bool BNO08x::setTare (bool tareFull)
 {
+    // sensor tare does not apply to software fusion output
+    if (fusionActive)
+        return false;
+
     sh2_TareBasis_t basis = SH2_TARE_BASIS_ROTATION_VECTOR; // default
     uint8_t axes = SH2_TARE_Z;
 
     if (typesToQuery.size() > 0)
     {
-        if (typesToQuery[0] == DataType::rotationGame)
+        if (typesToQuery[0] == DataType::rotationGame ||
+            typesToQuery[0] == DataType::rotationGameArvr)
             basis = SH2_TARE_BASIS_GAMING_ROTATION_VECTOR;
         else if (typesToQuery[0] == DataType::rotationGeo)
             basis = SH2_TARE_BASIS_GEOMAGNETIC_ROTATION_VECTOR;
@@ -372,6 +714,29 @@ bool BNO08x::setTare (bool tareFull)
         return false;
     }
 
+    tared = true;
+    tareSaved = false;
+
+    return true;
+}
+
+
+bool BNO08x::loadTare()
+{
+    std::array<uint32_t, 5> record {};
+    uint16_t words = record.size();
+
+    if (! bno08x.readUserRecord (record.data(), words) ||
+        words != record.size() ||
+        (record[0] & ~uint32_t (1)) != tareRecordMagic)
+        return false;
+
+    std::array<float, 4> reorientationFloats;
+    memcpy (reorientationFloats.data(), &record[1], sizeof (reorientationFloats));
+    reorientation = { reorientationFloats[0], reorientationFloats[1], reorientationFloats[2], reorientationFloats[3] };
+
+    tared = tareSaved = record[0] & 1;
+
     return true;
 }
 
@@ -9,6 +9,10 @@
 #pragma once
 
 #include "Adafruit_BNO08x_ext.h"
+#include "imag_imu_base.h"
+#include "imag_imu_fusion.h"
+#include "imag_fixed_quaternion.h"
+#include "imag_config.h"
 
 #include <Arduino_Helpers.h>
 #include <AH/Math/Quaternion.hpp>
@@ -19,50 +23,16 @@
 
 namespace imag::imu
 {
-// data type aliases that can be queried from sensor
-enum class DataType
-{
-    none                = -1,
-    accel               = SH2_ACCELEROMETER,
-    gyro                = SH2_GYROSCOPE_CALIBRATED,
-    mag                 = SH2_MAGNETIC_FIELD_CALIBRATED,
-    rotation            = SH2_ROTATION_VECTOR,
-    rotationGame        = SH2_GAME_ROTATION_VECTOR,
-    rotationGeo         = SH2_GEOMAGNETIC_ROTATION_VECTOR,
-    rotationArvr        = SH2_ARVR_STABILIZED_RV,
-    rotationGameArvr    = SH2_ARVR_STABILIZED_GRV,
-    detectTap           = SH2_TAP_DETECTOR,
-    detectShake         = SH2_SHAKE_DETECTOR,
-    detectStability     = SH2_STABILITY_DETECTOR,
-    detectStep          = SH2_STEP_DETECTOR,
-    countStep           = SH2_STEP_COUNTER,
-    classStability      = SH2_STABILITY_CLASSIFIER,
-    classActivity       = SH2_PERSONAL_ACTIVITY_CLASSIFIER,
-    significantMotion   = SH2_SIGNIFICANT_MOTION,
-
-    totalNum            = SH2_MAX_SENSOR_ID + 1
-};
+// sh-2 transport bus selector
+using Bus = config::BNO08x::Bus;
 
-// convenience method for datatype classes
-constexpr bool isAnyRotationDataType (DataType dataType)
+// sensor report reconfiguration timing
+struct ReconfigTiming
 {
-    return dataType == DataType::rotation ||
-        dataType == DataType::rotationGame ||
-        dataType == DataType::rotationGeo ||
-        dataType == DataType::rotationArvr ||
-        dataType == DataType::rotationGameArvr;
+    uint32_t duration = 0;    // [us]
+    uint16_t transactions = 0; // sh-2 commands sent: report enables/disables, and for a reinit also calibration config and reorientation
 };
 
-// check whether a specific data type is supported by this implementation
-constexpr bool isSupportedDataType (DataType dataType)
-{
-    // rotation and single sensor types (for calibration) so far
-    return isAnyRotationDataType (dataType) ||
-        dataType == DataType::accel ||
-        dataType == DataType::gyro ||
-        dataType == DataType::mag;
-}
-
 
 class BNO08x
 {
@@ -71,32 +41,68 @@ public:
     BNO08x (uint8_t resetPin, uint8_t intPin);
   
     // check sensor presence and initialise
-    bool init (uint8_t i2cAddr);
+    // busAddr is the i2c address for Bus::i2c or the chip select pin for Bus::spi
+    bool init (Bus bus, uint8_t busAddr);
+
+    // get bus selected at init
+    Bus getBus() const { return bus; }
+
+    // sensor signals pending data via interrupt pin
+    bool isDataReady() const { return digitalRead (intPin) == LOW; }
 
     // query data from sensor if available and set type member
     bool read();
 
+    // listener called for every raw report received from sensor
+    using ReportListener = ImuBase::ReportListener;
+    // reports are decoded to floats only while a listener is set
+    void setReportListener (ReportListener newListener)
+    {
+        reportListener = newListener;
+        bno08x.setDecodeFloats (reportListener != nullptr);
+    }
+
     // get type of previously queried data
     DataType getLastDataType() const { return lastType; }
 
+    // return previously received data: fixed point quaternion overload
+    /* integer only: sensor rotation vectors are Q14, software fusion Q28 */
+    bool getLastData (FixedQuaternion& rotation);
+
     // return previously received data: Quaternion overload
     bool getLastData (Quaternion& rotation);
 
+    // return previously received data: 3d vector overload
+    /* units: accel, linearAccel, gravity [m/s^2], gyro [rad/s], mag [uT] */
+    bool getLastData (Vec3f& vector);
+
+    // return previously received data: stability classifier overload
+    bool getLastData (Stability& stability);
+
     // set data types to query from sensor
-    bool setDataTypesToQuery (const std::initializer_list<DataType>& dataTypes);
+    // the first type is the primary one, i.e. source of reliability/accuracy
+    // set before init(), the sensor is configured only once at startup
+    bool setDataTypesToQuery (const std::vector<DataType>& dataTypes);
 
     // get data types currently queried by sensor
     const std::vector<DataType>& getDataTypesToQuery() const { return typesToQuery; }
 
     // tare methods
+    /* the sensor applies a tare by modifying its reorientation, so a tare
+       is dropped by setReorientation() and by a reset unless saved
+    */
     bool setTareFull() { return setTare (true); }
     bool setTareHeading() { return setTare(); }
-    bool resetTare() { return updateReorientation(); }
+    bool resetTare();
+    bool isTared() const { return tared; }
 
     bool setTareTilt() { return false; }
-    bool saveTare() { return false; }
+
+    // persist current tare state and reorientation on sensor across power cycles
+    bool saveTare();
 
     // reorientation methods
+    // drops a current tare, set before init() it is applied unless a saved tare is found
     bool setReorientation (const Quaternion& newReorientation);
     const Quaternion& getReorientation() const { return reorientation; }
 
@@ -107,28 +113,68 @@ public:
     bool clearCalibration();
     bool isCalibrating() const { return calibrating; }
 
-    // set sensor data rate
-    bool setDataRate (int rate) { return false; } // not supported by default
+    // set sensor data rate in Hz for a data type, applied immediately if queried
+    bool setDataRate (DataType dataType, uint16_t rate);
+
+    // get sensor data rate in Hz for a data type
+    uint16_t getDataRate (DataType dataType) const { return queryRates[static_cast<size_t> (dataType)]; }
 
     // get current sensor/fusion reliability, 0.0..1.0
     float getCurrentReliability() const { return reliability / 3.0f; }
 
     // get current sensor/fusion accuracy, radians, negative if invalid
-    float getCurrentAccuracy() const { return accuracy; }
+    float getCurrentAccuracy() const { return accuracy < 0 ? -1.0f : accuracy * (1.0f / (1 << accuracyFracBits)); }
+
+    // stall recovery: re-enable all reports, or reset the sensor, reports are restored by read() then
+    bool recover (bool reset);
 
     bool isInitialised() const { return initialised; }
 
+    // get/reset timing of sensor event transfers over the selected bus
+    const TransferTiming& getTransferTiming() const { return transferTiming; }
+    void resetTransferTiming() { transferTiming = {}; }
+
+    // get/reset timing of software fusion updates
+    const TransferTiming& getFusionTiming() const { return fusionTiming; }
+    void resetFusionTiming() { fusionTiming = {}; }
+
+    // get timing of last report change (mode switch) and last reinit (reset recovery)
+    const ReconfigTiming& getReportUpdateTiming() const { return reportUpdateTiming; }
+    const ReconfigTiming& getReinitTiming() const { return reinitTiming; }
+
     // debug printers
     void printCalibrationReliability();
     bool printSensorsPerformingDynamicCalibration();
+    void printTransferTiming();
+    void printReconfigTiming();
 
 private:
+    // report intervals in us per data type, 0 means disabled
+    using ReportIntervals = std::array<uint32_t, static_cast<size_t> (DataType::totalNum)>;
+
+    // marker for reports whose sensor state is unknown after a failed command
+    static constexpr uint32_t intervalUnknown = UINT32_MAX;
+
     bool reinit();
     bool updateDataTypesToQuery() { return updateDataTypesToQuery (typesToQuery); }
     bool updateDataTypesToQuery (const std::vector<DataType>& newTypesToQuery);
-    bool disableAllSensors();
+
+    // feed software fusion with current sensor value, true if rotation was updated
+    bool updateFusion();
+
+    // send only report changes compared to enabledIntervals to sensor
+    bool updateReports (const ReportIntervals& newIntervals);
+
+    // send a single report change to sensor and keep track of it
+    bool setReportInterval (size_t type, uint32_t interval);
+
+    // forget enabled reports after a sensor reset, which disables all of them
+    void clearEnabledReports() { enabledIntervals.fill (0); }
     bool setTare (bool tareFull = false);
 
+    // restore tare state and reorientation saved with saveTare()
+    bool loadTare();
+
     // set default auto calibration mode
     bool setDefaultAutoCalibration();
 
@@ -142,13 +188,54 @@ private:
         return { float (sh2Quat.w), float (sh2Quat.x), float (sh2Quat.y), float (sh2Quat.z) };
     }
 
+    // raw report field of last sensor event, index counts 16-bit values after the 4 byte header
+    int16_t getRawValue (size_t index) const { return bno08x.getLastEventValue (4 + 2 * index); }
+
+    // fractional bits of raw sh-2 report values (Q points)
+    static constexpr int rotationFracBits = 14;
+    static constexpr int accuracyFracBits = 12;
+    static constexpr int accelFracBits = 8;
+    static constexpr int gyroFracBits = 9;
+    static constexpr int magFracBits = 4;
+
     // bno08x interface object
     Adafruit_BNO08x_ext bno08x;
 
+    // interrupt pin, needed by spi transport
+    uint8_t intPin;
+
+    // raw report listener
+    ReportListener reportListener;
+
+    // transport bus
+    Bus bus;
+
+    // sensor event transfer timing
+    TransferTiming transferTiming;
+
+    // software fusion, active if DataType::rotationSoft is queried
+    MahonyFusion fusion;
+    bool fusionActive;
+
+    // latest fusion inputs, raw sh-2 accel and mag, timestamp [us]
+    std::array<int32_t, 3> fusionAccel;
+    std::array<int32_t, 3> fusionMag;
+    uint64_t fusionTimestamp;
+
+    // software fusion update timing
+    TransferTiming fusionTiming;
+
+    // reconfiguration timings
+    ReconfigTiming reportUpdateTiming;
+    ReconfigTiming reinitTiming;
+
+    // report intervals currently enabled on sensor
+    ReportIntervals enabledIntervals;
+
     // initialised flag
     bool initialised;
 
-    // sensor value last read
+    // sensor value last read, data in raw report unless decoded for the listener
     sh2_SensorValue_t sensorValue;
 
     // type of last queried data
@@ -157,14 +244,21 @@ private:
     // reorientation quaternion
     Quaternion reorientation;
 
+    // tare flags: tare applied on top of reorientation, saved to sensor flash
+    bool tared;
+    bool tareSaved;
+
+    // user record identifier of saved tare state, followed by version
+    static constexpr uint32_t tareRecordMagic = 0x494d0100; // 'I' 'M' 1 0
+
     // data types to query
     std::vector<DataType> typesToQuery;
 
     // reliability sent with last matching sensor data
     int reliability;
 
-    // accuracy sent with last sensor data or negative if invalid
-    float accuracy;
+    // accuracy sent with last sensor data, raw Q12 radians, negative if invalid
+    int16_t accuracy;
 
     // sensor report type from which to set reliability member
     DataType sourceOfReliability;
@@ -0,0 +1,238 @@
+/* imag_imu_fusion.cpp
+ *
+ * imagination sensor firmware
+ * fixed-point mahony sensor fusion
+ *
+ * 2024 rumori
+ */
+
+#include "imag_imu_fusion.h"
+
+namespace imag::imu
+{
+
+namespace
+{
+using fixed = MahonyFusion::fixed;
+
+// compile time sqrt for table generation
+constexpr double constSqrt (double x)
+{
+    double r = x > 1.0 ? x : 1.0;
+
+    for (int i = 0; i < 64; ++i)
+        r = 0.5 * (r + x / r);
+
+    return r;
+}
+
+// 1/sqrt initial guesses for x in [i/64, (i+1)/64), first 4 entries unused
+constexpr auto invSqrtTableBits = 6;
+
+constexpr std::array<fixed, 1 << invSqrtTableBits> makeInvSqrtTable()
+{
+    std::array<fixed, 1 << invSqrtTableBits> table {};
+
+    for (size_t i = 4; i < table.size(); ++i)
+        table[i] = MahonyFusion::toFixed (1.0 / constSqrt ((i + 0.5) / table.size()));
+
+    return table;
+}
+
+constexpr auto invSqrtTable = makeInvSqrtTable();
+
+constexpr fixed half = MahonyFusion::one / 2;
+
+// rotation from fusion frame (x: magnetic north, z: up) to ENU, +90 deg around z
+constexpr fixed frameW = MahonyFusion::toFixed (0.70710678118654752);
+constexpr fixed frameZ = MahonyFusion::toFixed (0.70710678118654752);
+} // namespace
+
+
+MahonyFusion::MahonyFusion (fixed newTwoKp, fixed newTwoKi)
+    : twoKp (newTwoKp),
+      twoKi (newTwoKi)
+{
+    reset();
+}
+
+
+void MahonyFusion::reset()
+{
+    q = { one, 0, 0, 0 };
+    integral = { 0, 0, 0 };
+    settleRemaining = settleTime;
+}
+
+
+void MahonyFusion::update (const std::array<fixed, 3>& gyro,
+                           std::array<int32_t, 3> a,
+                           std::array<int32_t, 3> m,
+                           uint32_t dt)
+{
+    dt = std::min (dt, maxTimeStep);
+
+    const auto [q0, q1, q2, q3] = q;
+
+    // error between measured and estimated directions, Q(fracBits)
+    fixed halfex = 0, halfey = 0, halfez = 0;
+
+    if (normalise (a))
+    {
+        // auxiliary products
+        const auto q0q0 = mul (q0, q0), q0q1 = mul (q0, q1), q0q2 = mul (q0, q2), q0q3 = mul (q0, q3);
+        const auto q1q1 = mul (q1, q1), q1q2 = mul (q1, q2), q1q3 = mul (q1, q3);
+        const auto q2q2 = mul (q2, q2), q2q3 = mul (q2, q3);
+        const auto q3q3 = mul (q3, q3);
+
+        // estimated direction of gravity
+        const auto halfvx = q1q3 - q0q2;
+        const auto halfvy = q0q1 + q2q3;
+        const auto halfvz = q0q0 - half + q3q3;
+
+        halfex = mul (a[1], halfvz) - mul (a[2], halfvy);
+        halfey = mul (a[2], halfvx) - mul (a[0], halfvz);
+        halfez = mul (a[0], halfvy) - mul (a[1], halfvx);
+
+        if (normalise (m))
+        {
+            // reference direction of earth's magnetic field
+            const auto hx = 2 * (mul (m[0], half - q2q2 - q3q3) + mul (m[1], q1q2 - q0q3) + mul (m[2], q1q3 + q0q2));
+            const auto hy = 2 * (mul (m[0], q1q2 + q0q3) + mul (m[1], half - q1q1 - q3q3) + mul (m[2], q2q3 - q0q1));
+            const auto bx = sqrt (mul (hx, hx) + mul (hy, hy));
+            const auto bz = 2 * (mul (m[0], q1q3 - q0q2) + mul (m[1], q2q3 + q0q1) + mul (m[2], half - q1q1 - q2q2));
+
+            // estimated direction of magnetic field
+            const auto halfwx = mul (bx, half - q2q2 - q3q3) + mul (bz, q1q3 - q0q2);
+            const auto halfwy = mul (bx, q1q2 - q0q3) + mul (bz, q0q1 + q2q3);
+            const auto halfwz = mul (bx, q0q2 + q1q3) + mul (bz, half - q1q1 - q2q2);
+
+            halfex += mul (m[1], halfwz) - mul (m[2], halfwy);
+            halfey += mul (m[2], halfwx) - mul (m[0], halfwz);
+            halfez += mul (m[0], halfwy) - mul (m[1], halfwx);
+        }
+    }
+
+    // half time step in s, Q(fracBits): dt * 2^28 / 2e6
+    const auto halfDt = fixed ((int64_t (dt) * 8796093) >> 16);
+
+    // gyro including feedback, Q(gyroFracBits)
+    static constexpr auto toGyro = fracBits - gyroFracBits;
+
+    // raise proportional gain by 16 while settling
+    static constexpr auto settleGainShift = 4;
+    static_assert (toGyro >= settleGainShift);
+
+    auto kpShift = toGyro;
+
+    if (settleRemaining > 0)
+    {
+        kpShift -= settleGainShift;
+        settleRemaining -= std::min (settleRemaining, dt);
+    }
+
+    const std::array<fixed, 3> halfe { halfex, halfey, halfez };
+    std::array<fixed, 3> g;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (twoKi > 0)
+            integral[i] += mul (mul (twoKi, halfe[i]), 2 * halfDt) >> toGyro;
+
+        g[i] = gyro[i] + integral[i] + (mul (twoKp, halfe[i]) >> kpShift);
+
+        // rotation angle / 2 for this step, Q(fracBits)
+        g[i] = mul (g[i], halfDt, gyroFracBits);
+    }
+
+    // integrate rate of change
+    q[0] += -mul (q1, g[0]) - mul (q2, g[1]) - mul (q3, g[2]);
+    q[1] +=  mul (q0, g[0]) + mul (q2, g[2]) - mul (q3, g[1]);
+    q[2] +=  mul (q0, g[1]) - mul (q1, g[2]) + mul (q3, g[0]);
+    q[3] +=  mul (q0, g[2]) + mul (q1, g[1]) - mul (q2, g[0]);
+
+    // normalise, norm is close to 1, so a single newton step from 1 is sufficient
+    const auto n2 = mul (q[0], q[0]) + mul (q[1], q[1]) + mul (q[2], q[2]) + mul (q[3], q[3]);
+    const auto invNorm = (3 * one - n2) >> 1;
+
+    for (auto& c : q)
+        c = mul (c, invNorm);
+}
+
+
+std::array<MahonyFusion::fixed, 4> MahonyFusion::getFixedEnu() const
+{
+    // rotate into enu world frame: frame * q, frame = [ w 0 0 z ]
+    return { mul (frameW, q[0]) - mul (frameZ, q[3]),
+             mul (frameW, q[1]) - mul (frameZ, q[2]),
+             mul (frameW, q[2]) + mul (frameZ, q[1]),
+             mul (frameW, q[3]) + mul (frameZ, q[0]) };
+}
+
+
+Quaternion MahonyFusion::getQuaternion() const
+{
+    const auto [w, x, y, z] = getFixedEnu();
+
+    static constexpr auto scale = 1.0f / one;
+
+    return { w * scale, x * scale, y * scale, z * scale };
+}
+
+
+bool MahonyFusion::normalise (std::array<int32_t, 3>& v)
+{
+    uint32_t maxAbs = 0;
+
+    for (auto c : v)
+        maxAbs = std::max (maxAbs, c < 0 ? uint32_t (0) - uint32_t (c) : uint32_t (c));
+
+    if (maxAbs == 0)
+        return false;
+
+    // prescale largest component to [1/4, 1/2), i.e. bit 26 set, so norm^2 is in [1/16, 3/4]
+    const auto shift = __builtin_clz (maxAbs) - 5;
+
+    for (auto& c : v)
+        c = shift >= 0 ? int32_t (uint32_t (c) << shift) : c >> -shift;
+
+    const auto invNorm = invSqrt (mul (v[0], v[0]) + mul (v[1], v[1]) + mul (v[2], v[2]));
+
+    for (auto& c : v)
+        c = mul (c, invNorm);
+
+    return true;
+}
+
+
+MahonyFusion::fixed MahonyFusion::invSqrt (fixed x)
+{
+    auto y = invSqrtTable[x >> (fracBits - invSqrtTableBits)];
+
+    // newton steps, table guess is within 6% so two steps give < 1e-4
+    for (int i = 0; i < 2; ++i)
+        y = mul (y, (3 * one - mul (mul (x, y), y)) >> 1);
+
+    return y;
+}
+
+
+MahonyFusion::fixed MahonyFusion::sqrt (fixed x)
+{
+    if (x <= 0)
+        return 0;
+
+    x = std::min (x, one - 1);
+
+    // scale by 4^k into [1/16, 1) for invSqrt(), undo by 2^k afterwards
+    const auto k = (__builtin_clz (uint32_t (x)) - 4) / 2;
+
+    if (k > 12) // below ~1e-8, treat as zero
+        return 0;
+
+    const auto scaled = x << (2 * k);
+
+    return mul (scaled, invSqrt (scaled)) >> k;
+}
+
+} // namespace imag::imu
@@ -0,0 +1,101 @@
+/* imag_imu_fusion.h
+ *
+ * imagination sensor firmware
+ * fixed-point mahony sensor fusion
+ *
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Arduino_Helpers.h>
+#include <AH/Math/Quaternion.hpp>
+
+#include <array>
+
+namespace imag::imu
+{
+/* Mahony AHRS filter in Q28 fixed point for FPU-less MCUs (Cortex-M0).
+   Only 32x32->64 bit integer multiplies and shifts are used per update,
+   floats appear solely in getQuaternion(). The output is rotated into the
+   ENU world frame used by the BNO08x rotation vectors.
+*/
+class MahonyFusion
+{
+public:
+    // fixed point type
+    using fixed = int32_t;
+
+    // fractional bits of quaternion, unit vectors and gains, range +-8
+    static constexpr int fracBits = 28;
+
+    // fractional bits of gyro input [rad/s], range +-128
+    static constexpr int gyroFracBits = 24;
+
+    static constexpr fixed one = fixed (1) << fracBits;
+
+    // float to fixed conversion, meant for compile time constants only (soft-float)
+    static constexpr fixed toFixed (double value, int frac = fracBits)
+    {
+        return fixed (value * double (int64_t (1) << frac));
+    }
+
+    // max time step accepted by update(), longer gaps are clamped [us]
+    static constexpr uint32_t maxTimeStep = 100000;
+
+    // time with raised proportional gain after reset for fast convergence [us]
+    static constexpr uint32_t settleTime = 2000000;
+
+    // constructor, gains as 2 * Kp and 2 * Ki
+    MahonyFusion (fixed twoKp = toFixed (1.0), fixed twoKi = 0);
+
+    // restart from identity
+    void reset();
+
+    // process one sample
+    // gyro in rad/s as Q(gyroFracBits), accel and mag in any integer scale per sensor,
+    // accel/mag ignored if all zero, dt since previous sample in us
+    void update (const std::array<fixed, 3>& gyro,
+                 std::array<int32_t, 3> accel,
+                 std::array<int32_t, 3> mag,
+                 uint32_t dt);
+
+    // current orientation [ w, x, y, z ] in Q(fracBits), sensor fusion frame
+    const std::array<fixed, 4>& getFixed() const { return q; }
+
+    // current orientation [ w, x, y, z ] in Q(fracBits), ENU world frame
+    std::array<fixed, 4> getFixedEnu() const;
+
+    // current orientation in ENU world frame
+    Quaternion getQuaternion() const;
+
+private:
+    // fixed point multiply
+    static fixed mul (fixed a, fixed b) { return fixed ((int64_t (a) * b) >> fracBits); }
+    static fixed mul (fixed a, fixed b, int shift) { return fixed ((int64_t (a) * b) >> shift); }
+
+    // normalise integer vector to Q(fracBits) unit vector, false if zero
+    static bool normalise (std::array<int32_t, 3>& v);
+
+    // 1/sqrt(x) for x in [1/16, 1) as Q(fracBits)
+    static fixed invSqrt (fixed x);
+
+    // sqrt(x) for x in [0, 1] as Q(fracBits)
+    static fixed sqrt (fixed x);
+
+    // orientation quaternion [ w, x, y, z ]
+    std::array<fixed, 4> q;
+
+    // integral feedback terms, Q(gyroFracBits)
+    std::array<fixed, 3> integral;
+
+    // gains
+    fixed twoKp;
+    fixed twoKi;
+
+    // remaining settle time [us]
+    uint32_t settleRemaining;
+};
+
+} // namespace imag::imu
@@ -0,0 +1,107 @@
+/* imag_imu_replay.cpp
+ * 
+ * imagination sensor firmware
+ * recorded trace imu backend
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_imu_replay.h"
+
+namespace imag::imu
+{
+
+Replay::Replay (const TraceRecord* newRecords, size_t newNumRecords, bool shouldLoop)
+    : records (newRecords),
+      numRecords (newNumRecords),
+      loop (shouldLoop),
+      index (0),
+      startTime (0),
+      current (nullptr)
+{}
+
+
+bool Replay::init()
+{
+    index = 0;
+    startTime = micros();
+    current = nullptr;
+
+    return initialised = records != nullptr && numRecords > 0;
+}
+
+
+bool Replay::isDataReady() const
+{
+    if (! initialised)
+        return false;
+
+    if (index < numRecords)
+        return micros() - startTime >= records[index].time;
+
+    // wrapping around, first record follows the last one
+    return loop && micros() - startTime >= records[numRecords - 1].time + records[0].time;
+}
+
+
+bool Replay::read()
+{
+    while (isDataReady())
+    {
+        // wrap around, continuing timing from the last record
+        if (index >= numRecords)
+        {
+            startTime += records[numRecords - 1].time;
+            index = 0;
+        }
+
+        const auto& record = records[index++];
+        const auto type = static_cast<DataType> (record.type);
+
+        // skip records not queried
+        if (typesToQuery.empty() ||
+            std::find (typesToQuery.begin(), typesToQuery.end(), type) != typesToQuery.end())
+        {
+            current = &record;
+            lastType = type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool Replay::getLastData (FixedQuaternion& rotation)
+{
+    Quaternion floatRotation;
+
+    if (! getLastData (floatRotation))
+        return false;
+
+    rotation = FixedQuaternion::fromQuaternion (floatRotation);
+
+    return true;
+}
+
+
+bool Replay::getLastData (Quaternion& rotation)
+{
+    if (current == nullptr || ! isAnyRotationDataType (lastType))
+        return false;
+
+    rotation = reorient ({ current->values[0], current->values[1], current->values[2], current->values[3] });
+    return true;
+}
+
+
+bool Replay::getLastData (Vec3f& vector)
+{
+    if (current == nullptr || ! isAnyVectorDataType (lastType))
+        return false;
+
+    vector = { current->values[0], current->values[1], current->values[2] };
+    return true;
+}
+
+} // namespace imag::imu
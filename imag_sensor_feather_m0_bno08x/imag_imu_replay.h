@@ -0,0 +1,69 @@
+/* imag_imu_replay.h
+ * 
+ * imagination sensor firmware
+ * recorded trace imu backend
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include "imag_imu_base.h"
+
+namespace imag::imu
+{
+// single recorded sensor report
+struct TraceRecord
+{
+    uint32_t time;   // since trace start [us]
+    uint8_t type;    // DataType
+    float values[4]; // rotation [ w, x, y, z ] or vector [ x, y, z, - ]
+};
+
+// trace to replay, to be provided by a generated source file when
+// the replay backend is selected
+extern const TraceRecord replayTrace[];
+extern const size_t replayTraceSize;
+
+// replays a recorded trace with its original timing
+class Replay : public ImuBase
+{
+public:
+    // constructor, records must stay valid (e.g. const in flash)
+    Replay (const TraceRecord* records, size_t numRecords, bool loop = true);
+
+    // start replay
+    bool init();
+
+    // next record due?
+    bool isDataReady() const;
+
+    // fetch next record if due
+    bool read();
+
+    // return previously replayed data
+    bool getLastData (FixedQuaternion& rotation);
+    bool getLastData (Quaternion& rotation);
+    bool getLastData (Vec3f& vector);
+    bool getLastData (Stability& stability) { return false; }
+
+    // replay finished (never if looping)
+    bool isFinished() const { return index >= numRecords; }
+
+private:
+    // trace
+    const TraceRecord* records;
+    size_t numRecords;
+    bool loop;
+
+    // next record to replay
+    size_t index;
+
+    // replay start time [us]
+    uint32_t startTime;
+
+    // last replayed record
+    const TraceRecord* current;
+};
+
+} // namespace imag::imu
@@ -0,0 +1,162 @@
+/* imag_imu_synthetic.cpp
+ * 
+ * imagination sensor firmware
+ * synthetic motion imu backend
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_imu_synthetic.h"
+
+namespace imag::imu
+{
+
+namespace
+{
+// yaw (z), pitch (y), roll (x) to quaternion, same convention as EulerAngles
+Quaternion fromEuler (float yaw, float pitch, float roll)
+{
+    const auto cy = cosf (0.5f * yaw), sy = sinf (0.5f * yaw);
+    const auto cp = cosf (0.5f * pitch), sp = sinf (0.5f * pitch);
+    const auto cr = cosf (0.5f * roll), sr = sinf (0.5f * roll);
+
+    return { cr * cp * cy + sr * sp * sy,
+             sr * cp * cy - cr * sp * sy,
+             cr * sp * cy + sr * cp * sy,
+             cr * cp * sy - sr * sp * cy };
+}
+} // namespace
+
+
+Synthetic::Synthetic (uint16_t rate, Motion newMotion, float newAmplitude, float newFrequency)
+    : period (1000000UL / std::max<uint16_t> (rate, 1)),
+      motion (newMotion),
+      amplitude (newAmplitude),
+      frequency (newFrequency),
+      startTime (0),
+      sampleTime (0),
+      gyroPending (false)
+{}
+
+
+bool Synthetic::init()
+{
+    startTime = sampleTime = micros();
+    return initialised = true;
+}
+
+
+bool Synthetic::read()
+{
+    // angular velocity of the previous sample, if queried
+    if (gyroPending)
+    {
+        gyroPending = false;
+        lastType = DataType::gyro;
+        return true;
+    }
+
+    if (! isDataReady())
+        return false;
+
+    // keep the nominal rate, but do not try to catch up after long stalls
+    sampleTime += period;
+
+    if (micros() - sampleTime > 4 * period)
+        sampleTime = micros();
+
+    const auto t = (sampleTime - startTime) * 1.0e-6f;
+
+    float yaw, pitch, roll;
+    evaluate (t, yaw, pitch, roll);
+    rotation = reorient (fromEuler (yaw, pitch, roll));
+
+    // angular velocity by finite difference of the euler angles, good enough for small tilts
+    static constexpr auto dt = 1.0e-3f;
+    float yaw2, pitch2, roll2;
+    evaluate (t + dt, yaw2, pitch2, roll2);
+    angularVelocity = { (roll2 - roll) / dt, (pitch2 - pitch) / dt, (yaw2 - yaw) / dt };
+
+    // rotation first, as the first queried rotation type, i.e. the primary one of the sketch,
+    // followed by angular velocity if queried
+    const auto primary = std::find_if (typesToQuery.begin(), typesToQuery.end(), isAnyRotationDataType);
+
+    lastType = primary != typesToQuery.end() ? *primary : DataType::rotation;
+    gyroPending = std::find (typesToQuery.begin(), typesToQuery.end(), DataType::gyro) != typesToQuery.end();
+
+    return true;
+}
+
+
+bool Synthetic::getLastData (FixedQuaternion& rotation)
+{
+    Quaternion floatRotation;
+
+    if (! getLastData (floatRotation))
+        return false;
+
+    rotation = FixedQuaternion::fromQuaternion (floatRotation);
+
+    return true;
+}
+
+
+bool Synthetic::getLastData (Quaternion& newRotation)
+{
+    if (! isAnyRotationDataType (lastType))
+        return false;
+
+    newRotation = rotation;
+    return true;
+}
+
+
+bool Synthetic::getLastData (Vec3f& vector)
+{
+    if (lastType != DataType::gyro)
+        return false;
+
+    vector = angularVelocity;
+    return true;
+}
+
+
+bool Synthetic::setDataRate (DataType dataType, uint16_t rate)
+{
+    if (! isAnyRotationDataType (dataType) || rate == 0)
+        return false;
+
+    period = 1000000UL / rate;
+    return true;
+}
+
+
+void Synthetic::evaluate (float t, float& yaw, float& pitch, float& roll) const
+{
+    const auto phase = 2.0f * PI * frequency * t;
+
+    yaw = pitch = roll = 0.0f;
+
+    switch (motion)
+    {
+    case Motion::still:
+        break;
+
+    case Motion::yawSweep:
+        yaw = amplitude * sinf (phase);
+        break;
+
+    case Motion::nod:
+        pitch = amplitude * sinf (phase);
+        break;
+
+    case Motion::wander:
+        // incommensurate frequencies, never exactly repeating
+        yaw = amplitude * sinf (phase);
+        pitch = 0.4f * amplitude * sinf (0.37f * phase + 1.0f);
+        roll = 0.2f * amplitude * sinf (0.61f * phase + 2.0f);
+        break;
+    }
+}
+
+} // namespace imag::imu
@@ -0,0 +1,68 @@
+/* imag_imu_synthetic.h
+ * 
+ * imagination sensor firmware
+ * synthetic motion imu backend
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include "imag_imu_base.h"
+#include "imag_config.h"
+
+namespace imag::imu
+{
+// generates rotation samples at a fixed rate following a motion profile
+class Synthetic : public ImuBase
+{
+public:
+    using Motion = config::Imu::Motion;
+
+    // constructor, amplitude in radians, frequency in Hz
+    Synthetic (uint16_t rate, Motion motion, float amplitude, float frequency);
+
+    // start generating
+    bool init();
+
+    // next sample due?
+    bool isDataReady() const { return gyroPending || (initialised && micros() - sampleTime >= period); }
+
+    // generate next sample if due
+    bool read();
+
+    // return previously generated data
+    bool getLastData (FixedQuaternion& rotation);
+    bool getLastData (Quaternion& rotation);
+    bool getLastData (Vec3f& vector);
+    bool getLastData (Stability& stability) { return false; }
+
+    // change rate/profile at runtime
+    bool setDataRate (DataType dataType, uint16_t rate);
+    void setMotion (Motion newMotion) { motion = newMotion; }
+
+private:
+    // orientation at time t [s] as yaw, pitch, roll
+    void evaluate (float t, float& yaw, float& pitch, float& roll) const;
+
+    // sample period [us]
+    uint32_t period;
+
+    // motion profile parameters
+    Motion motion;
+    float amplitude;
+    float frequency;
+
+    // start and last sample time [us]
+    uint32_t startTime;
+    uint32_t sampleTime;
+
+    // last generated rotation and angular velocity
+    Quaternion rotation;
+    Vec3f angularVelocity;
+
+    // angular velocity sample to deliver next
+    bool gyroPending;
+};
+
+} // namespace imag::imu
@@ -0,0 +1,93 @@
+/* imag_imu_watchdog.cpp
+ * 
+ * imagination sensor firmware
+ * sensor stall detection and recovery
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_imu_watchdog.h"
+#include "imag_debug.h"
+
+#include <algorithm>
+
+// redefine DBG output macros for this module only
+#if ! IMAG_IMU_DEBUG
+#undef DBG
+#define DBG       ;
+#undef DBGLN
+#define DBGLN     ;
+#undef DBGN
+#define DBGN      ;
+#undef DBGNLN
+#define DBGNLN    ;
+#undef DBGHEX
+#define DBGHEX    ;
+#endif // #if ! IMAG_IMU_DEBUG
+
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::imu
+
+namespace imag::imu
+{
+
+void Watchdog::feed (uint32_t now)
+{
+    armed = true;
+    lastSample = now;
+
+    if (! stalled)
+        return;
+
+    stalled = false;
+    lastRecovery = now - detected;
+    maxRecovery = std::max (maxRecovery, lastRecovery);
+
+    LOGI("Sensor recovered");
+    DBG("Watchdog: recovered after ms "); DBGNLN(lastRecovery);
+}
+
+
+Watchdog::Action Watchdog::check (uint32_t now)
+{
+    if (! armed)
+        return Action::none;
+
+    if (! stalled)
+    {
+        if (now - lastSample < config::Imu::stallTimeout)
+            return Action::none;
+
+        stalled = true;
+        detected = lastAction = now;
+        ++stalls;
+        ++reinits;
+
+        LOGW("Sensor stalled, re-enabling reports");
+
+        return Action::reinit;
+    }
+
+    if (now - lastAction < config::Imu::recoveryInterval)
+        return Action::none;
+
+    lastAction = now;
+    ++resets;
+
+    LOGW("Sensor still stalled, resetting");
+
+    return Action::reset;
+}
+
+
+void Watchdog::printStats()
+{
+    DBG("Watchdog: stalls "); DBGN(stalls);
+    DBG(", reinits "); DBGN(reinits);
+    DBG(", resets "); DBGN(resets);
+    DBG(", recovery ms last "); DBGN(lastRecovery);
+    DBG(", max "); DBGNLN(maxRecovery);
+}
+
+} // namespace imag::imu
@@ -0,0 +1,81 @@
+/* imag_imu_watchdog.h
+ * 
+ * imagination sensor firmware
+ * sensor stall detection and recovery
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "imag_config.h"
+
+namespace imag::imu
+{
+/* Detects a sensor that stopped delivering samples, e.g. one that no
+   longer asserts its interrupt, and tells which recovery step is due.
+   The main loop keeps running meanwhile, as its wait for the sensor is
+   bounded (config::Imu::loopTimeout). After stallTimeout without a
+   sample the reports are re-enabled, if samples are not back within
+   recoveryInterval the sensor is reset, repeated every recoveryInterval.
+
+   Recovery time counts from stall detection to the next sample.
+
+   osc reply to /watchdog:
+     /watchdog i:stalls i:reinits i:resets i:last recovery [ms] i:max recovery [ms]
+*/
+class Watchdog
+{
+public:
+    enum class Action : uint8_t { none, reinit, reset };
+
+    // sample received at time [ms], also arms the watchdog
+    void feed (uint32_t now);
+
+    // recovery step due at time [ms]
+    Action check (uint32_t now);
+
+    bool isStalled() const { return stalled; }
+
+    // event counts and recovery times [ms]
+    uint32_t getStalls() const { return stalls; }
+    uint32_t getReinits() const { return reinits; }
+    uint32_t getResets() const { return resets; }
+    uint32_t getLastRecovery() const { return lastRecovery; }
+    uint32_t getMaxRecovery() const { return maxRecovery; }
+
+    void printStats();
+
+    // send stats via osc sender, e.g. WINC150x
+    template <typename Sender>
+    bool sendStats (Sender& sender, const char* oscAddress) const
+    {
+        auto& msg = sender.beginMessage (oscAddress);
+        auto res = msg.addInt (int32_t (stalls));
+        res &= msg.addInt (int32_t (reinits));
+        res &= msg.addInt (int32_t (resets));
+        res &= msg.addInt (int32_t (lastRecovery));
+        res &= msg.addInt (int32_t (maxRecovery));
+
+        return res && sender.sendMessage();
+    }
+
+private:
+    bool armed = false;
+    bool stalled = false;
+
+    // [ms]
+    uint32_t lastSample = 0;
+    uint32_t detected = 0;
+    uint32_t lastAction = 0;
+
+    uint32_t stalls = 0;
+    uint32_t reinits = 0;
+    uint32_t resets = 0;
+    uint32_t lastRecovery = 0;
+    uint32_t maxRecovery = 0;
+};
+
+} // namespace imag::imu
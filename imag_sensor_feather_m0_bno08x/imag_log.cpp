@@ -0,0 +1,421 @@
+/* imag_log.cpp
+ * 
+ * imagination sensor firmware
+ * deferred ring-buffered debug log
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_log.h"
+
+#if IMAG_DEBUG
+
+namespace imag::log
+{
+namespace
+{
+// module names for text output
+constexpr std::array<const char*, static_cast<size_t> (Module::totalNum)> moduleNames {
+    "main", "imu", "net", "display", "battery", "midi", "power"
+};
+
+// level prefixes for text output, debug has none
+constexpr std::array<const char*, 4> levelNames { "error: ", "warning: ", "info: ", "" };
+
+// level names for runtime filters
+constexpr std::array<const char*, 4> levelIds { "error", "warning", "info", "debug" };
+
+// string literals live in internal flash, which is mapped from address 0
+bool isLiteral (const char* str)
+{
+#if defined(ARDUINO_ARCH_SAMD)
+    return reinterpret_cast<uintptr_t> (str) < FLASH_SIZE;
+#else
+    return false;
+#endif
+}
+
+// header bits
+constexpr uint8_t kindMask = 0x0f;
+constexpr uint8_t newlineBit = 0x10;
+constexpr int levelShift = 5;
+constexpr uint8_t timestampBit = 0x80;
+
+} // namespace
+
+
+Logger logger { Serial };
+
+
+Logger::Logger (Print& newOut)
+    : ring {},
+      head (0),
+      tail (0),
+      out (newOut),
+      written (0),
+      level (config::Log::level),
+      modules ((1u << static_cast<uint8_t> (Module::totalNum)) - 1),
+      lineStart (true),
+      dropped (0),
+      droppedTotal (0)
+{
+}
+
+
+void Logger::setModuleEnabled (Module module, bool enabled)
+{
+    const auto bit = 1u << static_cast<uint8_t> (module);
+
+    if (enabled)
+        modules |= bit;
+    else
+        modules &= ~bit;
+}
+
+
+bool Logger::setLevel (const char* name)
+{
+    for (size_t i = 0; i < levelIds.size(); ++i)
+    {
+        if (strcmp (name, levelIds[i]) == 0)
+        {
+            setLevel (Level (i));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool Logger::setModuleEnabled (const char* name, bool enabled)
+{
+    for (size_t i = 0; i < moduleNames.size(); ++i)
+    {
+        if (strcmp (name, moduleNames[i]) == 0)
+        {
+            setModuleEnabled (Module (i), enabled);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void Logger::put (Module module, Level recordLevel, bool newline)
+{
+    if (! isEnabled (module, recordLevel))
+        return;
+
+    begin (module, recordLevel, newline, Kind::newline, 0);
+}
+
+
+void Logger::put (Module module, Level recordLevel, bool newline, const char* str)
+{
+    putText (module, recordLevel, newline, str, false);
+}
+
+
+void Logger::put (Module module, Level recordLevel, bool newline, float value)
+{
+    uint32_t bits;
+    memcpy (&bits, &value, sizeof (bits));
+    putValue (module, recordLevel, newline, Kind::real, bits);
+}
+
+
+void Logger::putText (Module module, Level recordLevel, bool newline, const char* str, bool copy)
+{
+    if (! isEnabled (module, recordLevel))
+        return;
+
+    // literals are referenced by address
+    if (! copy && isLiteral (str))
+    {
+        const auto address = uint32_t (reinterpret_cast<uintptr_t> (str));
+
+        if (begin (module, recordLevel, newline, Kind::literal, sizeof (address)))
+            append (&address, sizeof (address));
+
+        return;
+    }
+
+    // longer text is split into several records, the last one ends the line
+    auto remaining = strlen (str);
+
+    do
+    {
+        const auto length = uint8_t (std::min (remaining, maxText));
+        remaining -= length;
+
+        if (! begin (module, recordLevel, newline && remaining == 0, Kind::text, 1 + length))
+        {
+            // the rest of the text is dropped along
+            lineStart = newline;
+            return;
+        }
+
+        append (&length, 1);
+        append (str, length);
+        str += length;
+    }
+    while (remaining > 0);
+}
+
+
+void Logger::putValue (Module module, Level recordLevel, bool newline, Kind kind, uint32_t value)
+{
+    if (! isEnabled (module, recordLevel))
+        return;
+
+    if (begin (module, recordLevel, newline, kind, sizeof (value)))
+        append (&value, sizeof (value));
+}
+
+
+bool Logger::begin (Module module, Level recordLevel, bool newline, Kind kind, size_t payloadSize)
+{
+    const auto stamp = lineStart;
+    const auto size = 3 + (stamp ? 4 : 0) + payloadSize;
+
+    // a line is over even if its end is lost
+    lineStart = newline;
+
+    // report pending drops first, needs room for the notice and this record
+    putDropped (size);
+
+    if (dropped > 0 || getFree() < size)
+    {
+        if (dropped < UINT16_MAX)
+            ++dropped;
+
+        ++droppedTotal;
+        return false;
+    }
+
+    const uint8_t header[] {
+        sync,
+        uint8_t (uint8_t (kind) | (newline ? newlineBit : 0) | (uint8_t (recordLevel) << levelShift) | (stamp ? timestampBit : 0)),
+        uint8_t (module)
+    };
+    append (header, sizeof (header));
+
+    if (stamp)
+    {
+        const uint32_t now = micros();
+        append (&now, sizeof (now));
+    }
+
+    return true;
+}
+
+
+void Logger::putDropped (size_t reserve)
+{
+    if (dropped == 0 || getFree() < 3 + sizeof (dropped) + reserve)
+        return;
+
+    const uint8_t notice[] { sync, uint8_t (uint8_t (Kind::dropped) | newlineBit), uint8_t (Module::main) };
+    append (notice, sizeof (notice));
+    append (&dropped, sizeof (dropped));
+    dropped = 0;
+}
+
+
+void Logger::append (const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const uint8_t*> (data);
+
+    for (size_t i = 0; i < size; ++i)
+        ring[head++ & (ring.size() - 1)] = bytes[i];
+}
+
+
+size_t Logger::getPayloadSize (Kind kind, uint8_t textLength)
+{
+    switch (kind)
+    {
+    case Kind::newline:
+        return 0;
+    case Kind::text:
+        return 1 + textLength;
+    case Kind::dropped:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+
+size_t Logger::peek (uint8_t* record) const
+{
+    if (head == tail)
+        return 0;
+
+    auto at = [this] (size_t offset) { return ring[(tail + offset) & (ring.size() - 1)]; };
+
+    const auto header = at (1);
+    const auto valueOffset = 3 + ((header & timestampBit) ? 4 : 0);
+    const auto size = valueOffset + getPayloadSize (Kind (header & kindMask), at (valueOffset));
+
+    for (size_t i = 0; i < size; ++i)
+        record[i] = at (i);
+
+    return size;
+}
+
+
+void Logger::format (const uint8_t* record, Print& text) const
+{
+    const auto header = record[1];
+    const auto module = record[2];
+    auto* value = record + 3;
+
+    auto read32 = [&value]
+    {
+        uint32_t v;
+        memcpy (&v, value, sizeof (v));
+        value += sizeof (v);
+        return v;
+    };
+
+    // line prefix: time [ms], module, level
+    if (header & timestampBit)
+    {
+        const auto stamp = read32();
+        const auto frac = stamp % 1000;
+
+        text.print (stamp / 1000);
+        text.print (frac < 10 ? ".00" : frac < 100 ? ".0" : ".");
+        text.print (frac);
+        text.print (" ");
+        text.print (module < moduleNames.size() ? moduleNames[module] : "?");
+        text.print (": ");
+        text.print (levelNames[(header >> levelShift) & 0x03]);
+    }
+
+    switch (Kind (header & kindMask))
+    {
+    case Kind::literal:
+        text.print (reinterpret_cast<const char*> (uintptr_t (read32())));
+        break;
+
+    case Kind::text:
+        text.write (value + 1, value[0]);
+        break;
+
+    case Kind::sint:
+        text.print (long (int32_t (read32())));
+        break;
+
+    case Kind::uint:
+        text.print ((unsigned long) read32());
+        break;
+
+    case Kind::real:
+    {
+        const auto bits = read32();
+        float f;
+        memcpy (&f, &bits, sizeof (f));
+        text.print (f);
+        break;
+    }
+
+    case Kind::hex:
+        text.print ((unsigned long) read32(), HEX);
+        break;
+
+    case Kind::dropped:
+    {
+        uint16_t count;
+        memcpy (&count, value, sizeof (count));
+        text.print ("<");
+        text.print (count);
+        text.print (" log records dropped>");
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    if (header & newlineBit)
+        text.print ("\r\n");
+}
+
+
+size_t Logger::writeNext (bool blocking)
+{
+    // report drops once everything else is out
+    if (head == tail)
+        putDropped (0);
+
+    uint8_t record[maxRecord];
+    const auto size = peek (record);
+
+    if (size == 0)
+        return 0;
+
+    if (config::Log::binary)
+    {
+        // keep record until the output can take it
+        if (! blocking && out.availableForWrite() < int (size))
+            return 0;
+
+        out.write (record, size);
+        tail += size;
+
+        return size;
+    }
+
+    // text of a record, e.g. a long literal with its line prefix, may exceed what the
+    // output takes at once, so it is written in slices and the record kept until done
+    const auto room = blocking ? maxLine : size_t (std::max (out.availableForWrite(), 0));
+
+    if (room == 0)
+        return 0;
+
+    SlicePrint<maxLine> slice { written, room };
+    format (record, slice);
+
+    out.write (reinterpret_cast<const uint8_t*> (slice.buffer), slice.length);
+    written += slice.length;
+
+    if (written < slice.total)
+        return slice.length;
+
+    written = 0;
+    tail += size;
+
+    // empty text still counts as progress
+    return std::max (slice.length, size_t (1));
+}
+
+
+void Logger::drain()
+{
+    size_t budget = config::Log::drainBudget;
+
+    while (budget > 0)
+    {
+        const auto bytes = writeNext (false);
+
+        if (bytes == 0)
+            break;
+
+        budget -= std::min (bytes, budget);
+    }
+}
+
+
+void Logger::flush()
+{
+    while (writeNext (true) > 0)
+        ;
+}
+
+} // namespace imag::log
+
+#endif // IMAG_DEBUG
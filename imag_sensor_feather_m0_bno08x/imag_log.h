@@ -0,0 +1,212 @@
+/* imag_log.h
+ * 
+ * imagination sensor firmware
+ * deferred ring-buffered debug log
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <algorithm>
+#include <type_traits>
+
+#include "imag_config.h"
+
+namespace imag::log
+{
+// source module of a record, set per file via IMAG_LOG_MODULE
+enum class Module : uint8_t { main, imu, net, display, battery, midi, power, totalNum };
+
+// record severity, DBG macros log at debug level
+using Level = config::Log::Level;
+
+/* Debug output is not printed when logged, but appended as compact
+   records to a RAM ring buffer and drained to the serial port in idle
+   time by drain(), which never blocks. Records that do not fit are
+   dropped and counted.
+
+   String literals are stored by address (the format id), values in
+   binary. Depending on config::Log::binary, drain() either formats the
+   records as text (literals are readable from flash) or sends them as
+   binary records for tools/imag_log.py, which resolves the literals from
+   the firmware elf file:
+
+     0xd7 sync, header, module u8, [timestamp u32 [us]], payload
+     header: bits 0-3 kind, bit 4 end of line, bits 5-6 level, bit 7 timestamp
+     kinds:  literal: address u32    text: length u8, chars
+             int: i32   uint: u32   float: f32   hex: u32
+             dropped: count u16      newline: -
+
+   A timestamp is attached to the first record of every line. As text,
+   a record is written in slices as far as the port takes them, so a
+   long literal is never cut.
+*/
+class Logger
+{
+public:
+    enum class Kind : uint8_t { newline, literal, text, sint, uint, real, hex, dropped };
+
+    static constexpr uint8_t sync = 0xd7;
+    static constexpr size_t maxText = 32;
+
+    // sync, header, module, timestamp, text length and chars
+    static constexpr size_t maxRecord = 3 + 4 + 1 + maxText;
+
+    // formatted text written at once at most, fits a usb cdc packet
+    static constexpr size_t maxLine = 62;
+
+    // constructor
+    Logger (Print& out);
+
+    // runtime filters
+    void setLevel (Level newLevel) { level = newLevel; }
+    void setModuleEnabled (Module module, bool enabled);
+
+    // runtime filters by name, e.g. "warning" or "net", false if unknown
+    bool setLevel (const char* name);
+    bool setModuleEnabled (const char* name, bool enabled);
+    bool isEnabled (Module module, Level recordLevel) const
+    {
+        return recordLevel <= level && (modules & (1u << static_cast<uint8_t> (module)));
+    }
+
+    // log values, newline ends the line after the value
+    void put (Module module, Level recordLevel, bool newline);
+    void put (Module module, Level recordLevel, bool newline, const char* str);
+    void put (Module module, Level recordLevel, bool newline, const String& str) { putText (module, recordLevel, newline, str.c_str(), true); }
+    void put (Module module, Level recordLevel, bool newline, const __FlashStringHelper* str) { put (module, recordLevel, newline, reinterpret_cast<const char*> (str)); }
+    void put (Module module, Level recordLevel, bool newline, float value);
+    void put (Module module, Level recordLevel, bool newline, double value) { put (module, recordLevel, newline, float (value)); }
+    void put (Module module, Level recordLevel, bool newline, bool value) { put (module, recordLevel, newline, uint32_t (value)); }
+    void put (Module module, Level recordLevel, bool newline, char value) { const char str[2] { value, 0 }; putText (module, recordLevel, newline, str, true); }
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    void put (Module module, Level recordLevel, bool newline, T value)
+    {
+        if constexpr (std::is_signed_v<T>)
+            putValue (module, recordLevel, newline, Kind::sint, uint32_t (int32_t (value)));
+        else
+            putValue (module, recordLevel, newline, Kind::uint, uint32_t (value));
+    }
+
+    // anything printable, e.g. IPAddress, is formatted to text right away
+    template <typename T, std::enable_if_t<std::is_base_of_v<Printable, T>, int> = 0>
+    void put (Module module, Level recordLevel, bool newline, const T& value)
+    {
+        TextPrint<maxText> text;
+        text.print (value);
+        putText (module, recordLevel, newline, text.buffer, true);
+    }
+
+    void putHex (Module module, Level recordLevel, bool newline, uint32_t value)
+    {
+        putValue (module, recordLevel, newline, Kind::hex, value);
+    }
+
+    // write pending records as far as the output accepts them without blocking
+    void drain();
+
+    // write all pending records, blocking, e.g. before halting
+    void flush();
+
+    // records dropped since start
+    uint32_t getDropped() const { return droppedTotal; }
+
+private:
+    // formats printables into a small buffer, truncates
+    template <size_t capacity>
+    struct TextPrint : public Print
+    {
+        size_t write (uint8_t c) override
+        {
+            if (length >= capacity)
+                return 0;
+
+            buffer[length++] = char (c);
+            buffer[length] = 0;
+            return 1;
+        }
+
+        char buffer[capacity + 1] { 0 };
+        size_t length = 0;
+    };
+
+    // formats a record, keeps at most room chars of it from skip on
+    template <size_t capacity>
+    struct SlicePrint : public Print
+    {
+        SlicePrint (size_t newSkip, size_t newRoom) : skip (newSkip), room (std::min (newRoom, capacity)) {}
+
+        size_t write (uint8_t c) override
+        {
+            if (total++ >= skip && length < room)
+                buffer[length++] = char (c);
+
+            return 1;
+        }
+
+        char buffer[capacity];
+        size_t skip;
+        size_t room;
+        size_t length = 0;
+        size_t total = 0; // length of the whole text
+    };
+
+    // literal if str is in flash, otherwise copied as text
+    void putText (Module module, Level recordLevel, bool newline, const char* str, bool copy);
+
+    void putValue (Module module, Level recordLevel, bool newline, Kind kind, uint32_t value);
+
+    // start record in ring buffer, false (and counted) if full
+    bool begin (Module module, Level recordLevel, bool newline, Kind kind, size_t payloadSize);
+    void append (const void* data, size_t size);
+
+    // append notice of dropped records if there is room left for reserve bytes
+    void putDropped (size_t reserve);
+
+    size_t getFree() const { return ring.size() - (head - tail); }
+
+    // payload size of a record kind, text length for Kind::text
+    static size_t getPayloadSize (Kind kind, uint8_t textLength);
+
+    // copy oldest record without removing it, return its size, 0 if empty
+    size_t peek (uint8_t* record) const;
+
+    // format record as text
+    void format (const uint8_t* record, Print& text) const;
+
+    // write oldest record, or as text the part of it the output takes without blocking, return bytes written
+    size_t writeNext (bool blocking);
+
+    // ring buffer, size is a power of two
+    std::array<uint8_t, config::Log::bufferSize> ring;
+    static_assert ((config::Log::bufferSize & (config::Log::bufferSize - 1)) == 0);
+
+    // free running positions, masked on access
+    size_t head; // write position
+    size_t tail; // read position
+
+    Print& out;
+
+    // formatted text of the oldest record already written
+    size_t written;
+
+    Level level;
+    uint32_t modules;
+
+    // next record starts a line
+    bool lineStart;
+
+    // drops since last dropped record, total
+    uint16_t dropped;
+    uint32_t droppedTotal;
+};
+
+// logger instance used by the DBG macros
+extern Logger logger;
+
+} // namespace imag::log
@@ -0,0 +1,216 @@
+/* imag_midi_usb.cpp
+ * 
+ * imagination sensor firmware
+ * usb midi output
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_midi_usb.h"
+#include "imag_debug.h"
+
+// redefine DBG output macros for this module only
+#if ! IMAG_MIDI_DEBUG
+#undef DBG
+#define DBG       ;
+#undef DBGLN
+#define DBGLN     ;
+#undef DBGN
+#define DBGN      ;
+#undef DBGNLN
+#define DBGNLN    ;
+#undef DBGHEX
+#define DBGHEX    ;
+#endif // #if ! IMAG_MIDI_DEBUG
+
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::midi
+
+namespace imag::midi
+{
+
+UsbMidi::UsbMidi()
+    : lastValues {},
+      lastValid (false),
+      lastRefresh (0),
+      wasConfigured (false)
+{}
+
+
+bool UsbMidi::sendRotation (const FixedQuaternion& rotation)
+{
+    const auto start = micros();
+
+    ++stats.samples;
+
+    // bypass entirely without host, resend everything once it appears
+    const auto configured = isConfigured();
+
+    if (configured != wasConfigured)
+    {
+        DBG("UsbMidi: usb "); DBGLN(configured ? "configured" : "not configured");
+        wasConfigured = configured;
+        lastValid = false;
+    }
+
+    if (! configured)
+    {
+        ++stats.bypassed;
+        return false;
+    }
+
+    // periodic full refresh for hosts (re)opening the port
+    if (Config::refreshInterval > 0 && millis() - lastRefresh >= Config::refreshInterval)
+        lastValid = false;
+
+    if (! lastValid)
+        lastRefresh = millis();
+
+    Buffer buffer;
+    const auto length = Config::format == Config::Format::sysex
+        ? packSysex (rotation, buffer)
+        : packControllers (rotation, buffer);
+
+    lastValid = true;
+
+    auto res = true;
+
+    if (length > 0)
+    {
+        res = MidiUSB.write (buffer.data(), length) == length;
+        MidiUSB.flush();
+
+        stats.packets += length / packetSize;
+        ++stats.messages;
+
+        // resend all on next sample
+        if (! res)
+            lastValid = false;
+    }
+
+    const auto duration = micros() - start;
+    stats.lastDuration = duration;
+    stats.maxDuration = std::max (stats.maxDuration, duration);
+    stats.sumDuration += duration;
+
+    return res;
+}
+
+
+size_t UsbMidi::packControllers (const FixedQuaternion& rotation, Buffer& buffer)
+{
+    const std::array<int32_t, 4> components { rotation.w, rotation.x, rotation.y, rotation.z };
+    size_t length = 0;
+
+    auto add = [&] (uint8_t cc, uint8_t value)
+    {
+        buffer[length++] = 0x0b; // cable 0, control change
+        buffer[length++] = 0xb0 | Config::channel;
+        buffer[length++] = cc;
+        buffer[length++] = value;
+    };
+
+    for (size_t i = 0; i < components.size(); ++i)
+    {
+        const auto value = FixedQuaternion::toMidi14 (components[i]);
+        const auto last = lastValues[i];
+
+        if (lastValid && value == last)
+            continue;
+
+        if (! lastValid || (value >> 7) != (last >> 7))
+            add (Config::coarseCc + i, value >> 7 & 0x7f);
+
+        add (Config::fineCc + i, value & 0x7f);
+
+        lastValues[i] = value;
+    }
+
+    return length;
+}
+
+
+UsbMidi::Values UsbMidi::toSysexValues (const FixedQuaternion& rotation)
+{
+    // offset binary, same mapping as toMidi14() at higher resolution
+    static constexpr auto shift = FixedQuaternion::fracBits + 1 - sysexBits;
+    static constexpr auto maxValue = (uint32_t (1) << sysexBits) - 1;
+
+    auto toValue = [] (int32_t c)
+    {
+        if (c <= -FixedQuaternion::one)
+            return uint32_t (0);
+
+        return std::min<uint32_t> ((uint32_t (c) + uint32_t (FixedQuaternion::one)) >> shift, maxValue);
+    };
+
+    return { toValue (rotation.w), toValue (rotation.x), toValue (rotation.y), toValue (rotation.z) };
+}
+
+
+size_t UsbMidi::packSysex (const Values& values, uint8_t device, uint8_t* packets)
+{
+    // sysex bytes
+    std::array<uint8_t, sysexLength> message;
+    size_t n = 0;
+
+    message[n++] = 0xf0;
+    message[n++] = sysexManufacturer;
+    message[n++] = sysexTag;
+    message[n++] = device & 0x7f;
+
+    for (auto value : values)
+    {
+        message[n++] = value >> 14 & 0x7f;
+        message[n++] = value >> 7 & 0x7f;
+        message[n++] = value & 0x7f;
+    }
+
+    message[n++] = 0xf7;
+
+    // usb midi event packets: 3 bytes each, code index 4 continues,
+    // 5/6/7 end with 1/2/3 bytes
+    size_t length = 0;
+
+    for (size_t i = 0; i < message.size(); i += 3)
+    {
+        const auto remaining = message.size() - i;
+        const auto count = std::min<size_t> (remaining, 3);
+
+        packets[length++] = remaining > 3 ? 0x04 : uint8_t (0x04 + count);
+
+        for (size_t k = 0; k < 3; ++k)
+            packets[length++] = k < count ? message[i + k] : 0;
+    }
+
+    return length;
+}
+
+
+size_t UsbMidi::packSysex (const FixedQuaternion& rotation, Buffer& buffer)
+{
+    const auto values = toSysexValues (rotation);
+
+    if (lastValid && values == lastValues)
+        return 0;
+
+    lastValues = values;
+
+    return packSysex (values, Config::sysexDeviceId, buffer.data());
+}
+
+
+void UsbMidi::printStats()
+{
+#if IMAG_MIDI_DEBUG
+    DBG("UsbMidi: samples : "); DBGNLN(stats.samples);
+    DBG("UsbMidi: bypassed: "); DBGNLN(stats.bypassed);
+    DBG("UsbMidi: packets : "); DBGNLN(stats.packets);
+    DBG("UsbMidi: packets per sent sample: "); DBGNLN(stats.messages > 0 ? float (stats.packets) / stats.messages : 0.0f);
+    DBG("UsbMidi: mean us : "); DBGNLN(stats.meanDuration());
+    DBG("UsbMidi: max us  : "); DBGNLN(stats.maxDuration);
+#endif // IMAG_MIDI_DEBUG
+}
+
+} // namespace imag::midi
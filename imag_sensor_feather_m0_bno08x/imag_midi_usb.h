@@ -0,0 +1,116 @@
+/* imag_midi_usb.h
+ * 
+ * imagination sensor firmware
+ * usb midi output
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <MIDIUSB.h>
+
+#include <array>
+#include <algorithm>
+
+#include "imag_fixed_quaternion.h"
+#include "imag_config.h"
+
+namespace imag::midi
+{
+// send timing and traffic statistics
+struct SendStats
+{
+    uint32_t samples = 0;  // rotations handed to sendRotation()
+    uint32_t bypassed = 0; // ... while usb was not configured
+    uint32_t packets = 0;  // midi event packets written
+    uint32_t messages = 0; // buffered writes
+    uint32_t lastDuration = 0; // [us]
+    uint32_t maxDuration = 0;  // [us]
+    uint64_t sumDuration = 0;  // [us]
+
+    uint32_t meanDuration() const { return samples > 0 ? uint32_t (sumDuration / samples) : 0; }
+};
+
+
+/* Rotation over usb midi, either as 14-bit controllers or as a single
+   sysex message (Config::format).
+
+   Controllers: all changed controllers of a sample are packed into a
+   single buffered write and flushed once, coarse (msb) controllers are
+   only repeated when they changed, which is valid as a receiver keeps
+   the msb when only the lsb arrives.
+
+   Sysex: F0 7D 49 <device> <w x y z, 3 bytes each> F7, each component
+   as 21-bit offset binary (0..2^21-1 for -1..1), msb first, 7 bits per
+   byte. Receivers get the quaternion atomically, at 6 usb midi packets.
+
+   Nothing is sent while the usb device is not configured by a host.
+*/
+class UsbMidi
+{
+public:
+    using Config = config::Midi;
+
+    // sysex framing
+    static constexpr uint8_t sysexManufacturer = 0x7d; // non-commercial
+    static constexpr uint8_t sysexTag = 0x49;          // 'I'
+    static constexpr auto sysexBits = 21;
+    static constexpr auto sysexLength = 4 + 4 * 3 + 1;
+    static constexpr auto sysexPacketsSize = (sysexLength + 2) / 3 * 4;
+
+    // component values, 14 bit in cc format, 21 bit in sysex format
+    using Values = std::array<uint32_t, 4>;
+
+    // sysex values of a rotation, clamped to 0..2^21-1
+    static Values toSysexValues (const FixedQuaternion& rotation);
+
+    // sysex message of values as usb midi event packets (sysexPacketsSize bytes), return length
+    static size_t packSysex (const Values& values, uint8_t device, uint8_t* packets);
+
+    // constructor
+    UsbMidi();
+
+    // usb enumerated by a host
+    bool isConfigured() { return USBDevice.configured(); }
+
+    // send rotation, true if sent or nothing to send, false if not configured or failed
+    bool sendRotation (const FixedQuaternion& rotation);
+
+    // force sending all controllers with next rotation
+    void invalidate() { lastValid = false; }
+
+    // statistics
+    const SendStats& getStats() const { return stats; }
+    void resetStats() { stats = {}; }
+
+    // debug printer
+    void printStats();
+
+private:
+    // 4 bytes per midi event packet, coarse and fine per component at most
+    static constexpr auto packetSize = 4;
+    static constexpr auto maxPackets = 8;
+    static_assert (sysexPacketsSize <= maxPackets * packetSize);
+
+    using Buffer = std::array<uint8_t, maxPackets * packetSize>;
+
+    // pack changed components into buffer, return length
+    size_t packControllers (const FixedQuaternion& rotation, Buffer& buffer);
+    size_t packSysex (const FixedQuaternion& rotation, Buffer& buffer);
+
+    // components last sent
+    Values lastValues;
+    bool lastValid;
+
+    // time of last full send [ms]
+    uint32_t lastRefresh;
+
+    // usb configured state of previous sample
+    bool wasConfigured;
+
+    SendStats stats;
+};
+
+} // namespace imag::midi
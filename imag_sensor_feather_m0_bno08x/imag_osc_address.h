@@ -12,8 +12,18 @@ namespace imag::osc
 {
 struct Address
 {
-    static constexpr auto none       { "/invalid" };
-    static constexpr auto rotation   { "/rot" };  // rotation as a quaternion: 4 floats [ i, j, k, r ]
+    static constexpr auto none               { "/invalid" };
+    static constexpr auto rotation           { "/rot" };  // rotation as a quaternion: 4 floats [ i, j, k, r ], host timetag of the sample while synchronised
+    static constexpr auto angularVelocity    { "/gyro" }; // calibrated angular velocity: 3 floats [ x, y, z ] rad/s
+    static constexpr auto linearAcceleration { "/lacc" }; // acceleration w/o gravity: 3 floats [ x, y, z ] m/s^2
+    static constexpr auto magneticField      { "/mag" };  // calibrated magnetic field: 3 floats [ x, y, z ] uT
+    static constexpr auto euler              { "/euler" };  // euler angles: 3 floats [ first, second, third rotation ] rad, see README
+    static constexpr auto matrix             { "/matrix" }; // rotation matrix: 9 floats, row-major
+    static constexpr auto stats              { "/stats" }; // loop stage timing query and reply (IMAG_PROFILE only)
+    static constexpr auto boot               { "/boot" };  // boot phase timing query and reply
+    static constexpr auto sync               { "/sync" };  // host clock synchronisation ping and reply
+    static constexpr auto watchdog           { "/watchdog" }; // sensor stall events and recovery times query and reply
+    static constexpr auto log                { "/log" };   // debug log filters: level, optional module and on/off (IMAG_DEBUG only)
 };
 
 } // namespace imag::osc
@@ -0,0 +1,121 @@
+/* imag_osc_usb_serial.cpp
+ * 
+ * imagination sensor firmware
+ * SLIP framed osc and binary output via usb serial
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_osc_usb_serial.h"
+
+namespace imag::osc
+{
+UsbSerial::UsbSerial (Serial_& newPort, Format newFormat, uint16_t rotationRate)
+    : port (newPort),
+      format (newFormat),
+      rotationInterval (rotationRate > 0 ? 1000000UL / rotationRate : 0),
+      lastRotation (0),
+      osc (oscMsgBuffer, oscMsgMaxArgs),
+      sequence (0),
+      dropped (0)
+{}
+
+
+bool UsbSerial::sendRotation (const char* oscAddress, const FixedQuaternion& quat)
+{
+    const auto now = micros();
+
+    // allow for some jitter of the sensor rate
+    if (rotationInterval > 0 && now - lastRotation < rotationInterval - rotationInterval / 8)
+        return true;
+
+    if (! isReadyToSend())
+        return false;
+
+    lastRotation = now;
+
+    if (format == Format::binary)
+    {
+        uint8_t frame[binaryRotationSize];
+        const std::array<int32_t, 4> values { quat.w, quat.x, quat.y, quat.z };
+
+        frame[0] = binaryRotation;
+        frame[1] = sequence++;
+        memcpy (frame + 2, &now, 4);
+        memcpy (frame + 6, values.data(), 4 * 4); // cortex-m0 is little endian
+
+        return writePacket (frame, sizeof (frame));
+    }
+
+    auto res = true;
+
+    // floats are assembled bitwise, no soft-float conversion involved
+    res &= osc.init (oscAddress);
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.x));
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.y));
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.z));
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.w));
+
+    return res && writePacket (osc.getMessageBuf(), osc.getMessageSize());
+}
+
+
+bool UsbSerial::sendVector (const char* oscAddress, const Vec3f& vec)
+{
+    if (format != Format::osc || ! isReadyToSend())
+        return false;
+
+    auto res = true;
+
+    res &= osc.init (oscAddress);
+    res &= osc.addFloat (vec.x);
+    res &= osc.addFloat (vec.y);
+    res &= osc.addFloat (vec.z);
+
+    return res && writePacket (osc.getMessageBuf(), osc.getMessageSize());
+}
+
+
+bool UsbSerial::writePacket (const uint8_t* data, size_t length)
+{
+    // worst case every byte escaped, plus both end markers
+    uint8_t buffer[2 * oscMsgBuffer + 2];
+    size_t n = 0;
+
+    if (2 * length + 2 > sizeof (buffer))
+        return false;
+
+    buffer[n++] = slipEnd;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        switch (data[i])
+        {
+        case slipEnd:
+            buffer[n++] = slipEsc;
+            buffer[n++] = slipEscEnd;
+            break;
+
+        case slipEsc:
+            buffer[n++] = slipEsc;
+            buffer[n++] = slipEscEsc;
+            break;
+
+        default:
+            buffer[n++] = data[i];
+        }
+    }
+
+    buffer[n++] = slipEnd;
+
+    // never block the sample path
+    if (port.availableForWrite() < int (n))
+    {
+        ++dropped;
+        return false;
+    }
+
+    return port.write (buffer, n) == n;
+}
+
+} // namespace imag::osc
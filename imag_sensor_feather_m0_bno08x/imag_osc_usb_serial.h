@@ -0,0 +1,91 @@
+/* imag_osc_usb_serial.h
+ * 
+ * imagination sensor firmware
+ * SLIP framed osc and binary output via usb serial
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LiteOSCParser.h>
+#include <Arduino_Helpers.h>
+#include <AH/Math/Quaternion.hpp>
+
+#include <array>
+
+#include "imag_fixed_quaternion.h"
+#include "imag_config.h"
+
+namespace imag::osc
+{
+/* Wired output via usb cdc serial, packets framed by SLIP (RFC 1055,
+   double ended as in OSC 1.1).
+
+   osc:     same messages as sent via WINC150x
+   binary:  'Q', sequence u8, timestamp u32 [us], w, x, y, z i32 Q30,
+            little endian, rotation only
+
+   Packets are only written while a host has the port open and if they
+   fit into the output buffer, otherwise they are dropped and counted.
+*/
+class UsbSerial
+{
+public:
+    using LiteOSCParser = qindesign::osc::LiteOSCParser;
+    using Format = config::UsbSerial::Format;
+
+    // osc message max dimensions
+    static constexpr auto oscMsgBuffer  = 128;
+    static constexpr auto oscMsgMaxArgs = 4;
+
+    // binary rotation frame
+    static constexpr uint8_t binaryRotation = 'Q';
+    static constexpr auto binaryRotationSize = 1 + 1 + 4 + 4 * 4;
+
+    // SLIP special bytes
+    static constexpr uint8_t slipEnd = 0xc0;
+    static constexpr uint8_t slipEsc = 0xdb;
+    static constexpr uint8_t slipEscEnd = 0xdc;
+    static constexpr uint8_t slipEscEsc = 0xdd;
+
+    // constructor
+    UsbSerial (Serial_& port, Format format = Format::osc, uint16_t rotationRate = 0);
+
+    // host has opened the port
+    bool isReadyToSend() { return port; }
+
+    // send rotation if due according to rotation rate
+    bool sendRotation (const char* oscAddress, const FixedQuaternion& quat);
+
+    // send vector, osc format only
+    bool sendVector (const char* oscAddress, const Vec3f& vec);
+
+    // packets dropped because the output buffer was full
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    // SLIP encode and write packet if it fits
+    bool writePacket (const uint8_t* data, size_t length);
+
+    // usb serial port
+    Serial_& port;
+
+    Format format;
+
+    // min time between rotations [us]
+    uint32_t rotationInterval;
+    uint32_t lastRotation;
+
+    // osc messaging object
+    LiteOSCParser osc;
+
+    // binary frame sequence
+    uint8_t sequence;
+
+    // dropped packets counter
+    uint32_t dropped;
+};
+
+} // namespace imag::osc
@@ -8,6 +8,8 @@
 
 #include "imag_osc_winc150x.h"
 
+#include <algorithm>
+
 // redefine DBG output macros for this module only
 #if ! IMAG_NET_DEBUG
 #undef DBG
@@ -22,15 +24,24 @@
 #define DBGHEX    ;
 #endif // #if ! IMAG_NET_DEBUG
 
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::net
+
 namespace imag::osc
 {
 WINC150x::WINC150x (const std::array<byte, 4>& newLocalAddr, short newLocalPort)
     : osc (oscMsgBuffer, oscMsgMaxArgs),
+      rxOsc (oscMsgBuffer, oscMsgMaxArgs),
       localAddr (IPAddress (newLocalAddr[0], newLocalAddr[1], newLocalAddr[2], newLocalAddr[3])),
       localPort (newLocalPort),
       state (WL_NO_SHIELD),
       readyToSend (false),
-      initDelayEnd (0)
+      initDelayEnd (0),
+      profile (PowerProfile::balanced),
+      rotationBatch (1),
+      rotationsHeld (0),
+      bundleSize (0)
 {
     // configure pins for Adafruit ATWINC1500 feather
     WiFi.setPins (8, 7, 4, 2);
@@ -54,8 +65,8 @@ bool WINC150x::init (const char* ssid, const char* key, uint8_t channel)
         return false;
     }
 
-    // low power mode
-    WiFi.lowPowerMode();
+    // power save mode of selected profile
+    setPowerProfile (profile);
 
     // indicate we are waiting for connection
     digitalWrite (LED_BUILTIN, HIGH);
@@ -113,6 +124,69 @@ void WINC150x::updateConnectionState()
 }
 
 
+void WINC150x::setPowerProfile (PowerProfile newProfile)
+{
+    profile = newProfile;
+
+    // radio is configured by init() if not present yet
+    const auto apply = state != WL_NO_SHIELD;
+
+    // listen interval is a station setting and does not apply in ap mode
+    switch (profile)
+    {
+    case PowerProfile::lowLatency:
+        if (apply)
+            WiFi.noLowPowerMode();
+        rotationBatch = 1;
+        DBGLN("WINC150x: power profile low latency");
+        break;
+
+    case PowerProfile::longestBattery:
+        if (apply)
+            WiFi.maxLowPowerMode();
+        rotationBatch = 2;
+        DBGLN("WINC150x: power profile longest battery");
+        break;
+
+    default:
+        if (apply)
+            WiFi.lowPowerMode();
+        rotationBatch = 1;
+        DBGLN("WINC150x: power profile balanced");
+        break;
+    }
+
+    // rotations held for the batch of the previous profile go out now
+    if (rotationsHeld > 0 && ! sendBundle())
+        DBGLN("WINC150x: sending held rotations failed");
+
+    rotationsHeld = 0;
+    bundleSize = 0;
+    sendStats[static_cast<size_t> (profile)].lastSend = 0;
+}
+
+
+void WINC150x::printSendStats()
+{
+#if IMAG_NET_DEBUG
+    static constexpr std::array<const char*, 3> names { "low latency", "balanced", "longest battery" };
+
+    for (size_t i = 0; i < sendStats.size(); ++i)
+    {
+        const auto& s = sendStats[i];
+
+        if (s.duration.getCount() == 0)
+            continue;
+
+        DBG("WINC150x: profile "); DBGN(names[i]); DBGLN(":");
+        DBG("WINC150x:   send call us mean/max : "); DBGN(s.duration.getMean()); DBG(" / "); DBGNLN(s.duration.getMax());
+        DBG("WINC150x:   interval us mean      : "); DBGNLN(s.interval.getMean());
+        DBG("WINC150x:   interval jitter us    : "); DBGNLN(s.interval.getStdDev());
+    }
+#endif // IMAG_NET_DEBUG
+}
+
+
 bool WINC150x::sendQuaternion (const char* oscAddress, const Quaternion& quat)
 {
     auto res = true;
@@ -136,6 +210,137 @@ bool WINC150x::sendQuaternion (const char* oscAddress, const Quaternion& quat)
 }
 
 
+bool WINC150x::sendQuaternion (const char* oscAddress, const FixedQuaternion& quat, uint64_t timetag)
+{
+    auto res = true;
+
+    // floats are assembled bitwise, no soft-float conversion involved
+    res &= osc.init (oscAddress);
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.x));
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.y));
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.z));
+    res &= osc.addFloat (FixedQuaternion::toFloat (quat.w));
+
+    if (timetag != 0)
+        res &= osc.addTime (timetag);
+
+    if (! res)
+    {
+        DBGLN("WINC150x::sendQuaternion(): Error constructing OSC message");
+        return false;
+    }
+
+    // batching of power profile, every rotation is sent as message of its own bundle
+    if (rotationBatch > 1)
+    {
+        if (! addToBundle())
+        {
+            DBGLN("WINC150x::sendQuaternion(): Error constructing OSC bundle");
+            rotationsHeld = 0;
+            bundleSize = 0;
+            return false;
+        }
+
+        if (++rotationsHeld < rotationBatch)
+            return true;
+
+        rotationsHeld = 0;
+    }
+
+    auto& profileStats = sendStats[static_cast<size_t> (profile)];
+    const auto start = micros();
+
+    if (! (res = rotationBatch > 1 ? sendBundle() : sendOsc()))
+        DBGLN("WINC150x::sendQuaternion(): Sending osc message failed");
+
+    // send timing of rotation path
+    const auto end = micros();
+    profileStats.duration.add (end - start);
+
+    if (profileStats.lastSend != 0)
+        profileStats.interval.add (start - profileStats.lastSend);
+
+    profileStats.lastSend = start;
+
+    return res;
+}
+
+
+bool WINC150x::sendVector (const char* oscAddress, const Vec3f& vec)
+{
+    auto res = true;
+    
+    res &= osc.init (oscAddress);
+    res &= osc.addFloat (vec.x);
+    res &= osc.addFloat (vec.y);
+    res &= osc.addFloat (vec.z);
+
+    if (! res)
+    {
+        DBGLN("WINC150x::sendVector(): Error constructing OSC message");
+        return false;
+    }
+
+    if (! (res = sendOsc()))
+        DBGLN("WINC150x::sendVector(): Sending osc message failed");
+
+    return res;
+}
+
+
+bool WINC150x::sendMatrix (const char* oscAddress, const std::array<int32_t, 9>& matrix)
+{
+    auto res = true;
+
+    // floats are assembled bitwise, no soft-float conversion involved
+    res &= osc.init (oscAddress);
+
+    for (const auto element : matrix)
+        res &= osc.addFloat (FixedQuaternion::toFloat (element));
+
+    if (! res)
+    {
+        DBGLN("WINC150x::sendMatrix(): Error constructing OSC message");
+        return false;
+    }
+
+    if (! (res = sendOsc()))
+        DBGLN("WINC150x::sendMatrix(): Sending osc message failed");
+
+    return res;
+}
+
+
+const WINC150x::LiteOSCParser* WINC150x::receive()
+{
+    if (! isReadyToSend())
+        return nullptr;
+
+    const auto size = udp.parsePacket();
+
+    if (size <= 0)
+        return nullptr;
+
+    // the rest of an oversized packet is discarded by the next parsePacket()
+    if (size > oscMsgBuffer)
+    {
+        DBGLN("WINC150x: received packet too large");
+        return nullptr;
+    }
+
+    uint8_t buffer[oscMsgBuffer];
+    const auto length = udp.read (buffer, size);
+
+    if (length <= 0 || ! rxOsc.parse (buffer, length))
+    {
+        DBGLN("WINC150x: received invalid osc message");
+        return nullptr;
+    }
+
+    return &rxOsc;
+}
+
+
 bool WINC150x::sendOsc()
 {
     if (! isReadyToSend())
@@ -154,6 +359,53 @@ bool WINC150x::sendOsc()
 }
 
 
+bool WINC150x::addToBundle()
+{
+    const auto size = uint32_t (osc.getMessageSize());
+
+    // header: "#bundle", timetag 1 for immediately, messages carry their own
+    if (bundleSize == 0)
+    {
+        static constexpr std::array<uint8_t, 16> header { '#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+        std::copy (header.begin(), header.end(), bundle.begin());
+        bundleSize = header.size();
+    }
+
+    if (bundleSize + 4 + size > bundle.size())
+        return false;
+
+    // element: big endian size, message
+    for (auto shift : { 24, 16, 8, 0 })
+        bundle[bundleSize++] = uint8_t (size >> shift);
+
+    std::copy_n (osc.getMessageBuf(), size, bundle.begin() + bundleSize);
+    bundleSize += size;
+
+    return true;
+}
+
+
+bool WINC150x::sendBundle()
+{
+    const auto size = bundleSize;
+    bundleSize = 0;
+
+    if (! isReadyToSend())
+    {
+        DBGLN("WINC150x: cannot send osc bundle: no peer connected");
+        return false;
+    }
+
+    if (udp.beginPacket (targetAddr, targetPort) &&
+        udp.write (bundle.data(), size) == size &&
+        udp.endPacket())
+        return true;
+
+    DBGLN("WINC150x: sending osc bundle failed");
+    return false;
+}
+
+
 void WINC150x::printWifiStatus() const
 {
     // print the SSID of the network you're attached to:
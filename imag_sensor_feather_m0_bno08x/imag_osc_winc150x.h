@@ -17,9 +17,28 @@
 #include <array>
 
 #include "imag_debug.h"
+#include "imag_fixed_quaternion.h"
+#include "imag_stats.h"
+#include "imag_config.h"
 
 namespace imag::osc
 {
+// wifi power profile
+using PowerProfile = config::Net::PowerProfile;
+
+// send statistics of a power profile [us], taken on the sensor
+/* duration is the time the udp send call blocks the loop, not the
+   delivery latency to the host, which the sensor cannot observe.
+   Integer sums per send, floats only when printed.
+*/
+struct SendStats
+{
+    stats::IntegerSummary duration; // udp send call
+    stats::IntegerSummary interval; // between rotation sends, deviation is the jitter
+    uint32_t lastSend = 0;
+};
+
+
 class WINC150x
 {
 public:
@@ -27,7 +46,10 @@ public:
 
     // osc message max dimensions
     static constexpr auto oscMsgBuffer  = 256;
-    static constexpr auto oscMsgMaxArgs = 8;
+    static constexpr auto oscMsgMaxArgs = 9;
+
+    // osc bundle of batched rotations, two rotation messages with timetag
+    static constexpr auto oscBundleBuffer = 128;
 
     // init delay for settling wifi after connection
     static constexpr auto initDelay = 1000; // 1s
@@ -50,6 +72,15 @@ public:
     // get connection state
     bool isConnected() const { return state == WL_AP_CONNECTED; }
 
+    // select wifi power profile, takes effect immediately if initialised
+    void setPowerProfile (PowerProfile newProfile);
+    PowerProfile getPowerProfile() const { return profile; }
+
+    // send statistics per power profile, kept across profile changes
+    const SendStats& getSendStats (PowerProfile p) const { return sendStats[static_cast<size_t> (p)]; }
+    void resetSendStats() { sendStats = {}; }
+    void printSendStats();
+
     // get ready to send flag
     bool isReadyToSend() const { return readyToSend; }
     
@@ -62,11 +93,29 @@ public:
 
     // osc message sending methods
     bool sendQuaternion (const char* oscAddress, const Quaternion& quat);
+    // timetag appended if not 0, true if sent or held for batching, see isRotationSent()
+    bool sendQuaternion (const char* oscAddress, const FixedQuaternion& quat, uint64_t timetag = 0);
+    bool sendVector (const char* oscAddress, const Vec3f& vec);
+    bool sendMatrix (const char* oscAddress, const std::array<int32_t, 9>& matrix); // row-major, Q30
+
+    // last rotation was sent, i.e. not held for the batch of the power profile
+    bool isRotationSent() const { return rotationsHeld == 0; }
+
+    // generic osc message sending: add arguments to message returned by beginMessage(), then sendMessage()
+    LiteOSCParser& beginMessage (const char* oscAddress) { osc.init (oscAddress); return osc; }
+    bool sendMessage() { return sendOsc(); }
+
+    // poll for a received osc message, nullptr if none
+    const LiteOSCParser* receive();
 
 private:
     // send current state of osc messaging member
     bool sendOsc();
 
+    // add current osc message to the bundle, send bundle of held messages
+    bool addToBundle();
+    bool sendBundle();
+
     // init delay helpers
     void startInitDelay() { initDelayEnd = millis() + initDelay; }
     bool isInitDelayOver() const { return millis() > initDelayEnd; }
@@ -78,6 +127,9 @@ private:
     // osc messaging object
     LiteOSCParser osc;
 
+    // received osc message
+    LiteOSCParser rxOsc;
+
     // wifi udp object
     WiFiUDP udp;
 
@@ -101,5 +153,16 @@ private:
 
     // timestamp for init delay end
     uint32_t initDelayEnd;
+
+    // power profile and rotation batching (rotations per packet)
+    PowerProfile profile;
+    uint8_t rotationBatch;
+    uint8_t rotationsHeld;
+
+    // osc bundle of held rotations, size 0 if none
+    std::array<uint8_t, oscBundleBuffer> bundle;
+    size_t bundleSize;
+
+    std::array<SendStats, static_cast<size_t> (PowerProfile::totalNum)> sendStats;
 };
 } // namespace imag::osc
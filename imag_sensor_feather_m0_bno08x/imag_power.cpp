@@ -0,0 +1,94 @@
+/* imag_power.cpp
+ * 
+ * imagination sensor firmware
+ * cpu idle and duty cycle accounting
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_power.h"
+#include "imag_debug.h"
+
+#include <algorithm>
+
+// redefine DBG output macros for this module only
+#if ! IMAG_POWER_DEBUG
+#undef DBG
+#define DBG       ;
+#undef DBGLN
+#define DBGLN     ;
+#undef DBGN
+#define DBGN      ;
+#undef DBGNLN
+#define DBGNLN    ;
+#undef DBGHEX
+#define DBGHEX    ;
+#endif // #if ! IMAG_POWER_DEBUG
+
+// log records of this module
+#undef IMAG_LOG_MODULE
+#define IMAG_LOG_MODULE imag::log::Module::power
+
+namespace imag
+{
+namespace
+{
+// wakeup only, the waiting code checks the pin
+void wakeupHandler() {}
+} // namespace
+
+
+Power::Power()
+{
+    reset();
+}
+
+
+void Power::attachWakeup (uint8_t pin)
+{
+    attachInterrupt (digitalPinToInterrupt (pin), wakeupHandler, FALLING);
+}
+
+
+float Power::getDutyCycle() const
+{
+    const auto elapsed = micros() - windowStart;
+
+    if (elapsed == 0)
+        return 1.0f;
+
+    return 1.0f - float (std::min (idleTime, elapsed)) / elapsed;
+}
+
+
+float Power::getChargePerSample() const
+{
+    if (samples == 0)
+        return 0.0f;
+
+    const auto elapsed = micros() - windowStart;
+    const auto idle = std::min (idleTime, elapsed);
+
+    // mA * us = nC
+    return ((elapsed - idle) * Config::activeCurrent + idle * Config::idleCurrent) / samples / 1000.0f;
+}
+
+
+void Power::reset()
+{
+    windowStart = micros();
+    idleTime = 0;
+    samples = 0;
+}
+
+
+void Power::printDutyCycle()
+{
+#if IMAG_POWER_DEBUG
+    DBG("Power: samples     : "); DBGNLN(samples);
+    DBG("Power: active %    : "); DBGNLN(getDutyCycle() * 100.0f);
+    DBG("Power: uC per sample: "); DBGNLN(getChargePerSample());
+#endif // IMAG_POWER_DEBUG
+}
+
+} // namespace imag
@@ -0,0 +1,90 @@
+/* imag_power.h
+ * 
+ * imagination sensor firmware
+ * cpu idle and duty cycle accounting
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "imag_config.h"
+
+namespace imag
+{
+/* Sleeps the cpu (WFI, idle mode) while waiting for an event. Any
+   interrupt wakes it: the sensor interrupt pin attached via
+   attachWakeup(), the wifi chip, usb and the 1 ms systick, which keeps
+   millis() and button polling going. The wait condition is checked with
+   interrupts masked, so a wakeup arriving right before the WFI is not
+   missed and no latency is added.
+
+   Time spent waiting is accounted as idle, all other time as active.
+*/
+class Power
+{
+public:
+    using Config = config::Power;
+
+    // constructor
+    Power();
+
+    // let a falling edge on pin wake the cpu
+    void attachWakeup (uint8_t pin);
+
+    // sleep until ready() returns true or timeout [us] passed, false on timeout
+    template <typename Ready>
+    bool waitUntil (Ready ready, uint32_t timeout = UINT32_MAX)
+    {
+        const auto start = micros();
+        auto res = true;
+
+        // the systick ends the WFI at least every ms, bounding the timeout overshoot
+        while (! (res = ready()) && micros() - start < timeout)
+        {
+            if (! Config::sleepWhileWaiting)
+                continue;
+
+            __disable_irq();
+
+            // a pending interrupt still ends the WFI with interrupts masked
+            if (! ready())
+                __WFI();
+
+            __enable_irq();
+        }
+
+        idleTime += micros() - start;
+
+        return res;
+    }
+
+    // count a processed sample for per sample figures
+    void addSample() { ++samples; }
+
+    // active share of time since last reset, 0..1
+    float getDutyCycle() const;
+
+    // estimated mcu charge per sample since last reset [uC]
+    float getChargePerSample() const;
+
+    // restart accounting
+    void reset();
+
+    // debug printer
+    void printDutyCycle();
+
+private:
+    // accounting window start [us]
+    uint32_t windowStart;
+
+    // time spent in waitUntil() [us]
+    uint32_t idleTime;
+
+    // samples in window
+    uint32_t samples;
+};
+
+} // namespace imag
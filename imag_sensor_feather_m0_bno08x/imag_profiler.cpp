@@ -0,0 +1,85 @@
+/* imag_profiler.cpp
+ * 
+ * imagination sensor firmware
+ * per-stage loop profiler
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_profiler.h"
+#include "imag_debug.h"
+
+#if IMAG_PROFILE
+
+namespace imag
+{
+
+Profiler profiler;
+
+
+Profiler::Profiler()
+    : current {}
+{
+}
+
+
+void Profiler::endLoop (uint32_t loopStart)
+{
+    current[static_cast<size_t> (Stage::loop)] = micros() - loopStart;
+
+    for (size_t i = 0; i < stageNum; ++i)
+    {
+        auto& s = stageStats[i];
+        const auto duration = current[i];
+
+        s.duration.add (duration);
+
+        // bin n: below 2^n us
+        const auto bin = duration == 0 ? 0 : std::min<size_t> (32 - __builtin_clz (duration), bins - 1);
+
+        if (s.histogram[bin] < UINT16_MAX)
+            ++s.histogram[bin];
+
+        current[i] = 0;
+    }
+}
+
+
+void Profiler::reset()
+{
+    for (auto& s : stageStats)
+    {
+        s.duration.reset();
+        s.histogram.fill (0);
+    }
+}
+
+
+const char* Profiler::getName (Stage stage)
+{
+    static constexpr std::array<const char*, stageNum> names {
+        "connection", "buttons", "display", "battery", "imu", "midi", "osc", "wired", "log", "loop"
+    };
+
+    return names[static_cast<size_t> (stage)];
+}
+
+
+void Profiler::printStats()
+{
+#if IMAG_DEBUG
+    DBGLN("Profiler: stage us min / mean / max");
+
+    for (size_t i = 0; i < stageNum; ++i)
+    {
+        const auto& s = stageStats[i].duration;
+
+        DBG("Profiler: "); DBGN(getName (Stage (i))); DBG(" ");
+        DBGN(s.getMin()); DBG(" / "); DBGN(s.getMean()); DBG(" / "); DBGNLN(s.getMax());
+    }
+#endif // IMAG_DEBUG
+}
+
+} // namespace imag
+
+#endif // IMAG_PROFILE
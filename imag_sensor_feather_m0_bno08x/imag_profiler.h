@@ -0,0 +1,140 @@
+/* imag_profiler.h
+ * 
+ * imagination sensor firmware
+ * per-stage loop profiler
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <type_traits>
+
+#include "imag_stats.h"
+#include "imag_config.h"
+
+// measure an expression as loop stage, evaluates to its result
+// compiles to the plain expression without IMAG_PROFILE
+#if IMAG_PROFILE
+#define PROFILE(STAGE, ...)  imag::profiler.measure (imag::Profiler::Stage::STAGE, [&] { return __VA_ARGS__; })
+#define PROFILE_LOOP(START)  imag::profiler.endLoop (START)
+#else
+#define PROFILE(STAGE, ...)  (__VA_ARGS__)
+#define PROFILE_LOOP(START)  ;
+#endif // IMAG_PROFILE
+
+namespace imag
+{
+/* Loop stage timing based on micros(). Stage times are summed per loop
+   cycle, so a stage measured several times per cycle (e.g. one imu read
+   per report) counts once with its total. endLoop() adds the cycle
+   totals, including zeros of stages that did not run, to the per-stage
+   statistics and histograms. These are integer sums and counts, floats
+   are computed only when /stats is queried or the figures are printed.
+
+   histogram bin n counts cycles with stage time below 2^n us, the last
+   bin all longer ones.
+
+   osc reply to /stats, one message per stage:
+     /stats s:stage i:cycles f:min f:mean f:max f:stddev [us] b:histogram (u16 per bin, little endian)
+*/
+class Profiler
+{
+public:
+    enum class Stage : uint8_t
+    {
+        connection, buttons, display, battery, imu, midi, osc, wired, log,
+        loop, // active part of loop cycle, excluding the wait for the sensor
+        totalNum
+    };
+
+    static constexpr size_t bins = 16;
+
+    struct StageStats
+    {
+        stats::IntegerSummary duration;
+        std::array<uint16_t, bins> histogram {};
+    };
+
+    // constructor
+    Profiler();
+
+    // call f, add its duration to stage, return its result
+    template <typename F>
+    auto measure (Stage stage, F f)
+    {
+        const auto start = micros();
+
+        if constexpr (std::is_void_v<decltype (f())>)
+        {
+            f();
+            current[static_cast<size_t> (stage)] += micros() - start;
+        }
+        else
+        {
+            const auto res = f();
+            current[static_cast<size_t> (stage)] += micros() - start;
+            return res;
+        }
+    }
+
+    // add stage totals of this cycle to statistics, loop stage from loopStart [us]
+    void endLoop (uint32_t loopStart);
+
+    // accumulated statistics since last reset
+    const StageStats& getStats (Stage stage) const { return stageStats[static_cast<size_t> (stage)]; }
+    void reset();
+
+    static const char* getName (Stage stage);
+
+    // send one /stats message per stage via osc sender, e.g. WINC150x
+    template <typename Sender>
+    bool sendStats (Sender& sender, const char* oscAddress)
+    {
+        auto res = true;
+
+        for (size_t i = 0; i < stageStats.size(); ++i)
+        {
+            const auto& s = stageStats[i];
+            auto& msg = sender.beginMessage (oscAddress);
+
+            std::array<uint8_t, bins * 2> histogram;
+
+            for (size_t b = 0; b < bins; ++b)
+            {
+                histogram[2 * b] = s.histogram[b] & 0xff;
+                histogram[2 * b + 1] = s.histogram[b] >> 8;
+            }
+
+            res &= msg.addString (getName (Stage (i)));
+            res &= msg.addInt (s.duration.getCount());
+            res &= msg.addFloat (float (s.duration.getMin()));
+            res &= msg.addFloat (s.duration.getMean());
+            res &= msg.addFloat (float (s.duration.getMax()));
+            res &= msg.addFloat (s.duration.getStdDev());
+            res &= msg.addBlob (histogram.data(), histogram.size());
+            res &= sender.sendMessage();
+        }
+
+        return res;
+    }
+
+    // debug printer
+    void printStats();
+
+private:
+    static constexpr auto stageNum = static_cast<size_t> (Stage::totalNum);
+
+    // stage times of current cycle [us]
+    std::array<uint32_t, stageNum> current;
+
+    std::array<StageStats, stageNum> stageStats;
+};
+
+// profiler instance used by the PROFILE macros
+extern Profiler profiler;
+
+} // namespace imag
@@ -0,0 +1,116 @@
+/* imag_rotation_formats.cpp
+ * 
+ * imagination sensor firmware
+ * lazily computed alternative rotation formats
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_rotation_formats.h"
+
+#include <algorithm>
+
+namespace imag
+{
+
+namespace
+{
+// axes of each euler order, first to last rotation
+constexpr std::array<std::array<uint8_t, 3>, 6> eulerAxes { {
+    { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+} };
+
+// product of two Q30 components
+inline int32_t product (int32_t a, int32_t b)
+{
+    return int32_t ((int64_t (a) * b) >> FixedQuaternion::fracBits);
+}
+
+// clamp to +-1, rounding may leave elements slightly outside
+inline int32_t clampUnit (int64_t value)
+{
+    return int32_t (std::clamp<int64_t> (value, -FixedQuaternion::one, FixedQuaternion::one));
+}
+} // namespace
+
+
+void RotationFormats::updateProducts()
+{
+    if (cached & productsBit)
+        return;
+
+    const auto& q = rotation;
+
+    squares = { product (q.x, q.x), product (q.y, q.y), product (q.z, q.z) };
+    cross = { product (q.y, q.z), product (q.x, q.z), product (q.x, q.y) };
+    withW = { product (q.w, q.x), product (q.w, q.y), product (q.w, q.z) };
+
+    cached |= productsBit;
+}
+
+
+int32_t RotationFormats::getElement (int row, int col)
+{
+    if (cached & matrixBit)
+        return matrix[3 * row + col];
+
+    updateProducts();
+
+    // diagonal: 1 - 2 (squares of the other axes)
+    if (row == col)
+        return clampUnit (int64_t (FixedQuaternion::one)
+                          - 2 * (int64_t (squares[(row + 1) % 3]) + squares[(row + 2) % 3]));
+
+    // off-diagonal: 2 (cross -+ w * third axis), minus above the cyclic diagonal (01, 12, 20)
+    const auto axis = 3 - row - col;
+    const auto sign = col == (row + 1) % 3 ? -1 : 1;
+
+    return clampUnit (2 * (int64_t (cross[axis]) + sign * int64_t (withW[axis])));
+}
+
+
+const RotationFormats::Matrix& RotationFormats::getMatrix()
+{
+    if (cached & matrixBit)
+        return matrix;
+
+    for (auto row = 0; row < 3; ++row)
+    {
+        for (auto col = 0; col < 3; ++col)
+            matrix[3 * row + col] = getElement (row, col);
+    }
+
+    cached |= matrixBit;
+
+    return matrix;
+}
+
+
+const RotationFormats::Angles& RotationFormats::getEuler (EulerOrder order)
+{
+    if ((cached & eulerBit) && order == eulerOrder)
+        return euler;
+
+    const auto& axes = eulerAxes[static_cast<size_t> (order)];
+    const auto a = axes[0], b = axes[1], c = axes[2];
+
+    // sign of the cyclic orders xyz, yzx, zxy
+    const auto cyclic = b == (a + 1) % 3;
+    const auto s = cyclic ? 1 : -1;
+
+    // elements are within +-1, so all terms fit int32
+    const auto ac = getElement (a, c);
+    const auto aa = getElement (a, a);
+    const auto ab = getElement (a, b);
+
+    euler[0] = trig::atan2 (-s * getElement (b, c), getElement (c, c));
+    euler[1] = trig::atan2 (s * ac, int32_t (trig::hypot (aa, ab)));
+    euler[2] = trig::atan2 (-s * ab, aa);
+
+    eulerOrder = order;
+    cached |= eulerBit;
+
+    return euler;
+}
+
+} // namespace imag
@@ -0,0 +1,72 @@
+/* imag_rotation_formats.h
+ * 
+ * imagination sensor firmware
+ * lazily computed alternative rotation formats
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+
+#include "imag_fixed_quaternion.h"
+#include "imag_trig.h"
+#include "imag_config.h"
+
+namespace imag
+{
+/* Euler angles and rotation matrix of the current rotation sample. Nothing
+   is computed before a format is requested, the quaternion products all
+   formats are built from are computed once per sample and shared. Integer
+   only, matrix elements are Q30 like the quaternion components, angles are
+   binary angles of the trig tables.
+
+   The matrix maps sensor to world frame (v_world = R v_sensor). Euler
+   angles are intrinsic, in the order given, e.g. zyx is yaw, pitch, roll
+   with the yaw of trig::yaw(). Near gimbal lock (second angle at +-90 deg)
+   the first and third angle are not determined and get noisy.
+*/
+class RotationFormats
+{
+public:
+    using EulerOrder = config::Stream::EulerOrder;
+    using Matrix = std::array<int32_t, 9>;      // row-major, Q30
+    using Angles = std::array<trig::Angle, 3>;  // in rotation order
+
+    // set rotation of a new sample, drops all cached results
+    void setRotation (const FixedQuaternion& q) { rotation = q; cached = 0; }
+
+    // rotation matrix
+    const Matrix& getMatrix();
+
+    // euler angles, cached for the last order requested
+    const Angles& getEuler (EulerOrder order);
+
+private:
+    // cached results
+    enum : uint8_t { productsBit = 1, matrixBit = 2, eulerBit = 4 };
+
+    // quaternion products, once per sample
+    void updateProducts();
+
+    // matrix element, from the matrix if cached
+    int32_t getElement (int row, int col);
+
+    FixedQuaternion rotation;
+    uint8_t cached = 0;
+
+    // products of quaternion components, Q30, indexed by axis:
+    // squares xx yy zz, cross terms of the other two axes yz xz xy, with w: wx wy wz
+    std::array<int32_t, 3> squares;
+    std::array<int32_t, 3> cross;
+    std::array<int32_t, 3> withW;
+
+    Matrix matrix;
+    Angles euler;
+    EulerOrder eulerOrder = EulerOrder::zyx;
+};
+
+} // namespace imag
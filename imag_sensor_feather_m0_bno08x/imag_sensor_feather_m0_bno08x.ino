@@ -9,30 +9,63 @@
 #include "imag_config.h"
 #include "imag_debug.h"
 #include "imag_osc_address.h"
-#include "imag_smoother.h"
+#include "imag_stats.h"
 #include "imag_battery.h"
-
-#include "imag_imu_bno08x.h"
+#include "imag_power.h"
+#include "imag_capture.h"
+#include "imag_profiler.h"
+#include "imag_boot.h"
+#include "imag_rotation_formats.h"
+#include "imag_clock_sync.h"
+
+#include "imag_imu.h"
+#include "imag_imu_watchdog.h"
+#include "imag_imu_adaptive_rate.h"
 #include "imag_osc_winc150x.h"
 #include "imag_display_sh1107.h"
+#include "imag_midi_usb.h"
+#include "imag_osc_usb_serial.h"
 
-#include <MIDIUSB.h>
 #include <EasyButton.h>
 
+#include <algorithm>
+
 // string constants
 static const String versionString { String (imag::config::versionMajor) + "." + imag::config::versionMinor + "." + imag::config::versionSub };
 static const String ssid { String (imag::config::WiFi::ssid) + "_" + imag::config::sensorIndex };
 
 // members
-imag::imu::BNO08x imu { imag::config::BNO08x::resetPin, imag::config::BNO08x::intPin };
+imag::imu::Imu imu = imag::imu::createImu();
 
 const auto localAddr = imag::config::Net::localIP;
 imag::osc::WINC150x net { localAddr, imag::config::Net::localPort };
 
 imag::display::SH1107 oled { &Wire };
 
+imag::midi::UsbMidi midi;
+
 imag::Battery battery { imag::config::Battery::pin, true };
 
+imag::Power power;
+
+imag::imu::Watchdog imuWatchdog;
+
+imag::imu::AdaptiveRate adaptiveRate;
+
+// idle rotation samples have to keep feeding the watchdog, a few periods within its stall timeout
+static_assert (! imag::config::Stream::adaptiveRate ||
+               4000u / imag::config::Stream::idleRotationRate < imag::config::Imu::stallTimeout,
+               "idle rotation rate too low for the sensor stall timeout");
+
+#if IMAG_CAPTURE
+static_assert (! IMAG_DEBUG, "capture and debug output share the serial port");
+imag::Capture capture { Serial };
+#endif // IMAG_CAPTURE
+
+static_assert (! imag::config::UsbSerial::enabled || ! (IMAG_DEBUG || IMAG_CAPTURE),
+               "wired output, capture and debug output share the serial port");
+imag::osc::UsbSerial wired { Serial, imag::config::UsbSerial::format, imag::config::UsbSerial::rotationRate };
+
 // buttons
 EasyButton buttonA (imag::config::Button::pinA, imag::config::Button::debounce, true, true);
 EasyButton buttonB (imag::config::Button::pinB, imag::config::Button::debounce, true, true);
@@ -42,7 +75,43 @@ EasyButton buttonC (imag::config::Button::pinC, imag::config::Button::debounce,
 static const std::array<EasyButton*, 3> buttons { { &buttonA, &buttonB, &buttonC } };
 
 // sensor data types
-static constexpr auto primaryDataType = imag::imu::DataType::rotationArvr;
+static constexpr auto primaryDataType = imag::config::BNO08x::softwareFusion
+    ? imag::imu::DataType::rotationSoft
+    : imag::imu::DataType::rotationArvr;
+
+// additional vector report streams, sent via osc only
+struct VectorStream
+{
+    imag::imu::DataType type;
+    const char* address;
+    uint16_t rate;
+
+    // latest value received, sent once per loop cycle
+    Vec3f value;
+    bool pending;
+};
+
+static std::array<VectorStream, 3> vectorStreams {
+    {
+        { imag::imu::DataType::gyro, imag::osc::Address::angularVelocity, imag::config::Stream::angularVelocityRate, {}, false },
+        { imag::imu::DataType::linearAccel, imag::osc::Address::linearAcceleration, imag::config::Stream::linearAccelerationRate, {}, false },
+        { imag::imu::DataType::mag, imag::osc::Address::magneticField, imag::config::Stream::magneticFieldRate, {}, false }
+    }
+};
+
+// alternative rotation formats, computed only while subscribed, sent via wifi osc only
+struct FormatSubscriptions
+{
+    bool euler;
+    imag::config::Stream::EulerOrder eulerOrder;
+    bool matrix;
+};
+
+static FormatSubscriptions formatSubscriptions { imag::config::Stream::euler, imag::config::Stream::eulerOrder, imag::config::Stream::matrix };
+static imag::RotationFormats rotationFormats;
+
+// euler order names, as config::Stream::EulerOrder
+static constexpr std::array<const char*, 6> eulerOrderNames { { "xyz", "xzy", "yxz", "yzx", "zxy", "zyx" } };
 
 // sensor mounting orientation/output conventions
 static const std::array<const Quaternion, 2> sensorOrientations {
@@ -60,13 +129,13 @@ static_assert (sensorOrientations.size() == imag::display::Message::Main::orient
 // current orientation mode
 uint8_t orientationMode = 0;
 
-// custom north offset
+// custom north, i.e. heading tare on sensor
 bool customNorth = false;
-Quaternion customNorthOffset = Quaternion::identity();
 
-// reliability && accuracy smoothers
+// reliability && accuracy smoothers, display only
 static constexpr auto smoothLen = 100;
-static imag::Smoother<float, smoothLen> reliability, accuracy;
+static auto reliability = imag::stats::ExpMean<float>::fromLength (smoothLen);
+static auto accuracy = imag::stats::ExpMean<float>::fromLength (smoothLen);
 
 void attachButtonsNorm();
 void attachButtonsCalibration();
@@ -116,6 +185,13 @@ void cycleOrientationMode()
     // rotate mode
     orientationMode = ++orientationMode % sensorOrientations.size();
     imu.setReorientation (sensorOrientations[orientationMode]);
+
+    // new reorientation drops custom north, so persist that as well
+    if (customNorth)
+    {
+        imu.saveTare();
+        customNorth = false;
+    }
 }
 
 
@@ -124,16 +200,11 @@ void setReorientation()
     if (oled.setEnabled (true))
         return;
 
-    if (imag::imu::isAnyRotationDataType (imu.getLastDataType()))
+    // heading (z-axis) only tare on sensor, persisted across power cycles
+    if (imag::imu::isAnyRotationDataType (imu.getLastDataType()) &&
+        imu.setTareHeading())
     {
-        Quaternion current;
-
-        imu.getLastData (current);
-
-        // leave only z-rotation
-        // TODO
-
-        customNorthOffset = -current;
+        imu.saveTare();
         customNorth = true;
     }
 }
@@ -144,8 +215,11 @@ void resetReorientation()
     if (oled.setEnabled (true))
         return;
   
-    customNorthOffset = Quaternion::identity();
-    customNorth = false;
+    if (imu.resetTare())
+    {
+        imu.saveTare();
+        customNorth = false;
+    }
 }
 
 
@@ -155,14 +229,49 @@ void toggleDisplay()
 }
 
 
+// wifi power profile selected by user, low battery policy may override it
+auto powerProfile = imag::config::Net::powerProfile;
+
+// low battery policy active
+static bool lowPowerActive = false;
+
+void cyclePowerProfile()
+{
+    if (oled.setEnabled (true))
+        return;
+
+    using Profile = imag::osc::PowerProfile;
+    powerProfile = static_cast<Profile> ((static_cast<uint8_t> (powerProfile) + 1) % static_cast<uint8_t> (Profile::totalNum));
+
+    // the policy keeps longest battery, the selection applies once it ends
+    if (lowPowerActive)
+    {
+        LOGI("Power profile kept by low battery policy");
+        return;
+    }
+
+    net.setPowerProfile (powerProfile);
+}
+
+
 void nop() {}
 
 
+void readButtons()
+{
+    for (auto* button : buttons)
+        button->read();
+}
+
+
 // attach buttons, normal mode
 void attachButtonsNorm()
 {
     buttonA.onPressed (toggleDisplay);
 
+    if constexpr (! imag::config::guidedAccess)
+        buttonA.onPressedFor (2000, cyclePowerProfile);
+
     if constexpr (imag::config::guidedAccess)
     {
         buttonB.onPressed (resetReorientation);
@@ -194,87 +303,326 @@ void attachButtonsCalibration()
 }
 
 
+// set rotation rate by battery policy and idle state, the lower one wins
+void updateRotationRate()
+{
+    auto rate = lowPowerActive ? imag::config::Battery::lowRotationRate : imag::config::Stream::rotationRate;
+
+    if (adaptiveRate.isIdle())
+        rate = std::min (rate, imag::config::Stream::idleRotationRate);
+
+    if (! imu.setDataRate (primaryDataType, rate))
+        DBGLN("Setting rotation rate failed");
+}
+
+
 // update battery status to display content
 void updateBattery()
 {
     battery.update();
     oled.getContent().batteryVoltage = battery.getVoltage();
     oled.getContent().batteryPercentage = battery.getPercentage();
+
+    // low battery policy: trade rotation rate, display use and wifi latency for runtime
+    if (imag::config::Battery::lowPowerPolicy && battery.isLow() != lowPowerActive)
+    {
+        lowPowerActive = battery.isLow();
+
+        updateRotationRate();
+        oled.setAutoOffDelay (lowPowerActive
+                              ? imag::config::Battery::lowDisplayAutoOff
+                              : imag::display::SH1107::displayAutoOff);
+        net.setPowerProfile (lowPowerActive ? imag::osc::PowerProfile::longestBattery : powerProfile);
+
+        DBG("Low battery policy "); DBGLN(lowPowerActive ? "on" : "off");
+    }
+}
+
+
+// compare rotations componentwise
+bool isSameRotation (const Quaternion& a, const Quaternion& b)
+{
+    return a.w == b.w && a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+
+// start access point, deferred from setup() as it blocks for a while
+bool startWifi()
+{
+    if (! net.init (ssid.c_str(), imag::config::WiFi::key, imag::config::WiFi::channel))
+        return false;
+
+    net.setTarget (imag::config::Net::remoteIP, imag::config::Net::remotePort);
+    imag::boot.mark (imag::Boot::Phase::wifi);
+
+    return true;
+}
+
+
+// (un)subscribe euler angles or matrix: int 1/0, euler optionally followed by the order name
+void subscribeRotationFormat (const imag::osc::WINC150x::LiteOSCParser& msg)
+{
+    if (msg.getArgCount() < 1 || ! msg.isInt (0))
+        return;
+
+    const auto subscribe = msg.getInt (0) != 0;
+
+    if (strcmp (msg.getAddress(), imag::osc::Address::matrix) == 0)
+    {
+        formatSubscriptions.matrix = subscribe;
+        return;
+    }
+
+    formatSubscriptions.euler = subscribe;
+
+    if (msg.getArgCount() < 2 || ! msg.isString (1))
+        return;
+
+    for (size_t i = 0; i < eulerOrderNames.size(); ++i)
+    {
+        if (strcmp (msg.getString (1), eulerOrderNames[i]) == 0)
+            formatSubscriptions.eulerOrder = imag::config::Stream::EulerOrder (i);
+    }
+}
+
+
+#if IMAG_DEBUG
+// debug log filters: level name, optional module name and int 1/0
+void setLogFilter (const imag::osc::WINC150x::LiteOSCParser& msg)
+{
+    if (msg.getArgCount() < 1 || ! msg.isString (0) || ! imag::log::logger.setLevel (msg.getString (0)))
+    {
+        LOGW("log filter: unknown level");
+        return;
+    }
+
+    if (msg.getArgCount() < 3)
+        return;
+
+    if (! msg.isString (1) || ! msg.isInt (2) || ! imag::log::logger.setModuleEnabled (msg.getString (1), msg.getInt (2) != 0))
+        LOGW("log filter: unknown module");
+}
+#endif // IMAG_DEBUG
+
+
+// send subscribed alternative formats of a rotation, computed from shared terms on demand
+bool sendRotationFormats (const imag::FixedQuaternion& rot)
+{
+    auto res = true;
+
+    rotationFormats.setRotation (rot);
+
+    if (formatSubscriptions.euler)
+    {
+        const auto& angles = rotationFormats.getEuler (formatSubscriptions.eulerOrder);
+
+        res &= net.sendVector (imag::osc::Address::euler, Vec3f (imag::trig::toRadians (angles[0]),
+                                                                 imag::trig::toRadians (angles[1]),
+                                                                 imag::trig::toRadians (angles[2])));
+    }
+
+    if (formatSubscriptions.matrix)
+        res &= net.sendMatrix (imag::osc::Address::matrix, rotationFormats.getMatrix());
+
+    return res;
 }
 
 
 void setup()
 {
+    imag::boot.mark (imag::Boot::Phase::setup);
+
     Wire.setClock(200000L);   // I2C speed, 400 kHz is a little fast for Arduino's pullups
 
     // led
     pinMode (LED_BUILTIN, OUTPUT);
     digitalWrite (LED_BUILTIN, LOW);
 
-    delay (250); // give the baby some time to settle
+    // debug serial console in case debugging is enabled, output waits for a terminal
+    imag::Debug::init();
+    DBG("Imagination sensor version ");
+    DBGN(imag::config::versionMajor); DBG(".");
+    DBGN(imag::config::versionMinor); DBG(".");
+    DBGNLN(imag::config::versionSub);
+
+    // oled display, polled until it responds after power-on
+    const auto displayStart = millis();
+
+    while (! oled.init (imag::config::Display::i2cAddr))
+    {
+        if (millis() - displayStart >= imag::config::Boot::displayTimeout)
+        {
+            DBGLN("Display init failed");
+            break;
+        }
+
+        delay (5);
+    }
 
-    // oled display
-    oled.init (imag::config::Display::i2cAddr);
     oled.getContent().version = versionString.c_str();
     oled.getContent().ssid = ssid.c_str();
     updateBattery(); // read initially for low bat splash warning
     oled.setPage (imag::display::Page::splash);
     oled.update();
+    imag::boot.mark (imag::Boot::Phase::display);
 
-    delay (100);
+    // set data types, rates and orientation first, so sensor init configures them at once
+    // rotation rate as the low battery policy read above demands
+    std::vector<imag::imu::DataType> dataTypes { primaryDataType };
+    updateRotationRate();
 
-    // init debug serial console in case debugging is enabled
-    imag::Debug::init();
-    DBG("Imagination sensor version ");
-    DBGN(imag::config::versionMajor); DBG(".");
-    DBGN(imag::config::versionMinor); DBG(".");
-    DBGNLN(imag::config::versionSub);
+    for (const auto& stream : vectorStreams)
+    {
+        if (stream.rate == 0)
+            continue;
 
-    // init sensor
-    if (! imu.init (imag::config::BNO08x::i2cAddr))
+        imu.setDataRate (stream.type, stream.rate);
+        dataTypes.push_back (stream.type);
+    }
+
+    // stability classifier for the adaptive rotation rate
+    if (imag::config::Stream::adaptiveRate)
     {
-        DBGLN("Sensor init failed");
-        imag::Debug::halt();
+        imu.setDataRate (imag::imu::DataType::classStability, imag::config::Stream::stabilityRate);
+        dataTypes.push_back (imag::imu::DataType::classStability);
     }
 
-    imu.printSensorsPerformingDynamicCalibration();
+    if (! imu.setDataTypesToQuery (dataTypes))
+    {
+        DBGLN("failed to set custom data types to query");
+    }
 
-    // adapt to mounting orientation of sensor
     imu.setReorientation (sensorOrientations[orientationMode]); // initial orientation
 
-    // set data types we are interested in
-    if (! imu.setDataTypesToQuery ({ primaryDataType }))
+    // init sensor
+    if (! imag::imu::initImu (imu))
     {
-        DBGLN("failed to set custom data types to query");
+        LOGE("Sensor init failed");
+        imag::Debug::halt();
     }
 
-    // init network transport
-    if (! net.init (ssid.c_str(), imag::config::WiFi::key, imag::config::WiFi::channel))
+    // sensor interrupt ends cpu idle immediately, attached after init as the bus setup reconfigures the pin
+    if (imag::config::Imu::backend == imag::config::Imu::Backend::bno08x)
+        power.attachWakeup (imag::config::BNO08x::intPin);
+
+    imu.printSensorsPerformingDynamicCalibration();
+
+    // adapt to mounting orientation of sensor
+    if (imu.isTared())
     {
-        DBGLN("Starting wifi failed");
-        imag::Debug::halt();
+        // restore orientation mode and custom north saved on sensor
+        auto it = std::find_if (sensorOrientations.begin(), sensorOrientations.end(),
+                                [] (const Quaternion& q) { return isSameRotation (q, imu.getReorientation()); });
+
+        if (it != sensorOrientations.end())
+        {
+            orientationMode = std::distance (sensorOrientations.begin(), it);
+            customNorth = true;
+        }
     }
 
-    net.setTarget (imag::config::Net::remoteIP, imag::config::Net::remotePort);
+    // a saved, untared orientation may differ from the initial one
+    if (! customNorth && ! isSameRotation (imu.getReorientation(), sensorOrientations[orientationMode]))
+        imu.setReorientation (sensorOrientations[orientationMode]);
+
+    imag::boot.mark (imag::Boot::Phase::imu);
+
+#if IMAG_CAPTURE
+    // capture every raw report
+    Serial.begin (imag::config::serialBaudrate);
+    capture.setEnabled (true);
+    imu.setReportListener ([] (const sh2_SensorValue_t& value) { capture.addReport (value); });
+#endif // IMAG_CAPTURE
+
+    // wired osc/binary output
+    if (imag::config::UsbSerial::enabled)
+        Serial.begin (imag::config::serialBaudrate);
+
+    // network transport is started from loop() once the sensor streams
+    net.setPowerProfile (lowPowerActive ? imag::osc::PowerProfile::longestBattery : powerProfile);
 
     // init buttons
     for (auto* button : buttons)
         button->begin();
 
     attachButtonsNorm();
+
+    // sensor is expected to stream from now on
+    imuWatchdog.feed (millis());
+
+    imag::boot.mark (imag::Boot::Phase::ready);
 }
 
 
 void loop()
 {
     auto now = millis();
+    const auto loopStart = micros();
     static auto connMsgTime = now;
+    static auto timingMsgTime = now;
 
     // flag for any received data
     auto dataReceived = false;
 
-    // update/check current network status
-    net.updateConnectionState();
+    // start wifi once the sensor streams, then update/check current network status
+    static auto wifiStarted = false;
+
+    if (wifiStarted)
+    {
+        PROFILE(connection, net.updateConnectionState());
+    }
+    else if (imag::boot.isReached (imag::Boot::Phase::firstSample) || now >= imag::config::Boot::wifiStartTimeout)
+    {
+        if (! startWifi())
+        {
+            LOGE("Starting wifi failed");
+            imag::Debug::halt();
+        }
+
+        wifiStarted = true;
+    }
+
+    if (net.isReadyToSend())
+        imag::boot.mark (imag::Boot::Phase::connected);
+
+    // answer queries
+    if (const auto* msg = net.receive())
+    {
+        const auto receiveTime = imag::clockSync.getLocalTime();
+
+        // host clock synchronisation ping, answered first to keep the sensor's share of the round trip short
+        if (strcmp (msg->getAddress(), imag::osc::Address::sync) == 0)
+            imag::clockSync.handlePing (*msg, receiveTime, net, imag::osc::Address::sync);
+
+        // boot phase timing
+        if (strcmp (msg->getAddress(), imag::osc::Address::boot) == 0)
+            imag::boot.sendTimes (net, imag::osc::Address::boot);
+
+        // sensor stall events and recovery times
+        if (strcmp (msg->getAddress(), imag::osc::Address::watchdog) == 0)
+            imuWatchdog.sendStats (net, imag::osc::Address::watchdog);
+
+        // rotation format subscriptions: int 1/0, optional euler order name
+        if (strcmp (msg->getAddress(), imag::osc::Address::euler) == 0 || strcmp (msg->getAddress(), imag::osc::Address::matrix) == 0)
+            subscribeRotationFormat (*msg);
+
+#if IMAG_PROFILE
+        // stage timing, optional int argument 1 resets afterwards
+        if (strcmp (msg->getAddress(), imag::osc::Address::stats) == 0)
+        {
+            imag::profiler.sendStats (net, imag::osc::Address::stats);
+
+            if (msg->getArgCount() > 0 && msg->isInt (0) && msg->getInt (0) == 1)
+                imag::profiler.reset();
+        }
+#endif // IMAG_PROFILE
+
+#if IMAG_DEBUG
+        // debug log filters
+        if (strcmp (msg->getAddress(), imag::osc::Address::log) == 0)
+            setLogFilter (*msg);
+#endif // IMAG_DEBUG
+    }
 
     if (! net.isReadyToSend() && now > connMsgTime)
     {
@@ -284,28 +632,33 @@ void loop()
     }
 
     // eval buttons
-    for (auto* button : buttons)
-        button->read();
+    PROFILE(buttons, readButtons());
 
     // display refresh/timeout
     oled.setPage (imu.isCalibrating() ? imag::display::Page::calibration : imag::display::Page::main);
-    oled.update();
+    PROFILE(display, oled.update());
 
     // battery read cycle if due
-    updateBattery();
+    PROFILE(battery, updateBattery());
 
     // read sensor data and send
-    while (imu.read())
+    while (PROFILE(imu, imu.read()))
     {
         dataReceived = true;
+        power.addSample();
+        imuWatchdog.feed (millis());
+        const auto sampleTime = imag::clockSync.getLocalTime();
+        imag::boot.mark (imag::Boot::Phase::firstSample);
+
+        // accumulate reliability and accuracy for smoothing, only shown on display
+        const auto smooth = oled.isEnabled();
 
-        // accumulate reliability and accuracy for smoothing
-        if (! imu.isCalibrating() && imu.getLastDataType() == primaryDataType)
+        if (smooth && ! imu.isCalibrating() && imu.getLastDataType() == primaryDataType)
 	{
             reliability.add (imu.getCurrentReliability());
             accuracy.add (imu.getCurrentAccuracy());
 	}
-        else if (imu.isCalibrating() && imu.getLastDataType() == imag::imu::DataType::mag)
+        else if (smooth && imu.isCalibrating() && imu.getLastDataType() == imag::imu::DataType::mag)
 	{
             reliability.add (imu.getCurrentReliability());
 	}
@@ -314,39 +667,18 @@ void loop()
         if (imag::imu::isAnyRotationDataType (imu.getLastDataType()))
 	{
             // get data
-            Quaternion rot;
-            auto success = true;
+            imag::FixedQuaternion rot;
       
             imu.getLastData (rot);
 
-            // custom north
-            rot = customNorthOffset + rot;
+            if (imag::config::Stream::adaptiveRate)
+                adaptiveRate.addRotation (rot);
 
             // send midi
-            std::array<float, 4> rotAsFloats { rot.w, rot.x, rot.y, rot.z };
-            uint8_t msg[4];
-
-            msg[0] = 0x0b;
-            msg[1] = 0xb0 | 0x01; // midi channel 1
+            const auto success = PROFILE(midi, midi.sendRotation (rot));
 
-            // send each part of quaternion as 14-bit midi CC
-            for (auto i = 0; i < 4; ++i)
-	    {
-                auto value = uint16_t ((rotAsFloats[i] + 1.0f) * 8192.0f); // 0..16384, 14bit
-
-                // coarse
-                msg[2] = i + 16; // cc coarse
-                msg[3] = value >> 7 & 0x7f;
-                success &= MidiUSB.write (msg, 4) == 4;
-
-                // fine
-                msg[2] = i + 48; // cc fine
-                msg[3] = value & 0x7f;
-                success &= MidiUSB.write (msg, 4) == 4;
-	    }
-
-            // if (! success)
-            //     DBGLN("Error sending MIDI data");
+            if (success)
+                imag::boot.mark (imag::Boot::Phase::firstMidi);
 
             // update display data
             oled.getContent().orientationConfig = orientationMode;
@@ -354,41 +686,143 @@ void loop()
             oled.getContent().rotation = rot;
             oled.getContent().senderOsc = net.isReadyToSend();
             oled.getContent().senderMidi = success;
+
+            // send wired osc/binary, independent of wifi
+            if (imag::config::UsbSerial::enabled && ! imu.isCalibrating())
+                PROFILE(wired, wired.sendRotation (imag::osc::Address::rotation, rot));
             
             // skip network sending part if disconnected or calibrating
             if (imu.isCalibrating() || ! net.isReadyToSend())
                 continue;
 
-            // send osc
-            if (! net.sendQuaternion (imag::osc::Address::rotation, rot))
+            // send osc, with host time of the sample while synchronised
+            const auto timetag = imag::config::Sync::rotationTimetag && imag::clockSync.isSynchronised()
+                ? imag::clockSync.toHostTime (sampleTime)
+                : 0;
+
+            if (! PROFILE(osc, net.sendQuaternion (imag::osc::Address::rotation, rot, timetag)))
+            {
                 DBGLN("Sending osc message failed");
+                continue;
+            }
+
+            // a rotation held for the batch of the power profile is not sent yet
+            if (! net.isRotationSent())
+                continue;
+
+            imag::boot.mark (imag::Boot::Phase::firstOsc);
+
+            // alternative formats along with each rotation actually sent
+            if ((formatSubscriptions.euler || formatSubscriptions.matrix) && ! PROFILE(osc, sendRotationFormats (rot)))
+                DBGLN("Sending rotation formats failed");
 	}
-        else
-	{ 
-            // DBGLN("Cannot send non-rotation data type in current version");
+        else if (imag::imu::isAnyVectorDataType (imu.getLastDataType()))
+	{
+            // only keep latest value, sending is deferred to not delay the rotation path
+            for (auto& stream : vectorStreams)
+            {
+                if (stream.rate > 0 && stream.type == imu.getLastDataType())
+                    stream.pending = imu.getLastData (stream.value);
+            }
+	}
+        else if (imu.getLastDataType() == imag::imu::DataType::classStability)
+	{
+            imag::imu::Stability stability;
+
+            if (imu.getLastData (stability))
+                adaptiveRate.addStability (stability, millis());
 	}
     }
     // DBGLN("Sensor has no more data for this query loop");
 
-    { // update remaining display data
-        oled.getContent().reliability = reliability.get();
-        oled.getContent().accuracy = constrain (accuracy.get(), 0.0f, 0.5f * PI) / (0.5f * PI); // constrain to 0..90 deg
+    // follow the idle state with the rotation rate
+    if (imag::config::Stream::adaptiveRate && adaptiveRate.update (millis()))
+        updateRotationRate();
+
+    // recover a stalled sensor, everything else keeps running meanwhile
+    switch (imuWatchdog.check (millis()))
+    {
+    case imag::imu::Watchdog::Action::reinit:
+        if (! imu.recover (false))
+            DBGLN("Re-enabling sensor reports failed");
+        break;
+
+    case imag::imu::Watchdog::Action::reset:
+        if (! imu.recover (true))
+            DBGLN("Resetting sensor failed");
+        break;
+
+    default:
+        break;
+    }
 
+    // send latest vector data of each stream
+    for (auto& stream : vectorStreams)
+    {
+        if (! stream.pending)
+            continue;
+
+        stream.pending = false;
+
+        if (imag::config::UsbSerial::enabled && ! imu.isCalibrating())
+            PROFILE(wired, wired.sendVector (stream.address, stream.value));
+
+        // skip if disconnected or calibrating
+        if (imu.isCalibrating() || ! net.isReadyToSend())
+            continue;
+
+        if (! PROFILE(osc, net.sendVector (stream.address, stream.value)))
+            DBGLN("Sending osc message failed");
+    }
+
+    // output sensor, midi, power and wifi timings and smoothed values every 10s
+    if (now > timingMsgTime)
+    {
+        imu.printTransferTiming();
+        imu.printReconfigTiming();
+        imu.resetTransferTiming();
+        imu.resetFusionTiming();
+        midi.printStats();
+        midi.resetStats();
+        power.printDutyCycle();
+        power.reset();
+        net.printSendStats();
+        imag::clockSync.printStats();
+        imuWatchdog.printStats();
+        adaptiveRate.printStats();
+#if IMAG_PROFILE
+        imag::profiler.printStats();
+#endif // IMAG_PROFILE
         DBG("smoothed reliability: "); DBGNLN(oled.getContent().reliability);
         DBG("smoothed accuracy: "); DBGNLN(oled.getContent().accuracy * 90.0f);
+        timingMsgTime += 10000;
+    }
+
+    { // update remaining display data
+        oled.getContent().reliability = reliability.get();
+        oled.getContent().powerProfile = static_cast<uint8_t> (net.getPowerProfile());
+        oled.getContent().accuracy = constrain (accuracy.get(), 0.0f, 0.5f * PI) / (0.5f * PI); // constrain to 0..90 deg
 
         if (imu.isCalibrating())
             oled.resetAutoOff(); // do not auto-off when calibrating
     }
 
-    // wait for sensor interrupt
-    while (digitalRead (imag::config::BNO08x::intPin) == HIGH)
-    {
-        DBGLN("Waiting for sensor interrupt");
-        delay (1);
-    }
+    // write pending debug output before idling
+    PROFILE(log, imag::Debug::drain());
+
+    // stage timing of this cycle
+    PROFILE_LOOP(loopStart);
+
+    // wait for sensor interrupt, cpu idles in between, bounded so a stalled sensor does not stop the loop
+    const auto waitStart = micros();
+
+    power.waitUntil ([] { return imu.isDataReady(); }, imag::config::Imu::loopTimeout * 1000);
 
-    DBGLN("Interrupt received, starting next cycle");
+#if IMAG_CAPTURE
+    // loop duration excluding the wait for the sensor, capture starts once the host opens the port
+    capture.setHostConnected (Serial.dtr());
+    capture.addLoop (loopStart, waitStart - loopStart);
+#endif // IMAG_CAPTURE
 
     // limit querying rate
     // auto elapsed = millis() - now;
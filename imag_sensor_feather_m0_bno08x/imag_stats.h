@@ -0,0 +1,346 @@
+/* imag_stats.h
+ * 
+ * imagination sensor firmware
+ * streaming statistics
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <limits>
+#include <algorithm>
+
+namespace imag::stats
+{
+/* O(1) online statistics with fixed memory, meant for telemetry on the
+   MCU. All classes take one value per add() and never store samples.
+*/
+
+// exponential moving average
+/* alpha = 2 / (n + 1) matches the centre of mass of an n-sample moving
+   average. Until n samples are seen a cumulative mean is used instead,
+   so there is no bias towards the initial state.
+*/
+template <typename T>
+class ExpMean
+{
+public:
+    explicit ExpMean (T newAlpha) : alpha (newAlpha) { reset(); }
+
+    // construct from equivalent moving average length
+    static ExpMean fromLength (size_t length) { return ExpMean (T (2) / T (length + 1)); }
+
+    void add (T value)
+    {
+        if (count < std::numeric_limits<uint32_t>::max())
+            ++count;
+
+        const auto weight = std::max (alpha, T (1) / T (count));
+        mean += weight * (value - mean);
+    }
+
+    T get() const { return mean; }
+    uint32_t getCount() const { return count; }
+
+    void reset()
+    {
+        mean = T (0);
+        count = 0;
+    }
+
+private:
+    T alpha;
+    T mean;
+    uint32_t count;
+};
+
+
+// minimum and maximum
+template <typename T>
+class MinMax
+{
+public:
+    MinMax() { reset(); }
+
+    void add (T value)
+    {
+        minimum = std::min (minimum, value);
+        maximum = std::max (maximum, value);
+    }
+
+    // lowest()/max() of T if empty
+    T getMin() const { return minimum; }
+    T getMax() const { return maximum; }
+    T getRange() const { return maximum >= minimum ? maximum - minimum : T (0); }
+
+    void reset()
+    {
+        minimum = std::numeric_limits<T>::max();
+        maximum = std::numeric_limits<T>::lowest();
+    }
+
+private:
+    T minimum;
+    T maximum;
+};
+
+
+// mean and variance (Welford), numerically stable without running sums
+/* with float, the mean resolves the float spacing of the values only,
+   so the spread should be well above 1e-5 of the mean, as it is for
+   send intervals and durations in us.
+*/
+template <typename T>
+class Welford
+{
+public:
+    Welford() { reset(); }
+
+    void add (T value)
+    {
+        ++count;
+        const auto delta = value - mean;
+        mean += delta / T (count);
+        m2 += delta * (value - mean);
+    }
+
+    uint32_t getCount() const { return count; }
+    T getMean() const { return mean; }
+
+    // population variance, 0 if fewer than 2 samples
+    T getVariance() const { return count > 1 ? m2 / T (count) : T (0); }
+
+    T getStdDev() const { return sqrt (getVariance()); }
+
+    void reset()
+    {
+        count = 0;
+        mean = T (0);
+        m2 = T (0);
+    }
+
+private:
+    uint32_t count;
+    T mean;
+    T m2;
+};
+
+
+// streaming quantile estimate (P-square, Jain & Chlamtac 1985)
+/* five markers track min, p/2, p, (1+p)/2 and max, adjusted by
+   piecewise parabolic interpolation. Exact for the first five samples.
+*/
+template <typename T>
+class Quantile
+{
+public:
+    explicit Quantile (T newP) : p (newP) { reset(); }
+
+    void add (T value)
+    {
+        if (count < markers)
+        {
+            heights[count++] = value;
+
+            if (count == markers)
+                std::sort (heights.begin(), heights.end());
+
+            return;
+        }
+
+        ++count;
+
+        // find cell and update extreme markers
+        size_t k;
+
+        if (value < heights[0])
+        {
+            heights[0] = value;
+            k = 0;
+        }
+        else if (value >= heights[markers - 1])
+        {
+            heights[markers - 1] = value;
+            k = markers - 2;
+        }
+        else
+        {
+            k = 0;
+
+            while (value >= heights[k + 1])
+                ++k;
+        }
+
+        for (size_t i = k + 1; i < markers; ++i)
+            ++positions[i];
+
+        for (size_t i = 0; i < markers; ++i)
+            desired[i] += increments[i];
+
+        // adjust inner markers
+        for (size_t i = 1; i < markers - 1; ++i)
+        {
+            const auto d = desired[i] - T (positions[i]);
+
+            if ((d >= T (1) && positions[i + 1] - positions[i] > 1) ||
+                (d <= T (-1) && positions[i - 1] - positions[i] < -1))
+            {
+                const int sign = d >= T (0) ? 1 : -1;
+                const auto h = parabolic (i, sign);
+
+                heights[i] = heights[i - 1] < h && h < heights[i + 1] ? h : linear (i, sign);
+                positions[i] += sign;
+            }
+        }
+    }
+
+    // current estimate, exact (nearest rank) while fewer than five samples
+    T get() const
+    {
+        if (count >= markers)
+            return heights[2];
+
+        if (count == 0)
+            return T (0);
+
+        auto sorted = heights;
+        std::sort (sorted.begin(), sorted.begin() + count);
+
+        return sorted[std::min<size_t> (count - 1, size_t (p * count))];
+    }
+
+    uint32_t getCount() const { return count; }
+
+    void reset()
+    {
+        count = 0;
+        heights.fill (T (0));
+        positions = { 0, 1, 2, 3, 4 };
+        desired = { T (0), T (2) * p, T (4) * p, T (2) + T (2) * p, T (4) };
+        increments = { T (0), p / T (2), p, (T (1) + p) / T (2), T (1) };
+    }
+
+private:
+    static constexpr size_t markers = 5;
+
+    T parabolic (size_t i, int sign) const
+    {
+        const auto n0 = T (positions[i - 1]), n1 = T (positions[i]), n2 = T (positions[i + 1]);
+        const auto q0 = heights[i - 1], q1 = heights[i], q2 = heights[i + 1];
+
+        return q1 + T (sign) / (n2 - n0) * ((n1 - n0 + T (sign)) * (q2 - q1) / (n2 - n1) +
+                                            (n2 - n1 - T (sign)) * (q1 - q0) / (n1 - n0));
+    }
+
+    T linear (size_t i, int sign) const
+    {
+        return heights[i] + T (sign) * (heights[i + sign] - heights[i]) / T (positions[i + sign] - positions[i]);
+    }
+
+    T p;
+    uint32_t count;
+    std::array<T, markers> heights;
+    std::array<int32_t, markers> positions;
+    std::array<T, markers> desired;
+    std::array<T, markers> increments;
+};
+
+
+// summary of a telemetry value: count, mean, deviation, extremes
+/* integer only on add(), for timings on the per-sample path of the MCU.
+   Sums are taken relative to the first value, which keeps them small
+   and the variance free of cancellation for values with a large offset
+   such as send intervals. Mean and deviation are computed on query.
+*/
+class IntegerSummary
+{
+public:
+    IntegerSummary() { reset(); }
+
+    void add (uint32_t value)
+    {
+        if (count == 0)
+            offset = value;
+
+        const auto delta = int64_t (value) - offset;
+
+        ++count;
+        sum += delta;
+        sumSquares += uint64_t (delta * delta);
+        minimum = std::min (minimum, value);
+        maximum = std::max (maximum, value);
+    }
+
+    uint32_t getCount() const { return count; }
+
+    // 0 if empty
+    uint32_t getMin() const { return count > 0 ? minimum : 0; }
+    uint32_t getMax() const { return maximum; }
+
+    float getMean() const { return count > 0 ? float (offset + double (sum) / count) : 0.0f; }
+
+    // population variance, 0 if fewer than 2 samples
+    float getVariance() const
+    {
+        if (count < 2)
+            return 0.0f;
+
+        const auto mean = double (sum) / count;
+        return float (std::max (0.0, double (sumSquares) / count - mean * mean));
+    }
+
+    float getStdDev() const { return sqrt (getVariance()); }
+
+    void reset()
+    {
+        count = 0;
+        offset = 0;
+        sum = 0;
+        sumSquares = 0;
+        minimum = std::numeric_limits<uint32_t>::max();
+        maximum = 0;
+    }
+
+private:
+    uint32_t count;
+    uint32_t offset;
+    int64_t sum;
+    uint64_t sumSquares;
+    uint32_t minimum;
+    uint32_t maximum;
+};
+
+
+// the same summary in floating point, for host side figures
+template <typename T>
+class Summary
+{
+public:
+    void add (T value)
+    {
+        moments.add (value);
+        extremes.add (value);
+    }
+
+    uint32_t getCount() const { return moments.getCount(); }
+    T getMean() const { return moments.getMean(); }
+    T getStdDev() const { return moments.getStdDev(); }
+    T getMin() const { return extremes.getMin(); }
+    T getMax() const { return extremes.getMax(); }
+
+    void reset()
+    {
+        moments.reset();
+        extremes.reset();
+    }
+
+private:
+    Welford<T> moments;
+    MinMax<T> extremes;
+};
+
+} // namespace imag::stats
@@ -0,0 +1,194 @@
+/* imag_trig.cpp
+ * 
+ * imagination sensor firmware
+ * lookup table trigonometry
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_trig.h"
+
+#include <array>
+
+namespace imag::trig
+{
+
+namespace
+{
+// table size bits, tables cover a quarter turn or atan of 0..1 with one guard entry
+constexpr auto tableBits = 8;
+constexpr auto tableSize = (1 << tableBits) + 1;
+
+constexpr auto pi = 3.14159265358979324;
+
+// compile time series for table generation
+constexpr double constSin (double x)
+{
+    double term = x, sum = x;
+
+    for (int i = 1; i < 16; ++i)
+    {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+
+    return sum;
+}
+
+constexpr double constAtan (double x) // x in 0..1
+{
+    // reduce argument twice: atan(x) = 2 * atan(x / (1 + sqrt(1 + x^2)))
+    for (int i = 0; i < 2; ++i)
+    {
+        double r = 1.0 + x * x, s = r;
+
+        for (int j = 0; j < 32; ++j)
+            s = 0.5 * (s + r / s);
+
+        x = x / (1.0 + s);
+    }
+
+    double term = x, sum = x;
+
+    for (int i = 1; i < 24; ++i)
+    {
+        term *= -x * x;
+        sum += term / (2 * i + 1);
+    }
+
+    return 4.0 * sum;
+}
+
+// sin over a quarter turn as Q15
+constexpr std::array<int16_t, tableSize> makeSinTable()
+{
+    std::array<int16_t, tableSize> table {};
+
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        const auto value = constSin (i * pi / 2.0 / (tableSize - 1)) * (1 << fracBits) + 0.5;
+        table[i] = int16_t (value > 32767.0 ? 32767 : value);
+    }
+
+    return table;
+}
+
+// atan of 0..1 as Angle
+constexpr std::array<uint16_t, tableSize> makeAtanTable()
+{
+    std::array<uint16_t, tableSize> table {};
+
+    for (size_t i = 0; i < table.size(); ++i)
+        table[i] = uint16_t (constAtan (double (i) / (tableSize - 1)) * fullTurn / (2.0 * pi) + 0.5);
+
+    return table;
+}
+
+constexpr auto sinTable = makeSinTable();
+constexpr auto atanTable = makeAtanTable();
+
+// linear interpolation in table, position with fracBits below index, up to and including the last entry
+template <typename T>
+int32_t interpolate (const std::array<T, tableSize>& table, uint32_t position, int frac)
+{
+    const auto index = position >> frac;
+    const auto weight = int32_t (position & ((uint32_t (1) << frac) - 1));
+    const auto a = int32_t (table[index]);
+
+    // on an entry, e.g. the table end at sin 90 deg or atan 45 deg, there is no next one to read
+    if (weight == 0)
+        return a;
+
+    const auto b = int32_t (table[index + 1]);
+
+    return a + (((b - a) * weight + (int32_t (1) << (frac - 1))) >> frac);
+}
+} // namespace
+
+
+int16_t sin (Angle angle)
+{
+    // quadrant in upper two bits, position within quarter turn below
+    static constexpr auto positionBits = 14;
+    const auto quadrant = angle >> positionBits;
+    uint32_t position = angle & (quarterTurn - 1);
+
+    if (quadrant & 1)
+        position = quarterTurn - position;
+
+    const auto value = int16_t (interpolate (sinTable, position, positionBits - tableBits));
+
+    return quadrant & 2 ? -value : value;
+}
+
+
+Angle atan2 (int32_t y, int32_t x)
+{
+    if (x == 0 && y == 0)
+        return 0;
+
+    const auto ax = x < 0 ? uint32_t (0) - uint32_t (x) : uint32_t (x);
+    const auto ay = y < 0 ? uint32_t (0) - uint32_t (y) : uint32_t (y);
+
+    // ratio of smaller to larger component in 0..1, Q16
+    static constexpr auto ratioBits = 16;
+    const auto swap = ay > ax;
+    const auto ratio = uint32_t ((uint64_t (swap ? ax : ay) << ratioBits) / (swap ? ay : ax));
+
+    // first octant, mirrored into the others
+    auto angle = Angle (interpolate (atanTable, ratio, ratioBits - tableBits));
+
+    if (swap)
+        angle = quarterTurn - angle;
+
+    if (x < 0)
+        angle = halfTurn - angle;
+
+    if (y < 0)
+        angle = -angle;
+
+    return angle;
+}
+
+
+uint32_t hypot (int32_t x, int32_t y)
+{
+    // at most 2^63, root at most 2^31.5
+    auto value = uint64_t (int64_t (x) * x) + uint64_t (int64_t (y) * y);
+    uint64_t root = 0;
+    uint64_t bit = uint64_t (1) << 62;
+
+    // bitwise square root, starting at the highest power of four within value
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+
+        bit >>= 2;
+    }
+
+    return uint32_t (root);
+}
+
+
+Angle yaw (const FixedQuaternion& q)
+{
+    // yaw = atan2 (2 (wz + xy), 1 - 2 (y^2 + z^2)), terms as Q(fracBits)
+    static constexpr auto shift = 2 * FixedQuaternion::fracBits - 1 - FixedQuaternion::fracBits;
+
+    const auto y = (int64_t (q.w) * q.z + int64_t (q.x) * q.y) >> shift;
+    const auto x = int64_t (FixedQuaternion::one) - ((int64_t (q.y) * q.y + int64_t (q.z) * q.z) >> shift);
+
+    // keep within int32, terms are within +-1 for unit quaternions
+    return atan2 (int32_t (y >> 1), int32_t (x >> 1));
+}
+
+} // namespace imag::trig
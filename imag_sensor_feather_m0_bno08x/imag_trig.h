@@ -0,0 +1,58 @@
+/* imag_trig.h
+ * 
+ * imagination sensor firmware
+ * lookup table trigonometry
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "imag_fixed_quaternion.h"
+
+namespace imag::trig
+{
+/* Table based sin/cos/atan2 on binary angles for the FPU-less MCU. An
+   Angle wraps around naturally, a full turn being 2^16, i.e. a resolution
+   of ~0.0055 deg. Tables are generated at compile time and interpolated
+   linearly, errors are about one Angle step or 2^-15 respectively.
+*/
+using Angle = uint16_t;
+
+static constexpr uint32_t fullTurn = uint32_t (1) << 16;
+static constexpr Angle halfTurn = fullTurn / 2;
+static constexpr Angle quarterTurn = fullTurn / 4;
+
+// fractional bits of sin/cos results
+static constexpr int fracBits = 15;
+
+// conversions, meant for constants and outputs (soft-float)
+constexpr Angle fromDegrees (double degrees)
+{
+    return Angle (int32_t (degrees * fullTurn / 360.0 + (degrees < 0 ? -0.5 : 0.5)));
+}
+
+constexpr Angle fromRadians (double radians)
+{
+    return Angle (int32_t (radians * fullTurn / (2.0 * 3.14159265358979324) + (radians < 0 ? -0.5 : 0.5)));
+}
+
+// radians in -pi..pi
+inline float toRadians (Angle angle) { return int16_t (angle) * (PI / halfTurn); }
+
+// sin/cos as Q15
+int16_t sin (Angle angle);
+inline int16_t cos (Angle angle) { return sin (angle + quarterTurn); }
+
+// angle of vector (x, y), any common scale, 0 for the zero vector
+Angle atan2 (int32_t y, int32_t x);
+
+// length of vector (x, y), same scale, integer square root
+uint32_t hypot (int32_t x, int32_t y);
+
+// yaw (heading around z) of rotation, same as EulerAngles (q).yaw
+Angle yaw (const FixedQuaternion& q);
+
+} // namespace imag::trig
@@ -0,0 +1,581 @@
+/* imag_bench.cpp
+ * 
+ * imagination sensor firmware
+ * host micro-benchmarks of the per-sample output path
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include "imag_config.h"
+#include "imag_fixed_quaternion.h"
+#include "imag_imu_fusion.h"
+#include "imag_midi_usb.h"
+#include "imag_osc_winc150x.h"
+#include "imag_osc_address.h"
+#include "imag_rotation_formats.h"
+#include "imag_trig.h"
+#include "imag_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/* Each stage runs on its own over a sequence of recorded-like rotations
+   and as the chain the sensor path takes per rotation sample. Host times
+   include the stand-ins of sim/include (usb midi, udp without sockets),
+   so they are meant for comparing builds, not as firmware figures.
+
+   The Cortex-M0 estimate only covers library calls: the float operations,
+   64 bit multiplies and divides and libm functions a stage performs per
+   sample, counted from its code, times rough routine costs. Other integer work is not part of
+   the estimate.
+*/
+
+namespace imag::bench
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// samd21 core clock
+constexpr double m0CyclesPerUs = 48.0;
+
+// float operations and 64 bit multiplies/divides per sample, each a libgcc call on the M0
+struct FloatOps
+{
+    uint16_t add = 0;     // __aeabi_fadd/fsub
+    uint16_t mul = 0;     // __aeabi_fmul
+    uint16_t div = 0;     // __aeabi_fdiv
+    uint16_t cmp = 0;     // __aeabi_fcmp*
+    uint16_t fromInt = 0; // __aeabi_i2f/ui2f
+    uint16_t toInt = 0;   // __aeabi_f2iz/f2uiz
+    uint16_t lmul = 0;    // __aeabi_lmul, fixed point products
+    uint16_t ldiv = 0;    // __aeabi_uldivmod
+    uint16_t libm = 0;    // sinf/cosf/asinf/atan2f
+
+    // rough libgcc cycles on Cortex-M0 (no divider, single cycle 32 bit multiplier)
+    uint32_t getCycles() const
+    {
+        return add * 70u + mul * 65u + div * 140u + cmp * 35u + fromInt * 45u + toInt * 30u + lmul * 40u + ldiv * 300u + libm * 1500u;
+    }
+};
+
+struct Stage
+{
+    const char* name;
+    FloatOps ops;
+    std::function<void (size_t)> run; // one sample, by index
+};
+
+struct Result
+{
+    std::string name;
+    uint32_t samples = 0;
+    double median = 0.0; // [ns]
+    double min = 0.0;    // [ns]
+    FloatOps ops;
+};
+
+struct Options
+{
+    uint32_t repeats = 15;
+    uint32_t samples = 20000;
+    double tolerance = 25.0; // [%]
+    std::string csvFile;
+    std::string baselineFile;
+};
+
+// keep results alive without costing more than a store
+template <typename T>
+void keep (const T& value)
+{
+    asm volatile ("" : : "g" (&value) : "memory");
+}
+
+// rotation sequence as received from the sensor: Q14 i, j, k, real
+std::vector<std::array<int16_t, 4>> makeInput (size_t count)
+{
+    std::vector<std::array<int16_t, 4>> input (count);
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        // slow yaw with some pitch, 100 Hz
+        const auto t = n * 0.01;
+        const auto yaw = 1.5 * sin (2.0 * M_PI * 0.25 * t);
+        const auto pitch = 0.3 * sin (2.0 * M_PI * 0.1 * t);
+        const double q[4] { -sin (0.5 * pitch) * sin (0.5 * yaw), sin (0.5 * pitch) * cos (0.5 * yaw),
+                            cos (0.5 * pitch) * sin (0.5 * yaw), cos (0.5 * pitch) * cos (0.5 * yaw) };
+
+        for (size_t i = 0; i < 4; ++i)
+            input[n][i] = int16_t (lround (q[i] * (1 << 14)));
+    }
+
+    return input;
+}
+
+Result measure (const Stage& stage, const Options& options)
+{
+    std::vector<double> perSample;
+
+    // warm up
+    for (size_t n = 0; n < options.samples / 10; ++n)
+        stage.run (n);
+
+    for (uint32_t r = 0; r < options.repeats; ++r)
+    {
+        const auto start = Clock::now();
+
+        for (size_t n = 0; n < options.samples; ++n)
+            stage.run (n);
+
+        const auto ns = std::chrono::duration<double, std::nano> (Clock::now() - start).count();
+        perSample.push_back (ns / options.samples);
+    }
+
+    std::sort (perSample.begin(), perSample.end());
+
+    return { stage.name, options.samples, perSample[perSample.size() / 2], perSample.front(), stage.ops };
+}
+
+void writeCsv (FILE* out, const std::vector<Result>& results)
+{
+    fprintf (out, "stage,samples,ns_median,ns_min,fadd,fmul,fdiv,fcmp,i2f,f2i,lmul,ldiv,libm,m0_call_cycles,m0_call_us\n");
+
+    for (const auto& r : results)
+    {
+        const auto cycles = r.ops.getCycles();
+
+        fprintf (out, "%s,%u,%.2f,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.2f\n",
+                 r.name.c_str(), r.samples, r.median, r.min,
+                 r.ops.add, r.ops.mul, r.ops.div, r.ops.cmp, r.ops.fromInt, r.ops.toInt, r.ops.lmul, r.ops.ldiv, r.ops.libm,
+                 cycles, cycles / m0CyclesPerUs);
+    }
+}
+
+void printTable (const std::vector<Result>& results)
+{
+    fprintf (stderr, "%-14s %12s %12s %14s %12s\n", "stage", "ns median", "ns min", "m0 call cyc", "m0 call us");
+
+    for (const auto& r : results)
+    {
+        const auto cycles = r.ops.getCycles();
+        fprintf (stderr, "%-14s %12.2f %12.2f %14u %12.2f\n", r.name.c_str(), r.median, r.min, cycles, cycles / m0CyclesPerUs);
+    }
+}
+
+// median per stage of a previous csv run
+std::map<std::string, double> readBaseline (const std::string& file)
+{
+    std::map<std::string, double> baseline;
+    auto* in = fopen (file.c_str(), "r");
+
+    if (in == nullptr)
+    {
+        perror (file.c_str());
+        exit (1);
+    }
+
+    char line[256];
+
+    while (fgets (line, sizeof (line), in))
+    {
+        char name[64];
+        unsigned samples;
+        double median;
+
+        if (sscanf (line, "%63[^,],%u,%lf", name, &samples, &median) == 3)
+            baseline[name] = median;
+    }
+
+    fclose (in);
+
+    return baseline;
+}
+
+// stages slower than tolerance against baseline
+int compare (const std::vector<Result>& results, const Options& options)
+{
+    const auto baseline = readBaseline (options.baselineFile);
+    auto regressions = 0;
+
+    fprintf (stderr, "\ncompared to %s (tolerance %.0f %%)\n", options.baselineFile.c_str(), options.tolerance);
+
+    for (const auto& r : results)
+    {
+        const auto it = baseline.find (r.name);
+
+        if (it == baseline.end() || it->second <= 0.0)
+        {
+            fprintf (stderr, "%-14s no baseline\n", r.name.c_str());
+            continue;
+        }
+
+        const auto change = 100.0 * (r.median / it->second - 1.0);
+        const auto regressed = change > options.tolerance;
+        regressions += regressed;
+
+        fprintf (stderr, "%-14s %+8.1f %%%s\n", r.name.c_str(), change, regressed ? "  REGRESSION" : "");
+    }
+
+    return regressions;
+}
+
+void usage (const char* name)
+{
+    fprintf (stderr,
+             "usage: %s [options]\n"
+             "  --repeats N          timed repeats per stage, median is reported (default 15)\n"
+             "  --samples N          samples per repeat (default 20000)\n"
+             "  --csv FILE           write results as csv (default stdout)\n"
+             "  --baseline FILE      compare medians to a previous csv, exit 1 on regression\n"
+             "  --tolerance PCT      allowed slowdown against baseline (default 25)\n",
+             name);
+    exit (1);
+}
+
+Options parseOptions (int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string opt = argv[i];
+
+        if (i + 1 >= argc)
+            usage (argv[0]);
+
+        const char* value = argv[++i];
+
+        if (opt == "--repeats")
+            options.repeats = std::max (1, atoi (value));
+        else if (opt == "--samples")
+            options.samples = std::max (1, atoi (value));
+        else if (opt == "--csv")
+            options.csvFile = value;
+        else if (opt == "--baseline")
+            options.baselineFile = value;
+        else if (opt == "--tolerance")
+            options.tolerance = atof (value);
+        else
+            usage (argv[0]);
+    }
+
+    return options;
+}
+
+} // namespace
+} // namespace imag::bench
+
+
+int main (int argc, char** argv)
+{
+    using namespace imag;
+    using namespace imag::bench;
+
+    const auto options = parseOptions (argc, argv);
+
+    { // stand-ins: udp packets are counted only, nothing written to files
+        auto simOptions = sim::getOptions();
+        simOptions.udp = false;
+        simOptions.connectDelay = 0;
+        sim::setOptions (simOptions);
+    }
+
+    // output modules as set up by the sketch, wifi connected
+    midi::UsbMidi midi;
+    osc::WINC150x net { config::Net::localIP, config::Net::localPort };
+    net.setTarget (config::Net::remoteIP, config::Net::remotePort);
+
+    if (! net.init ("bench", config::WiFi::key, config::WiFi::channel))
+        return 1;
+
+    while (! net.isReadyToSend())
+    {
+        sim::advance (1000);
+        net.updateConnectionState();
+    }
+
+    const auto input = makeInput (1024);
+    auto sample = [&input] (size_t n) -> const auto& { return input[n & (input.size() - 1)]; };
+
+    // rotation of the current sample, as BNO08x::getLastData()
+    auto ingest = [&sample] (size_t n)
+    {
+        const auto& q = sample (n);
+        return FixedQuaternion::fromFixed<14> (q[3], q[0], q[1], q[2]);
+    };
+
+    // float reorientation of the synthetic and replay backends, ImuBase::reorient()
+    const auto reorientation = Quaternion (0.9238795f, 0.0f, 0.0f, 0.3826834f);
+    const auto floatInput = [&input]
+    {
+        std::vector<Quaternion> q;
+
+        for (const auto& s : input)
+            q.push_back (Quaternion (s[3] / 16384.0f, s[0] / 16384.0f, s[1] / 16384.0f, s[2] / 16384.0f));
+
+        return q;
+    }();
+
+    // per-sample conversions to the output values, midi 14-bit and osc floats,
+    // before: the library's float decode of the Q14 report and the float midi mapping
+    auto convertFloat = [&sample] (size_t n)
+    {
+        const auto& q = sample (n);
+
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const auto c = q[i] * (1.0f / (1 << 14));
+            keep (c);
+            keep (uint16_t ((c + 1.0f) * 8192.0f));
+        }
+    };
+
+    // now: integer only from the fixed point rotation
+    auto convertFixed = [&ingest] (size_t n)
+    {
+        const auto rot = ingest (n);
+
+        for (const auto c : { rot.w, rot.x, rot.y, rot.z })
+        {
+            keep (FixedQuaternion::toFloatBits (c));
+            keep (FixedQuaternion::toMidi14 (c));
+        }
+    };
+
+    // usb midi, before: the eight 14-bit controllers as separate 4-byte writes, as the sketch sent them
+    auto midiSingle = [&ingest] (size_t n)
+    {
+        const auto rot = ingest (n);
+        uint8_t msg[4] { 0x0b, 0xb0 | 0x01 }; // midi channel 1
+        auto success = true;
+        uint8_t i = 0;
+
+        for (const auto c : { rot.w, rot.x, rot.y, rot.z })
+        {
+            const auto value = FixedQuaternion::toMidi14 (c);
+
+            msg[2] = i + 16; // cc coarse
+            msg[3] = value >> 7 & 0x7f;
+            success &= MidiUSB.write (msg, 4) == 4;
+
+            msg[2] = i + 48; // cc fine
+            msg[3] = value & 0x7f;
+            success &= MidiUSB.write (msg, 4) == 4;
+            ++i;
+        }
+
+        keep (success);
+    };
+
+    // north indicator of the display's main page, corners as radius 13 offsets,
+    // before: float euler angles and sin/cos
+    auto compassLibm = [&ingest] (size_t n)
+    {
+        static constexpr auto radius = 13.0f;
+        static constexpr auto opening = 17.0f * PI / 180.0f;
+
+        const auto north = PI - EulerAngles (ingest (n).toQuaternion()).yaw;
+
+        for (const auto angle : { north, north + PI + opening, north + PI - opening })
+        {
+            keep (int16_t (lroundf (sinf (angle) * radius)));
+            keep (int16_t (lroundf (cosf (angle) * radius)));
+        }
+    };
+
+    // now: table based on binary angles
+    auto compassTable = [&ingest] (size_t n)
+    {
+        static constexpr int32_t radius = 13;
+        static constexpr auto opening = trig::fromDegrees (17.0);
+
+        const trig::Angle north = trig::halfTurn - trig::yaw (ingest (n));
+        auto scale = [] (int16_t value) { return int16_t ((value * radius + (1 << (trig::fracBits - 1))) >> trig::fracBits); };
+
+        for (const trig::Angle angle : { north, trig::Angle (north + trig::halfTurn + opening), trig::Angle (north + trig::halfTurn - opening) })
+        {
+            keep (scale (trig::sin (angle)));
+            keep (scale (trig::cos (angle)));
+        }
+    };
+
+    // software fusion inputs of each sample as BNO08x::updateFusion() passes them:
+    // gyro Q24, raw sh-2 accel (Q8) and mag (Q4) of the rotated gravity and field
+    struct FusionInput
+    {
+        std::array<int32_t, 3> gyro;
+        std::array<int32_t, 3> accel;
+        std::array<int32_t, 3> mag;
+    };
+
+    const auto fusionInput = [&input]
+    {
+        std::vector<FusionInput> in;
+
+        for (size_t n = 0; n < input.size(); ++n)
+        {
+            const auto& s = input[n];
+            const double x = s[0] / 16384.0, y = s[1] / 16384.0, z = s[2] / 16384.0, w = s[3] / 16384.0;
+
+            // world z and y axes in the sensor frame, third and second row of the rotation matrix
+            const double up[3] { 2.0 * (x * z - w * y), 2.0 * (y * z + w * x), 1.0 - 2.0 * (x * x + y * y) };
+            const double north[3] { 2.0 * (x * y + w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z - w * x) };
+
+            FusionInput f;
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                f.gyro[i] = int32_t (lround (0.5 * sin (0.01 * n + i) * (1 << imu::MahonyFusion::gyroFracBits)));
+                f.accel[i] = int32_t (lround (9.81 * up[i] * (1 << 8)));
+                f.mag[i] = int32_t (lround ((20.0 * north[i] - 40.0 * up[i]) * (1 << 4)));
+            }
+
+            in.push_back (f);
+        }
+
+        return in;
+    }();
+
+    imu::MahonyFusion fusion;
+
+    auto fuse = [&] (size_t n)
+    {
+        const auto& f = fusionInput[n & (fusionInput.size() - 1)];
+        fusion.update (f.gyro, f.accel, f.mag, 10000);
+        keep (fusion.getFixedEnu());
+    };
+
+    // reliability and accuracy smoothing, length as in the sketch
+    static constexpr auto smoothLen = 100;
+    auto reliability = stats::ExpMean<float>::fromLength (smoothLen);
+    auto accuracy = stats::ExpMean<float>::fromLength (smoothLen);
+
+    auto smooth = [&] (size_t n)
+    {
+        // as BNO08x::getCurrentReliability()/getCurrentAccuracy() from raw status and Q12 accuracy
+        const int status = 3 - int (n & 1);
+        const int16_t rawAccuracy = int16_t (200 + (n & 63));
+
+        reliability.add (status / 3.0f);
+        accuracy.add (rawAccuracy * (1.0f / (1 << 12)));
+    };
+
+    // counted from the code of each stage
+    static constexpr FloatOps noOps {};
+    static constexpr FloatOps quaternionProduct { 12, 16, 0, 0, 0, 0 };
+    // ExpMean::add: weight from count (i2f, div, cmp), two adds, one mul; each input one i2f and one mul
+    // toQuaternion() 4 i2f, 4 fmul; all three euler angles: fmul 16, fadd 7, cmp 2, atan2f 2, asinf 1;
+    // corner angles 5 fadd; per corner coordinate sinf/cosf, fmul, rounding fcmp, fadd, f2i
+    static constexpr FloatOps compassLibmOps { 7 + 5 + 6, 4 + 16 + 6, 0, 2 + 6, 4, 6, 0, 0, 3 + 6 };
+    // yaw(): 4 lmul, atan2() 1 ldiv
+    static constexpr FloatOps compassTableOps { 0, 0, 0, 0, 0, 0, 4, 1, 0 };
+    // per component: decode i2f, fmul; midi fadd, fmul, f2i
+    static constexpr FloatOps convertFloatOps { 4, 4 * 2, 0, 0, 4, 4 };
+    static constexpr FloatOps smoothOps { 2 * 2, 2 * 1 + 2, 2 * 1, 2 * 1, 2 * 1 + 2, 0 };
+
+    // alternative formats of the sketch's sendRotationFormats(), without sending;
+    // shared products 9 lmul; euler: toRadians() per angle (i2f, mul), hypot() 2 lmul, atan2() 1 ldiv each;
+    // matrix: floats assembled bitwise
+    RotationFormats formats;
+    static constexpr FloatOps eulerOps { 0, 3, 0, 0, 3, 0, 9 + 2, 3 };
+    static constexpr FloatOps matrixOps { 0, 0, 0, 0, 0, 0, 9, 0 };
+    // MahonyFusion::update() with accel and mag, no integral gain: mul() and the time step product,
+    // getFixedEnu() 8 more
+    static constexpr FloatOps fusionOps { 0, 0, 0, 0, 0, 0, 97 + 8 };
+
+    auto euler = [&]
+    {
+        const auto& angles = formats.getEuler (config::Stream::eulerOrder);
+        keep (Vec3f (trig::toRadians (angles[0]), trig::toRadians (angles[1]), trig::toRadians (angles[2])));
+    };
+
+    auto matrix = [&]
+    {
+        for (const auto element : formats.getMatrix())
+            keep (FixedQuaternion::toFloat (element));
+    };
+
+    const std::vector<Stage> stages {
+        { "ingest", noOps, [&] (size_t n) { keep (ingest (n)); } },
+        { "convert-float", convertFloatOps, convertFloat },
+        { "convert-fixed", noOps, convertFixed },
+        { "reorient", quaternionProduct, [&] (size_t n) { keep (floatInput[n & (floatInput.size() - 1)] + -reorientation); } },
+        { "midi-single", noOps, midiSingle },
+        { "midi", noOps, [&] (size_t n) { keep (midi.sendRotation (ingest (n))); } },
+        { "osc", noOps, [&] (size_t n) { keep (net.sendQuaternion (osc::Address::rotation, ingest (n))); } },
+        { "smooth", smoothOps, smooth },
+        { "compass-libm", compassLibmOps, compassLibm },
+        { "compass-table", compassTableOps, compassTable },
+        { "fusion", fusionOps, fuse },
+        { "euler", eulerOps, [&] (size_t n) { formats.setRotation (ingest (n)); euler(); } },
+        { "matrix", matrixOps, [&] (size_t n) { formats.setRotation (ingest (n)); matrix(); } },
+        { "euler+matrix", eulerOps, [&] (size_t n) { formats.setRotation (ingest (n)); euler(); matrix(); } },
+
+        // rotation path of the main loop for the sensor backend, reorientation is done by the sensor
+        { "chain", smoothOps, [&] (size_t n)
+          {
+              const auto rot = ingest (n);
+              keep (midi.sendRotation (rot));
+              keep (net.sendQuaternion (osc::Address::rotation, rot));
+              smooth (n);
+          } },
+    };
+
+    std::vector<Result> results;
+
+    for (const auto& stage : stages)
+        results.push_back (measure (stage, options));
+
+    keep (reliability.get());
+    keep (accuracy.get());
+
+    printTable (results);
+
+    // usb transfers per sample of the midi stages, each write is one on the firmware
+    for (const auto& stage : stages)
+    {
+        if (strncmp (stage.name, "midi", 4) != 0)
+            continue;
+
+        const auto before = sim::getCounters();
+
+        for (size_t n = 0; n < input.size(); ++n)
+            stage.run (n);
+
+        const auto& after = sim::getCounters();
+        const auto perSample = [&input] (uint64_t count) { return double (count) / input.size(); };
+
+        fprintf (stderr, "%-14s %.2f usb writes, %.2f packets, %.2f flushes per sample\n", stage.name,
+                 perSample (after.midiWrites - before.midiWrites), perSample (after.midiPackets - before.midiPackets),
+                 perSample (after.midiFlushes - before.midiFlushes));
+    }
+
+    auto* out = options.csvFile.empty() ? stdout : fopen (options.csvFile.c_str(), "w");
+
+    if (out == nullptr)
+    {
+        perror (options.csvFile.c_str());
+        return 1;
+    }
+
+    writeCsv (out, results);
+
+    if (out != stdout)
+        fclose (out);
+
+    if (! options.baselineFile.empty() && compare (results, options) > 0)
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/sh
+# build.sh
+#
+# imagination sensor firmware
+# host simulation, benchmark and test build, run from anywhere: sim/build.sh [extra compiler flags]
+#
+# 2024 rumori
+
+set -e
+
+SIM_DIR=$(cd "$(dirname "$0")" && pwd)
+FIRMWARE_DIR="$SIM_DIR/../imag_sensor_feather_m0_bno08x"
+BUILD_DIR="$SIM_DIR/build"
+CXX=${CXX:-g++}
+
+mkdir -p "$BUILD_DIR/obj"
+
+compile()
+{
+    # the sketch is compiled as is, arduino adds the prototypes it needs
+    $CXX -std=gnu++17 -O2 -g -Wall -Wno-misleading-indentation -Wno-unused-variable -Wno-unused-value $EXTRA_FLAGS \
+        -I"$SIM_DIR/include" -I"$SIM_DIR" -I"$FIRMWARE_DIR" \
+        -c -x c++ "$1" -o "$BUILD_DIR/obj/$(basename "$1").o"
+    echo "$BUILD_DIR/obj/$(basename "$1").o"
+}
+
+EXTRA_FLAGS="$*"
+
+# firmware modules and stand-ins, shared by all programs
+COMMON=""
+for source in "$SIM_DIR"/*.cpp "$FIRMWARE_DIR"/*.cpp; do
+    [ "$source" = "$SIM_DIR/imag_sim_main.cpp" ] && continue
+    COMMON="$COMMON $(compile "$source")"
+done
+
+$CXX -o "$BUILD_DIR/imag_sim" $COMMON \
+    "$(compile "$SIM_DIR/imag_sim_main.cpp")" \
+    "$(compile "$FIRMWARE_DIR/imag_sensor_feather_m0_bno08x.ino")"
+echo "built $BUILD_DIR/imag_sim"
+
+$CXX -o "$BUILD_DIR/imag_bench" $COMMON "$(compile "$SIM_DIR/bench/imag_bench.cpp")"
+echo "built $BUILD_DIR/imag_bench"
+
+TESTS=""
+for source in "$SIM_DIR"/test/*.cpp; do
+    TESTS="$TESTS $(compile "$source")"
+done
+
+$CXX -o "$BUILD_DIR/imag_test" $COMMON $TESTS
+echo "built $BUILD_DIR/imag_test"
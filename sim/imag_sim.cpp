@@ -0,0 +1,297 @@
+/* imag_sim.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: virtual clock, scripted inputs, run statistics
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <Arduino.h>
+
+#include "imag_config.h"
+#include "imag_stats.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+
+namespace imag::sim
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+Options options;
+Counters counters;
+
+uint64_t currentTime = 0;
+uint64_t endTime = std::numeric_limits<uint64_t>::max();
+
+// host timing
+stats::Summary<float> loopHostTime;   // [us]
+stats::Summary<float> outputLatency;  // [us]
+stats::Quantile<float> outputLatencyP99 (0.99f);
+Clock::time_point rotationTime;
+Clock::time_point runStart;
+bool rotationPending = false;
+
+double elapsedUs (Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+}
+
+// parse "a,b[,c]" numbers
+std::vector<double> numbers (const char* arg)
+{
+    std::vector<double> values;
+    char* end = nullptr;
+
+    for (auto* p = arg; *p; p = *end ? end + 1 : end)
+    {
+        values.push_back (strtod (p, &end));
+
+        if (end == p)
+            break;
+    }
+
+    return values;
+}
+
+void usage (const char* name)
+{
+    fprintf (stderr,
+             "usage: %s [options]\n"
+             "  --seconds S          virtual run time (default 10)\n"
+             "  --connect MS         wifi client connects MS after ap start, -1: never (default 1000)\n"
+             "  --battery V          battery voltage (default 3.9)\n"
+             "  --motion DEG,HZ      yaw motion amplitude and frequency (default 90,0.25)\n"
+             "  --still MS,LEN       motion paused from MS for LEN ms (repeatable)\n"
+             "  --stall MS,LEN       sensor silent from MS for LEN ms (repeatable)\n"
+             "  --reset MS           sensor resets at MS (repeatable)\n"
+             "  --hang MS            sensor silent from MS until the firmware resets it (repeatable)\n"
+             "  --press BTN,MS,LEN   press button A, B or C at MS for LEN ms (repeatable)\n"
+             "  --target HOST[:PORT] udp target (default 127.0.0.1, port as configured)\n"
+             "  --listen PORT        receive udp on PORT (default firmware port + 1)\n"
+             "  --no-udp             count udp packets without host sockets\n"
+             "  --realtime           run at real time speed, e.g. to talk to host tools\n"
+             "  --serial FILE        serial output (default stdout)\n"
+             "  --midi FILE          log usb midi packets\n"
+             "  --display FILE       write display frames as pbm\n",
+             name);
+    exit (1);
+}
+
+} // namespace
+
+
+const Options& getOptions()
+{
+    return options;
+}
+
+
+void setOptions (const Options& newOptions)
+{
+    options = newOptions;
+}
+
+
+void parseOptions (int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string opt = argv[i];
+        const auto hasValue = i + 1 < argc;
+        const char* value = hasValue ? argv[i + 1] : "";
+
+        if (opt == "--no-udp")
+        {
+            options.udp = false;
+            continue;
+        }
+
+        if (opt == "--realtime")
+        {
+            options.realtime = true;
+            continue;
+        }
+
+        if (! hasValue)
+            usage (argv[0]);
+
+        ++i;
+
+        const auto v = numbers (value);
+        auto ms = [] (double t) { return uint64_t (t * 1000.0); };
+
+        if (opt == "--seconds" && v.size() == 1)
+            options.seconds = v[0];
+        else if (opt == "--connect" && v.size() == 1)
+            options.connectDelay = int32_t (v[0]);
+        else if (opt == "--battery" && v.size() == 1)
+            options.batteryVoltage = float (v[0]);
+        else if (opt == "--motion" && v.size() == 2)
+        {
+            options.yawAmplitude = float (v[0]);
+            options.yawFrequency = float (v[1]);
+        }
+        else if (opt == "--still" && v.size() == 2)
+            options.stills.push_back ({ ms (v[0]), ms (v[0] + v[1]) });
+        else if (opt == "--stall" && v.size() == 2)
+            options.stalls.push_back ({ ms (v[0]), ms (v[0] + v[1]) });
+        else if (opt == "--reset" && v.size() == 1)
+            options.resets.push_back (ms (v[0]));
+        else if (opt == "--hang" && v.size() == 1)
+            options.hangs.push_back (ms (v[0]));
+        else if (opt == "--press" && (value[0] == 'A' || value[0] == 'B' || value[0] == 'C') && value[1] == ',')
+        {
+            static constexpr uint8_t pins[] { config::Button::pinA, config::Button::pinB, config::Button::pinC };
+            const auto t = numbers (value + 2);
+
+            if (t.size() != 2)
+                usage (argv[0]);
+
+            options.presses.push_back ({ pins[value[0] - 'A'], { ms (t[0]), ms (t[0] + t[1]) } });
+        }
+        else if (opt == "--target")
+        {
+            const std::string target = value;
+            const auto colon = target.find (':');
+            options.targetHost = target.substr (0, colon);
+
+            if (colon != std::string::npos)
+                options.targetPort = uint16_t (atoi (target.c_str() + colon + 1));
+        }
+        else if (opt == "--listen" && v.size() == 1)
+            options.listenPort = uint16_t (v[0]);
+        else if (opt == "--serial")
+            options.serialFile = value;
+        else if (opt == "--midi")
+            options.midiFile = value;
+        else if (opt == "--display")
+            options.displayFile = value;
+        else
+            usage (argv[0]);
+    }
+}
+
+void printReport (bool halted)
+{
+    const auto hostSeconds = elapsedUs (runStart) * 1e-6;
+
+    fprintf (stderr, "\nsimulation %s after %.3f s virtual time\n", halted ? "halted" : "finished", currentTime * 1e-6);
+    fprintf (stderr, "  loops             : %llu\n", (unsigned long long) counters.loops);
+    fprintf (stderr, "  sensor reports    : %llu (rotation %llu, resets %llu)\n",
+             (unsigned long long) counters.reports, (unsigned long long) counters.rotationReports,
+             (unsigned long long) counters.sensorResets);
+    fprintf (stderr, "  sensor commands   : %llu\n", (unsigned long long) counters.sensorCommands);
+
+    if (counters.sensorHangs > 0)
+        fprintf (stderr, "  sensor hangs      : %llu, recovered %llu, max recovery %.1f ms\n",
+                 (unsigned long long) counters.sensorHangs, (unsigned long long) counters.hangRecoveries,
+                 counters.maxHangRecovery * 1e-3);
+    fprintf (stderr, "  udp sent          : %llu packets, %llu bytes\n",
+             (unsigned long long) counters.udpPackets, (unsigned long long) counters.udpBytes);
+    fprintf (stderr, "  udp received      : %llu packets\n", (unsigned long long) counters.udpReceived);
+    fprintf (stderr, "  midi              : %llu packets in %llu writes, %llu flushes\n",
+             (unsigned long long) counters.midiPackets, (unsigned long long) counters.midiWrites,
+             (unsigned long long) counters.midiFlushes);
+    fprintf (stderr, "  display frames    : %llu\n", (unsigned long long) counters.displayFrames);
+    fprintf (stderr, "  serial bytes      : %llu\n", (unsigned long long) counters.serialBytes);
+
+    // host figures vary between runs, loop times include waiting with --realtime
+    fprintf (stderr, "host timing\n");
+    fprintf (stderr, "  run time          : %.3f s, %.0f loops/s\n", hostSeconds, counters.loops / std::max (hostSeconds, 1e-9));
+    fprintf (stderr, "  loop us mean/max  : %.2f / %.2f\n", loopHostTime.getMean(), loopHostTime.getMax());
+    fprintf (stderr, "  report to output  : %.2f / %.2f / %.2f us mean/p99/max\n",
+             outputLatency.getMean(), outputLatencyP99.get(), outputLatency.getMax());
+}
+
+
+void beginRun()
+{
+    // setup may take virtual time, the run time counts from start
+    endTime = uint64_t (options.seconds * 1e6);
+    runStart = Clock::now();
+}
+
+
+void countLoop (float hostUs)
+{
+    loopHostTime.add (hostUs);
+    ++counters.loops;
+}
+
+
+Counters& getCounters()
+{
+    return counters;
+}
+
+
+uint64_t now()
+{
+    return currentTime;
+}
+
+
+void advance (uint64_t us)
+{
+    currentTime += us;
+
+    if (currentTime >= endTime)
+        throw End {};
+
+    if (options.realtime)
+        std::this_thread::sleep_until (runStart + std::chrono::microseconds (currentTime));
+
+    updateSensor();
+}
+
+
+void waitForInterrupt()
+{
+    // wake at next sensor report or systick
+    const auto tick = (currentTime / 1000 + 1) * 1000;
+    const auto next = std::max (std::min (getNextSensorEvent(), tick), currentTime + 1);
+
+    advance (next - currentTime);
+}
+
+
+bool isPressed (uint8_t pin)
+{
+    for (const auto& press : options.presses)
+    {
+        if (press.pin == pin && currentTime >= press.window.start && currentTime < press.window.end)
+            return true;
+    }
+
+    return false;
+}
+
+
+void markRotation()
+{
+    rotationTime = Clock::now();
+    rotationPending = true;
+}
+
+
+void markOutput()
+{
+    if (! rotationPending)
+        return;
+
+    const auto latency = float (elapsedUs (rotationTime));
+    outputLatency.add (latency);
+    outputLatencyP99.add (latency);
+    rotationPending = false;
+}
+
+} // namespace imag::sim
+
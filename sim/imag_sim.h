@@ -0,0 +1,117 @@
+/* imag_sim.h
+ * 
+ * imagination sensor firmware
+ * host simulation: virtual clock, scripted inputs, run statistics
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace imag::sim
+{
+/* The firmware runs unmodified against the stand-ins in sim/include.
+   Time is virtual: it only advances in delay(), delayMicroseconds()
+   and when the cpu idles (__WFI), which jumps to the next sensor report
+   or the next 1 ms systick, whichever is first. Given the same options
+   a run is fully deterministic, except for the host timing figures.
+*/
+
+// scripted window on the virtual clock [us]
+struct Window
+{
+    uint64_t start;
+    uint64_t end;
+};
+
+// button press on the virtual clock
+struct Press
+{
+    uint8_t pin;
+    Window window;
+};
+
+struct Options
+{
+    double seconds = 10.0;          // virtual run time
+    int32_t connectDelay = 1000;    // client connects after ap start [ms], negative: never
+    float batteryVoltage = 3.9f;
+
+    float yawAmplitude = 90.0f;     // scripted head motion [deg]
+    float yawFrequency = 0.25f;     // [Hz]
+    std::vector<Window> stills;     // scripted motion paused, sensor kept at rest
+
+    std::vector<Window> stalls;     // sensor silent, interrupt inactive
+    std::vector<uint64_t> resets;   // sensor resets [us]
+    std::vector<uint64_t> hangs;    // sensor silent until reset by the firmware [us]
+    std::vector<Press> presses;
+
+    bool udp = true;                // use host udp sockets
+    bool realtime = false;          // pace virtual time by host time, for live host tools
+    std::string targetHost = "127.0.0.1";
+    uint16_t targetPort = 0;        // 0: as sent by firmware
+    uint16_t listenPort = 0;        // 0: firmware port + 1, which is the target by default
+
+    std::string serialFile;         // serial output, stdout if empty
+    std::string midiFile;           // midi packet log
+    std::string displayFile;        // pbm of last display frame
+};
+
+const Options& getOptions();
+void setOptions (const Options& newOptions);
+
+// parse command line into options, exits with usage on error
+void parseOptions (int argc, char** argv);
+
+// counters of the deterministic part of a run
+struct Counters
+{
+    uint64_t loops = 0;
+    uint64_t reports = 0;
+    uint64_t rotationReports = 0;
+    uint64_t udpPackets = 0;
+    uint64_t udpBytes = 0;
+    uint64_t udpReceived = 0;
+    uint64_t midiWrites = 0;
+    uint64_t midiPackets = 0;
+    uint64_t midiFlushes = 0;
+    uint64_t displayFrames = 0;
+    uint64_t serialBytes = 0;
+    uint64_t sensorResets = 0;
+    uint64_t sensorCommands = 0;    // sh-2 commands sent by the firmware
+    uint64_t sensorHangs = 0;
+    uint64_t hangRecoveries = 0;    // rotation reports again after a hang
+    uint64_t maxHangRecovery = 0;   // hang start to next rotation report [us]
+};
+
+Counters& getCounters();
+
+// virtual clock [us]
+uint64_t now();
+void advance (uint64_t us);
+
+// thrown by the clock when the run time is over
+struct End {};
+
+// run control of imag_sim_main.cpp
+void beginRun();
+void countLoop (float hostUs);
+void printReport (bool halted);
+
+// sensor model, see imag_sim_bno08x.cpp
+uint64_t getNextSensorEvent();
+bool isSensorInterrupt();
+void updateSensor();
+
+// button pin pressed by script?
+bool isPressed (uint8_t pin);
+
+// host time from delivering a rotation report to the next output
+void markRotation();
+void markOutput();
+
+} // namespace imag::sim
@@ -0,0 +1,157 @@
+/* imag_sim_arduino.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: arduino core stand-in
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+
+#include "imag_config.h"
+
+#include <cstdio>
+
+Serial_ Serial;
+Uart Serial1;
+TwoWire Wire;
+SPIClass SPI;
+
+namespace
+{
+std::array<uint8_t, 64> pinState {};
+
+// polls of the clock without time passing, see millis()
+uint32_t idlePolls = 0;
+uint64_t idlePollTime = 0;
+
+// busy waiting on the virtual clock would never end, let 1 us pass now and then
+void poll()
+{
+    using namespace imag::sim;
+
+    if (idlePollTime != now())
+    {
+        idlePollTime = now();
+        idlePolls = 0;
+        return;
+    }
+
+    if (++idlePolls >= 10000)
+        advance (1);
+}
+
+FILE* serialOut()
+{
+    static FILE* out = nullptr;
+
+    if (out == nullptr)
+    {
+        const auto& file = imag::sim::getOptions().serialFile;
+        out = file.empty() ? stdout : fopen (file.c_str(), "wb");
+
+        if (out == nullptr)
+        {
+            perror (file.c_str());
+            out = stdout;
+        }
+    }
+
+    return out;
+}
+} // namespace
+
+
+uint32_t millis()
+{
+    poll();
+    return uint32_t (imag::sim::now() / 1000);
+}
+
+
+uint32_t micros()
+{
+    poll();
+    return uint32_t (imag::sim::now());
+}
+
+
+void delay (uint32_t ms)
+{
+    imag::sim::advance (uint64_t (ms) * 1000);
+}
+
+
+void delayMicroseconds (uint32_t us)
+{
+    imag::sim::advance (us);
+}
+
+
+void pinMode (uint8_t pin, uint8_t mode)
+{
+    if (mode == INPUT_PULLUP && pin < pinState.size())
+        pinState[pin] = HIGH;
+}
+
+
+int digitalRead (uint8_t pin)
+{
+    using namespace imag::sim;
+
+    poll();
+
+    if (pin == imag::config::BNO08x::intPin)
+        return isSensorInterrupt() ? LOW : HIGH;
+
+    if (isPressed (pin))
+        return LOW;
+
+    return pin < pinState.size() ? pinState[pin] : LOW;
+}
+
+
+void digitalWrite (uint8_t pin, int value)
+{
+    if (pin < pinState.size())
+        pinState[pin] = value ? HIGH : LOW;
+}
+
+
+int analogRead (uint8_t pin)
+{
+    // 10-bit conversion of the battery voltage behind the 1:2 divider
+    if (pin == imag::config::Battery::pin)
+        return std::min (int (imag::sim::getOptions().batteryVoltage / 2.0f / 3.3f * 1024.0f), 1023);
+
+    return 0;
+}
+
+
+void analogReadResolution (int) {}
+
+
+void attachInterrupt (int, void (*)(), int)
+{
+    // the cpu wakes on every scripted event anyway
+}
+
+
+void detachInterrupt (int) {}
+
+
+size_t Serial_::write (const uint8_t* buffer, size_t size)
+{
+    imag::sim::getCounters().serialBytes += size;
+    return fwrite (buffer, 1, size, serialOut());
+}
+
+
+void Serial_::flush()
+{
+    fflush (serialOut());
+}
@@ -0,0 +1,479 @@
+/* imag_sim_bno08x.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: BNO08x sensor model and sh-2 api
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <Adafruit_BNO08x.h>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace imag::sim
+{
+namespace
+{
+struct Report
+{
+    uint32_t interval = 0; // [us], 0: disabled
+    uint64_t due = 0;
+    uint8_t sequence = 0;
+};
+
+std::array<Report, SH2_MAX_SENSOR_ID + 1> reports;
+
+sh2_SensorCallback_t* callback = nullptr;
+void* callbackCookie = nullptr;
+
+bool started = false;
+bool resetFlag = false;
+
+// after a reset the sensor announces itself, asserting the interrupt
+bool resetPending = false;
+size_t nextReset = 0;
+
+// a hung sensor stays silent until reset
+bool hung = false;
+bool hangRecovering = false;
+uint64_t hangStart = 0;
+size_t nextHang = 0;
+
+uint8_t calConfig = SH2_CAL_ACCEL | SH2_CAL_MAG;
+std::vector<uint32_t> userRecord;
+
+// report value fractional bits (Q points) per sensor id
+int getFracBits (uint8_t id)
+{
+    switch (id)
+    {
+    case SH2_ACCELEROMETER:
+    case SH2_LINEAR_ACCELERATION:
+    case SH2_GRAVITY:
+        return 8;
+    case SH2_GYROSCOPE_CALIBRATED:
+        return 9;
+    case SH2_MAGNETIC_FIELD_CALIBRATED:
+        return 4;
+    case SH2_ROTATION_VECTOR:
+    case SH2_GAME_ROTATION_VECTOR:
+    case SH2_GEOMAGNETIC_ROTATION_VECTOR:
+    case SH2_ARVR_STABILIZED_RV:
+    case SH2_ARVR_STABILIZED_GRV:
+        return 14;
+    default:
+        return 0;
+    }
+}
+
+bool isRotation (uint8_t id)
+{
+    return getFracBits (id) == 14;
+}
+
+bool hasAccuracy (uint8_t id)
+{
+    return id == SH2_ROTATION_VECTOR || id == SH2_GEOMAGNETIC_ROTATION_VECTOR || id == SH2_ARVR_STABILIZED_RV;
+}
+
+bool isStalled (uint64_t t)
+{
+    if (hung)
+        return true;
+
+    for (const auto& stall : getOptions().stalls)
+    {
+        if (t >= stall.start && t < stall.end)
+            return true;
+    }
+
+    return false;
+}
+
+// one sh-2 command sent by the host, over the bus on the sensor
+int command()
+{
+    ++getCounters().sensorCommands;
+    return SH2_OK;
+}
+
+void reset()
+{
+    for (auto& report : reports)
+        report = {};
+
+    resetFlag = true;
+    resetPending = true;
+    hung = false;
+}
+
+// scripted motion: yaw oscillation with a slower pitch component, paused while still
+void evaluate (uint64_t time, std::array<double, 4>& quat, std::array<double, 3>& gyro)
+{
+    const auto& options = getOptions();
+
+    // motion time excludes the still windows passed, so the pose continues where it paused
+    auto still = false;
+    auto paused = uint64_t (0);
+
+    for (const auto& window : options.stills)
+    {
+        if (time >= window.start)
+            paused += std::min (time, window.end) - window.start;
+
+        still |= time >= window.start && time < window.end;
+    }
+
+    const auto t = (time - paused) * 1e-6;
+    const auto omega = 2.0 * M_PI * options.yawFrequency;
+    const auto amplitude = options.yawAmplitude * M_PI / 180.0;
+
+    const auto yaw = amplitude * sin (omega * t);
+    const auto pitch = 0.2 * amplitude * sin (0.5 * omega * t);
+
+    const auto cy = cos (0.5 * yaw), sy = sin (0.5 * yaw);
+    const auto cp = cos (0.5 * pitch), sp = sin (0.5 * pitch);
+
+    quat = { -sp * sy, sp * cy, cp * sy, cp * cy }; // i, j, k, real
+    gyro = { 0.0, 0.1 * amplitude * omega * cos (0.5 * omega * t), amplitude * omega * cos (omega * t) };
+
+    if (still)
+        gyro = {};
+}
+
+void putValue (sh2_SensorEvent_t& event, size_t index, double value, int fracBits)
+{
+    const auto raw = int16_t (std::lround (std::max (-32768.0, std::min (32767.0, value * (1 << fracBits)))));
+    event.report[4 + 2 * index] = uint8_t (raw & 0xff);
+    event.report[5 + 2 * index] = uint8_t ((raw >> 8) & 0xff);
+}
+
+double getValue (const sh2_SensorEvent_t& event, size_t index, int fracBits)
+{
+    const auto raw = int16_t (event.report[4 + 2 * index] | event.report[5 + 2 * index] << 8);
+    return double (raw) / (1 << fracBits);
+}
+
+void makeEvent (uint8_t id, Report& report, sh2_SensorEvent_t& event)
+{
+    event = {};
+    event.timestamp_uS = now();
+    event.reportId = id;
+    event.report[0] = id;
+    event.report[1] = report.sequence++;
+    event.report[2] = 0x03; // accuracy high
+    event.len = 4 + 6;
+
+    std::array<double, 4> quat;
+    std::array<double, 3> gyro;
+    evaluate (now(), quat, gyro);
+
+    const auto fracBits = getFracBits (id);
+
+    switch (id)
+    {
+    case SH2_ACCELEROMETER:
+    case SH2_GRAVITY:
+        putValue (event, 2, 9.81, fracBits);
+        break;
+    case SH2_GYROSCOPE_CALIBRATED:
+        for (size_t i = 0; i < 3; ++i)
+            putValue (event, i, gyro[i], fracBits);
+        break;
+    case SH2_MAGNETIC_FIELD_CALIBRATED:
+        putValue (event, 0, 20.0, fracBits);
+        putValue (event, 2, -40.0, fracBits);
+        break;
+    case SH2_STABILITY_CLASSIFIER:
+        // stable (3) below a small angular rate, motion (4) otherwise
+        event.report[4] = std::hypot (gyro[0], gyro[1], gyro[2]) < 0.05 ? 3 : 4;
+        event.len = 4 + 4;
+        break;
+    default:
+        break;
+    }
+
+    if (isRotation (id))
+    {
+        for (size_t i = 0; i < 4; ++i)
+            putValue (event, i, quat[i], fracBits);
+
+        event.len = 4 + 8;
+
+        if (hasAccuracy (id))
+        {
+            putValue (event, 4, 0.05, 12); // [rad]
+            event.len += 2;
+        }
+    }
+}
+
+} // namespace
+
+
+uint64_t getNextSensorEvent()
+{
+    auto next = UINT64_MAX;
+
+    if (! started || hung)
+        return next;
+
+    if (resetPending)
+        next = now();
+
+    for (const auto& report : reports)
+    {
+        if (report.interval > 0)
+            next = std::min (next, report.due);
+    }
+
+    // a report due while stalled shows up when the stall ends
+    for (const auto& stall : getOptions().stalls)
+    {
+        if (next >= stall.start && next < stall.end)
+            next = stall.end;
+    }
+
+    return next;
+}
+
+
+bool isSensorInterrupt()
+{
+    return started && ! isStalled (now()) && getNextSensorEvent() <= now();
+}
+
+
+void updateSensor()
+{
+    const auto& resets = getOptions().resets;
+
+    while (nextReset < resets.size() && resets[nextReset] <= now())
+    {
+        ++nextReset;
+
+        if (started)
+        {
+            reset();
+            ++getCounters().sensorResets;
+        }
+    }
+
+    const auto& hangs = getOptions().hangs;
+
+    while (nextHang < hangs.size() && hangs[nextHang] <= now())
+    {
+        ++nextHang;
+
+        if (started && ! hung)
+        {
+            hung = hangRecovering = true;
+            hangStart = now();
+            ++getCounters().sensorHangs;
+        }
+    }
+}
+
+} // namespace imag::sim
+
+
+using namespace imag::sim;
+
+int sh2_setSensorCallback (sh2_SensorCallback_t* newCallback, void* cookie)
+{
+    callback = newCallback;
+    callbackCookie = cookie;
+    return SH2_OK;
+}
+
+
+void sh2_service()
+{
+    const auto t = now();
+
+    if (! started || isStalled (t))
+        return;
+
+    // reset announcement, no sensor event
+    if (resetPending)
+    {
+        resetPending = false;
+        return;
+    }
+
+    // oldest due report
+    uint8_t id = 0;
+
+    for (uint8_t i = 1; i < reports.size(); ++i)
+    {
+        if (reports[i].interval > 0 && reports[i].due <= t && (id == 0 || reports[i].due < reports[id].due))
+            id = i;
+    }
+
+    if (id == 0)
+        return;
+
+    auto& report = reports[id];
+
+    // the sensor drops reports it could not deliver, e.g. during a stall
+    if (t - report.due > report.interval)
+        report.due += (t - report.due) / report.interval * report.interval;
+
+    report.due += report.interval;
+
+    sh2_SensorEvent_t event;
+    makeEvent (id, report, event);
+
+    ++getCounters().reports;
+
+    if (isRotation (id))
+    {
+        ++getCounters().rotationReports;
+        markRotation();
+
+        if (hangRecovering)
+        {
+            hangRecovering = false;
+            ++getCounters().hangRecoveries;
+            getCounters().maxHangRecovery = std::max (getCounters().maxHangRecovery, t - hangStart);
+        }
+    }
+
+    if (callback != nullptr)
+        callback (callbackCookie, &event);
+}
+
+
+int sh2_decodeSensorEvent (sh2_SensorValue_t* value, const sh2_SensorEvent_t* event)
+{
+    *value = {};
+    value->timestamp = event->timestamp_uS;
+    value->sensorId = event->reportId;
+    value->sequence = event->report[1];
+    value->status = event->report[2] & 0x03;
+    value->delay = ((event->report[2] & 0xfc) << 6) + event->report[3];
+
+    const auto fracBits = getFracBits (event->reportId);
+    auto v = [event, fracBits] (size_t index) { return float (getValue (*event, index, fracBits)); };
+
+    if (isRotation (event->reportId))
+    {
+        // same layout for all rotation vector variants
+        value->un.rotationVector = { v (0), v (1), v (2), v (3),
+                                     hasAccuracy (event->reportId) ? float (getValue (*event, 4, 12)) : 0.0f };
+    }
+    else if (fracBits > 0)
+    {
+        value->un.accelerometer = { v (0), v (1), v (2) };
+    }
+    else if (event->reportId == SH2_STABILITY_CLASSIFIER)
+    {
+        value->un.stabilityClassifier.classification = event->report[4];
+    }
+
+    return SH2_OK;
+}
+
+
+int sh2_reinitialize() { return command(); }
+int sh2_devReset() { reset(); return command(); }
+int sh2_devOn() { return command(); }
+int sh2_devSleep() { return command(); }
+
+// tare and reorientation are accepted, the scripted motion is not altered
+int sh2_setTareNow (uint8_t, sh2_TareBasis_t) { return command(); }
+int sh2_clearTare() { return command(); }
+int sh2_persistTare() { return command(); }
+int sh2_setReorientation (sh2_Quaternion_t*) { return command(); }
+
+int sh2_saveDcdNow() { return command(); }
+int sh2_clearDcdAndReset() { reset(); return command(); }
+int sh2_setCalConfig (uint8_t sensors) { calConfig = sensors; return command(); }
+int sh2_getCalConfig (uint8_t* sensors) { *sensors = calConfig; return command(); }
+
+
+int sh2_getFrs (uint16_t recordType, uint32_t* data, uint16_t* words)
+{
+    if (recordType != USER_RECORD)
+        return SH2_ERR;
+
+    *words = uint16_t (std::min<size_t> (*words, userRecord.size()));
+    std::copy_n (userRecord.begin(), *words, data);
+
+    return command();
+}
+
+
+int sh2_setFrs (uint16_t recordType, uint32_t* data, uint16_t words)
+{
+    if (recordType != USER_RECORD)
+        return SH2_ERR;
+
+    userRecord.assign (data, data + words);
+
+    return command();
+}
+
+
+bool Adafruit_BNO08x::begin_I2C (uint8_t, TwoWire*, int32_t)
+{
+    // begin involves a hardware reset
+    hardwareReset();
+    return true;
+}
+
+
+bool Adafruit_BNO08x::begin_UART (Uart*, int32_t)
+{
+    hardwareReset();
+    return true;
+}
+
+
+bool Adafruit_BNO08x::begin_SPI (uint8_t, uint8_t, SPIClass*, int32_t)
+{
+    hardwareReset();
+    return true;
+}
+
+
+void Adafruit_BNO08x::hardwareReset()
+{
+    started = true;
+    reset();
+}
+
+
+bool Adafruit_BNO08x::wasReset()
+{
+    const auto res = resetFlag;
+    resetFlag = false;
+    return res;
+}
+
+
+bool Adafruit_BNO08x::enableReport (sh2_SensorId_t sensor, uint32_t interval_us)
+{
+    if (sensor >= reports.size())
+        return false;
+
+    auto& report = reports[sensor];
+    report.interval = interval_us;
+    report.due = now() + interval_us;
+    command();
+
+    return true;
+}
+
+
+bool Adafruit_BNO08x::getSensorEvent (sh2_SensorValue_t* value)
+{
+    // plain library path, the firmware installs its own handler
+    (void) value;
+    sh2_service();
+    return false;
+}
@@ -0,0 +1,182 @@
+/* imag_sim_display.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: SH1107 framebuffer, written as pbm
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <Adafruit_SH110X.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+Adafruit_SH1107::Adafruit_SH1107 (uint16_t w, uint16_t h, TwoWire*, int8_t)
+    : rawWidth (int16_t (w)),
+      rawHeight (int16_t (h)),
+      buffer (size_t (w) * h, 0)
+{
+}
+
+
+bool Adafruit_SH1107::begin (uint8_t, bool)
+{
+    clearDisplay();
+    return true;
+}
+
+
+void Adafruit_SH1107::oled_command (uint8_t c)
+{
+    if (c == SH110X_DISPLAYON)
+        on = true;
+    else if (c == SH110X_DISPLAYOFF)
+        on = false;
+}
+
+
+void Adafruit_SH1107::display()
+{
+    ++imag::sim::getCounters().displayFrames;
+
+    const auto& file = imag::sim::getOptions().displayFile;
+
+    if (file.empty())
+        return;
+
+    // rewritten per frame, the file holds the latest one
+    auto* out = fopen (file.c_str(), "w");
+
+    if (out == nullptr)
+        return;
+
+    fprintf (out, "P1\n%d %d\n", width(), height());
+
+    for (int16_t y = 0; y < height(); ++y)
+    {
+        for (int16_t x = 0; x < width(); ++x)
+        {
+            // pbm: 1 is black, lit pixels are drawn dark
+            const auto index = size_t (y) * width() + x;
+            fputc (on && buffer[index] ? '1' : '0', out);
+        }
+
+        fputc ('\n', out);
+    }
+
+    fclose (out);
+}
+
+
+void Adafruit_SH1107::drawPixel (int16_t x, int16_t y, uint16_t color)
+{
+    if (x < 0 || y < 0 || x >= width() || y >= height())
+        return;
+
+    auto& pixel = buffer[size_t (y) * width() + x];
+
+    if (color == SH110X_INVERSE)
+        pixel = ! pixel;
+    else
+        pixel = color == SH110X_WHITE;
+}
+
+
+void Adafruit_SH1107::drawLine (int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+    // bresenham
+    const int dx = abs (x1 - x0), sx = x0 < x1 ? 1 : -1;
+    const int dy = -abs (y1 - y0), sy = y0 < y1 ? 1 : -1;
+    auto err = dx + dy;
+
+    while (true)
+    {
+        drawPixel (x0, y0, color);
+
+        if (x0 == x1 && y0 == y1)
+            break;
+
+        const auto e2 = 2 * err;
+
+        if (e2 >= dy)
+        {
+            err += dy;
+            x0 += sx;
+        }
+
+        if (e2 <= dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+
+void Adafruit_SH1107::drawRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    drawFastHLine (x, y, w, color);
+    drawFastHLine (x, y + h - 1, w, color);
+    drawFastVLine (x, y, h, color);
+    drawFastVLine (x + w - 1, y, h, color);
+}
+
+
+void Adafruit_SH1107::fillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    for (int16_t j = y; j < y + h; ++j)
+    {
+        for (int16_t i = x; i < x + w; ++i)
+            drawPixel (i, j, color);
+    }
+}
+
+
+void Adafruit_SH1107::fillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color)
+{
+    const auto minX = std::min ({ x0, x1, x2 }), maxX = std::max ({ x0, x1, x2 });
+    const auto minY = std::min ({ y0, y1, y2 }), maxY = std::max ({ y0, y1, y2 });
+
+    // inside if on the same side of all edges
+    auto edge = [] (int ax, int ay, int bx, int by, int px, int py) { return (bx - ax) * (py - ay) - (by - ay) * (px - ax); };
+
+    for (int16_t y = minY; y <= maxY; ++y)
+    {
+        for (int16_t x = minX; x <= maxX; ++x)
+        {
+            const auto e0 = edge (x0, y0, x1, y1, x, y);
+            const auto e1 = edge (x1, y1, x2, y2, x, y);
+            const auto e2 = edge (x2, y2, x0, y0, x, y);
+
+            if ((e0 >= 0 && e1 >= 0 && e2 >= 0) || (e0 <= 0 && e1 <= 0 && e2 <= 0))
+                drawPixel (x, y, color);
+        }
+    }
+}
+
+
+size_t Adafruit_SH1107::write (uint8_t c)
+{
+    static constexpr int16_t charWidth = 6;
+    static constexpr int16_t charHeight = 8;
+
+    if (c == '\n')
+    {
+        cursorX = 0;
+        cursorY += charHeight * textSize;
+        return 1;
+    }
+
+    if (c == '\r')
+        return 1;
+
+    // placeholder cell, a spare column and row like the font
+    if (c != ' ')
+        fillRect (cursorX, cursorY + textSize, (charWidth - 1) * textSize, (charHeight - 2) * textSize, textColor);
+
+    cursorX += charWidth * textSize;
+
+    return 1;
+}
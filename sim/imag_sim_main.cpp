@@ -0,0 +1,54 @@
+/* imag_sim_main.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: runs the sketch on the virtual clock
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <Arduino.h>
+
+#include <chrono>
+
+// sketch entry points
+void setup();
+void loop();
+
+
+int main (int argc, char** argv)
+{
+    using namespace imag::sim;
+    using Clock = std::chrono::steady_clock;
+
+    parseOptions (argc, argv);
+    beginRun();
+
+    auto halted = false;
+
+    try
+    {
+        setup();
+
+        while (true)
+        {
+            const auto loopStart = Clock::now();
+            loop();
+            countLoop (std::chrono::duration<float, std::micro> (Clock::now() - loopStart).count());
+        }
+    }
+    catch (const End&)
+    {
+        // halted if still in setup, e.g. Debug::halt()
+        halted = getCounters().loops == 0;
+    }
+
+    Serial.flush();
+    printReport (halted);
+
+    // a sensor hang the firmware did not recover from fails the run
+    const auto& counters = getCounters();
+
+    return halted ? 2 : counters.hangRecoveries < counters.sensorHangs ? 1 : 0;
+}
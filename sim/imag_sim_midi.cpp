@@ -0,0 +1,65 @@
+/* imag_sim_midi.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: usb midi packet log
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <MIDIUSB.h>
+
+#include <cstdio>
+
+MIDI_ MidiUSB;
+USBDevice_ USBDevice;
+
+namespace
+{
+// one line per packet: time [ms], header, data bytes
+FILE* midiOut()
+{
+    static FILE* out = nullptr;
+    static bool opened = false;
+
+    if (! opened)
+    {
+        opened = true;
+        const auto& file = imag::sim::getOptions().midiFile;
+
+        if (! file.empty() && (out = fopen (file.c_str(), "w")) == nullptr)
+            perror (file.c_str());
+    }
+
+    return out;
+}
+
+} // namespace
+
+
+size_t MIDI_::write (const uint8_t* buffer, size_t size)
+{
+    using namespace imag::sim;
+
+    auto* out = midiOut();
+    ++getCounters().midiWrites;
+
+    for (size_t i = 0; i + 4 <= size; i += 4)
+    {
+        ++getCounters().midiPackets;
+
+        if (out != nullptr)
+            fprintf (out, "%.3f %02x %02x %02x %02x\n", now() * 1e-3, buffer[i], buffer[i + 1], buffer[i + 2], buffer[i + 3]);
+    }
+
+    markOutput();
+
+    return size;
+}
+
+
+void MIDI_::flush()
+{
+    ++imag::sim::getCounters().midiFlushes;
+}
@@ -0,0 +1,275 @@
+/* imag_sim_osc.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: osc 1.0 message encoding and parsing
+ * 
+ * 2024 rumori
+ */
+
+#include <LiteOSCParser.h>
+
+#include <cstring>
+
+namespace qindesign::osc
+{
+namespace
+{
+size_t padded (size_t size)
+{
+    return (size + 4) & ~size_t (3);
+}
+
+size_t paddedData (size_t size)
+{
+    return (size + 3) & ~size_t (3);
+}
+
+void putString (std::vector<uint8_t>& out, const std::string& s)
+{
+    const auto start = out.size();
+    out.resize (start + padded (s.size()), 0);
+    memcpy (out.data() + start, s.data(), s.size());
+}
+
+void putBigEndian (uint8_t* out, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        out[i] = uint8_t (value >> (8 * (size - 1 - i)));
+}
+
+} // namespace
+
+
+LiteOSCParser::LiteOSCParser (int bufCapacity, int maxArgs)
+    : capacity (size_t (bufCapacity)),
+      maxArgs (size_t (maxArgs))
+{
+    init ("");
+}
+
+
+bool LiteOSCParser::init (const char* newAddress)
+{
+    address = newAddress;
+    tags.clear();
+    args.clear();
+    offsets.clear();
+    compose();
+
+    return buffer.size() <= capacity;
+}
+
+
+bool LiteOSCParser::addInt (int32_t value)
+{
+    uint8_t data[4];
+    putBigEndian (data, uint32_t (value), 4);
+    return add ('i', data, 4);
+}
+
+
+bool LiteOSCParser::addFloat (float value)
+{
+    uint32_t bits;
+    memcpy (&bits, &value, 4);
+
+    uint8_t data[4];
+    putBigEndian (data, bits, 4);
+    return add ('f', data, 4);
+}
+
+
+bool LiteOSCParser::addString (const char* value)
+{
+    const auto length = strlen (value);
+    std::vector<uint8_t> data (padded (length), 0);
+    memcpy (data.data(), value, length);
+    return add ('s', data.data(), data.size());
+}
+
+
+bool LiteOSCParser::addBlob (const uint8_t* data, int32_t size)
+{
+    std::vector<uint8_t> blob (4 + paddedData (size_t (size)), 0);
+    putBigEndian (blob.data(), uint32_t (size), 4);
+    memcpy (blob.data() + 4, data, size_t (size));
+    return add ('b', blob.data(), blob.size());
+}
+
+
+bool LiteOSCParser::addTime (uint64_t value)
+{
+    uint8_t data[8];
+    putBigEndian (data, value, 8);
+    return add ('t', data, 8);
+}
+
+
+bool LiteOSCParser::add (char tag, const uint8_t* data, size_t size)
+{
+    if (tags.size() >= maxArgs)
+        return false;
+
+    // the tag string may grow by a padding word
+    const auto tagGrowth = padded (tags.size() + 2) - padded (tags.size() + 1);
+
+    if (buffer.size() + tagGrowth + size > capacity)
+        return false;
+
+    // in place, as the library builds into its fixed buffer
+    const auto tagStart = padded (address.size());
+
+    if (tagGrowth > 0)
+        buffer.insert (buffer.begin() + tagStart + padded (tags.size() + 1), tagGrowth, 0);
+
+    buffer[tagStart + 1 + tags.size()] = uint8_t (tag);
+    buffer.insert (buffer.end(), data, data + size);
+
+    tags += tag;
+    offsets.push_back (args.size());
+    args.insert (args.end(), data, data + size);
+
+    return true;
+}
+
+
+void LiteOSCParser::compose()
+{
+    buffer.clear();
+    putString (buffer, address);
+    putString (buffer, "," + tags);
+    buffer.insert (buffer.end(), args.begin(), args.end());
+}
+
+
+bool LiteOSCParser::parse (const uint8_t* buf, int32_t size)
+{
+    init ("");
+
+    const auto end = size_t (size);
+
+    if (size <= 0 || end > capacity || end % 4 != 0)
+        return false;
+
+    auto readString = [buf, end] (size_t& pos, std::string& s)
+    {
+        const auto* start = reinterpret_cast<const char*> (buf + pos);
+        const auto length = strnlen (start, end - pos);
+
+        if (pos + length >= end)
+            return false;
+
+        s.assign (start, length);
+        pos += padded (length);
+        return pos <= end;
+    };
+
+    size_t pos = 0;
+    std::string typeTags;
+
+    if (! readString (pos, address) || address.empty() || address[0] != '/')
+        return false;
+
+    // messages without type tag string have no arguments
+    if (pos == end)
+    {
+        compose();
+        return true;
+    }
+
+    if (! readString (pos, typeTags) || typeTags.empty() || typeTags[0] != ',')
+        return false;
+
+    typeTags.erase (0, 1);
+
+    if (typeTags.size() > maxArgs)
+        return false;
+
+    for (const auto tag : typeTags)
+    {
+        size_t argSize = 0;
+
+        switch (tag)
+        {
+        case 'i':
+        case 'f':
+            argSize = 4;
+            break;
+        case 't':
+            argSize = 8;
+            break;
+        case 's':
+            argSize = padded (strnlen (reinterpret_cast<const char*> (buf + pos), end - pos));
+            break;
+        case 'b':
+            if (pos + 4 > end)
+                return false;
+            argSize = 4 + paddedData (size_t (buf[pos]) << 24 | size_t (buf[pos + 1]) << 16 | size_t (buf[pos + 2]) << 8 | buf[pos + 3]);
+            break;
+        default:
+            return false;
+        }
+
+        if (pos + argSize > end)
+            return false;
+
+        tags += tag;
+        offsets.push_back (args.size());
+        args.insert (args.end(), buf + pos, buf + pos + argSize);
+        pos += argSize;
+    }
+
+    compose();
+
+    return pos == end;
+}
+
+
+uint32_t LiteOSCParser::readWord (size_t offset) const
+{
+    return uint32_t (args[offset]) << 24 | uint32_t (args[offset + 1]) << 16 | uint32_t (args[offset + 2]) << 8 | args[offset + 3];
+}
+
+
+int32_t LiteOSCParser::getInt (int index) const
+{
+    return isInt (index) ? int32_t (readWord (offsets[index])) : 0;
+}
+
+
+float LiteOSCParser::getFloat (int index) const
+{
+    if (! isFloat (index))
+        return 0.0f;
+
+    const auto bits = readWord (offsets[index]);
+    float value;
+    memcpy (&value, &bits, 4);
+    return value;
+}
+
+
+const char* LiteOSCParser::getString (int index) const
+{
+    return isString (index) ? reinterpret_cast<const char*> (args.data() + offsets[index]) : nullptr;
+}
+
+
+int LiteOSCParser::getBlobLength (int index) const
+{
+    return isBlob (index) ? int (readWord (offsets[index])) : 0;
+}
+
+
+const uint8_t* LiteOSCParser::getBlob (int index) const
+{
+    return isBlob (index) ? args.data() + offsets[index] + 4 : nullptr;
+}
+
+
+uint64_t LiteOSCParser::getTime (int index) const
+{
+    return isTime (index) ? uint64_t (readWord (offsets[index])) << 32 | readWord (offsets[index] + 4) : 0;
+}
+
+} // namespace qindesign::osc
@@ -0,0 +1,169 @@
+/* imag_sim_wifi.cpp
+ * 
+ * imagination sensor firmware
+ * host simulation: access point and udp on host sockets
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_sim.h"
+
+#include <WiFi101.h>
+#include <WiFiUdp.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+WiFiClass WiFi;
+
+using namespace imag::sim;
+
+
+uint8_t WiFiClass::status()
+{
+    const auto connectDelay = getOptions().connectDelay;
+
+    if (apStatus == WL_AP_LISTENING && connectDelay >= 0 && now() >= apStart + uint64_t (connectDelay) * 1000)
+        apStatus = WL_AP_CONNECTED;
+
+    return apStatus;
+}
+
+
+uint8_t WiFiClass::beginAP (const char* newSsid, const char*, uint8_t)
+{
+    ssid = newSsid;
+    apStart = now();
+    apStatus = WL_AP_LISTENING;
+
+    return apStatus;
+}
+
+
+uint8_t WiFiUDP::begin (uint16_t port)
+{
+    stop();
+
+    if (! getOptions().udp)
+        return 1;
+
+    fd = socket (AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0)
+    {
+        perror ("WiFiUDP: socket");
+        return 0;
+    }
+
+    // the loop polls, never block it
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+    // the firmware port is left to a receiver on the same host
+    const auto listenPort = getOptions().listenPort != 0 ? getOptions().listenPort : uint16_t (port + 1);
+
+    sockaddr_in local {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl (INADDR_ANY);
+    local.sin_port = htons (listenPort);
+
+    // receiving is optional, e.g. if another instance holds the port
+    if (bind (fd, reinterpret_cast<sockaddr*> (&local), sizeof (local)) < 0)
+        perror ("WiFiUDP: bind");
+    else
+        fprintf (stderr, "udp: listening on port %u\n", listenPort);
+
+    return 1;
+}
+
+
+void WiFiUDP::stop()
+{
+    if (fd >= 0)
+        close (fd);
+
+    fd = -1;
+}
+
+
+int WiFiUDP::beginPacket (IPAddress, uint16_t port)
+{
+    // the firmware address is on the sensor network, send to the host target instead
+    tx.clear();
+    targetPort = getOptions().targetPort != 0 ? getOptions().targetPort : port;
+
+    return 1;
+}
+
+
+size_t WiFiUDP::write (const uint8_t* buffer, size_t size)
+{
+    tx.insert (tx.end(), buffer, buffer + size);
+    return size;
+}
+
+
+int WiFiUDP::endPacket()
+{
+    auto& counters = getCounters();
+    ++counters.udpPackets;
+    counters.udpBytes += tx.size();
+    markOutput();
+
+    if (fd < 0)
+        return getOptions().udp ? 0 : 1;
+
+    addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* target = nullptr;
+
+    if (getaddrinfo (getOptions().targetHost.c_str(), std::to_string (targetPort).c_str(), &hints, &target) != 0)
+        return 0;
+
+    const auto sent = sendto (fd, tx.data(), tx.size(), 0, target->ai_addr, target->ai_addrlen);
+    freeaddrinfo (target);
+
+    // a full socket buffer drops like the radio would
+    return sent == ssize_t (tx.size()) ? 1 : 0;
+}
+
+
+int WiFiUDP::parsePacket()
+{
+    rx.clear();
+    rxPos = 0;
+
+    if (fd < 0)
+        return 0;
+
+    uint8_t buffer[1500];
+    sockaddr_in remote {};
+    socklen_t remoteSize = sizeof (remote);
+
+    const auto size = recvfrom (fd, buffer, sizeof (buffer), 0, reinterpret_cast<sockaddr*> (&remote), &remoteSize);
+
+    if (size <= 0)
+        return 0;
+
+    rx.assign (buffer, buffer + size);
+    remoteAddress = IPAddress (uint32_t (remote.sin_addr.s_addr));
+    remotePortNumber = ntohs (remote.sin_port);
+    ++getCounters().udpReceived;
+
+    return int (size);
+}
+
+
+int WiFiUDP::read (uint8_t* buffer, size_t size)
+{
+    const auto n = std::min (size, rx.size() - rxPos);
+    memcpy (buffer, rx.data() + rxPos, n);
+    rxPos += n;
+
+    return int (n);
+}
@@ -0,0 +1,69 @@
+/* Quaternion.hpp
+ * 
+ * imagination sensor firmware
+ * host simulation: the subset of Arduino-Helpers' Quaternion used by the firmware
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <cmath>
+
+struct Vec3f
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    Vec3f() = default;
+    Vec3f (float x, float y, float z) : x (x), y (y), z (z) {}
+};
+
+
+struct Quaternion
+{
+    float w = 1.0f, x = 0.0f, y = 0.0f, z = 0.0f;
+
+    Quaternion() = default;
+    Quaternion (float w, float x, float y, float z) : w (w), x (x), y (y), z (z) {}
+
+    static Quaternion identity() { return {}; }
+
+    float normSquared() const { return w * w + x * x + y * y + z * z; }
+    float norm() const { return std::sqrt (normSquared()); }
+
+    Quaternion& normalize() { *this = normalized(); return *this; }
+    Quaternion normalized() const { const auto n = norm(); return { w / n, x / n, y / n, z / n }; }
+
+    Quaternion conjugated() const { return { w, -x, -y, -z }; }
+    Quaternion operator-() const { return conjugated(); }
+
+    // hamiltonian product
+    Quaternion operator* (const Quaternion& q) const
+    {
+        return { w * q.w - x * q.x - y * q.y - z * q.z,
+                 w * q.x + x * q.w + y * q.z - z * q.y,
+                 w * q.y - x * q.z + y * q.w + z * q.x,
+                 w * q.z + x * q.y - y * q.x + z * q.w };
+    }
+    Quaternion& operator*= (const Quaternion& q) { return *this = *this * q; }
+
+    // rotation composition, as the library spells the product
+    Quaternion operator+ (const Quaternion& q) const { return *this * q; }
+    Quaternion& operator+= (const Quaternion& q) { return *this = *this * q; }
+};
+
+
+struct EulerAngles
+{
+    float yaw = 0.0f, pitch = 0.0f, roll = 0.0f;
+
+    EulerAngles() = default;
+    EulerAngles (float yaw, float pitch, float roll) : yaw (yaw), pitch (pitch), roll (roll) {}
+
+    // z-y'-x" convention
+    EulerAngles (const Quaternion& q)
+        : yaw (std::atan2 (2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z))),
+          pitch (std::asin (std::fmax (-1.0f, std::fmin (1.0f, 2 * (q.w * q.y - q.z * q.x))))),
+          roll (std::atan2 (2 * (q.w * q.x + q.y * q.z), 1 - 2 * (q.x * q.x + q.y * q.y)))
+    {}
+};
@@ -0,0 +1,175 @@
+/* Adafruit_BNO08x.h
+ * 
+ * imagination sensor firmware
+ * host simulation: BNO08x stand-in generating sh-2 sensor reports
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+
+#define SH2_OK 0
+#define SH2_ERR (-1)
+
+#define SH2_ACCELEROMETER 0x01
+#define SH2_GYROSCOPE_CALIBRATED 0x02
+#define SH2_MAGNETIC_FIELD_CALIBRATED 0x03
+#define SH2_LINEAR_ACCELERATION 0x04
+#define SH2_ROTATION_VECTOR 0x05
+#define SH2_GRAVITY 0x06
+#define SH2_GYROSCOPE_UNCALIBRATED 0x07
+#define SH2_GAME_ROTATION_VECTOR 0x08
+#define SH2_GEOMAGNETIC_ROTATION_VECTOR 0x09
+#define SH2_PRESSURE 0x0a
+#define SH2_AMBIENT_LIGHT 0x0b
+#define SH2_HUMIDITY 0x0c
+#define SH2_PROXIMITY 0x0d
+#define SH2_TEMPERATURE 0x0e
+#define SH2_MAGNETIC_FIELD_UNCALIBRATED 0x0f
+#define SH2_TAP_DETECTOR 0x10
+#define SH2_STEP_COUNTER 0x11
+#define SH2_SIGNIFICANT_MOTION 0x12
+#define SH2_STABILITY_CLASSIFIER 0x13
+#define SH2_RAW_ACCELEROMETER 0x14
+#define SH2_RAW_GYROSCOPE 0x15
+#define SH2_RAW_MAGNETOMETER 0x16
+#define SH2_STEP_DETECTOR 0x18
+#define SH2_SHAKE_DETECTOR 0x19
+#define SH2_FLIP_DETECTOR 0x1a
+#define SH2_PICKUP_DETECTOR 0x1b
+#define SH2_STABILITY_DETECTOR 0x1c
+#define SH2_PERSONAL_ACTIVITY_CLASSIFIER 0x1e
+#define SH2_SLEEP_DETECTOR 0x1f
+#define SH2_TILT_DETECTOR 0x20
+#define SH2_POCKET_DETECTOR 0x21
+#define SH2_CIRCLE_DETECTOR 0x22
+#define SH2_HEART_RATE_MONITOR 0x23
+#define SH2_ARVR_STABILIZED_RV 0x28
+#define SH2_ARVR_STABILIZED_GRV 0x29
+#define SH2_GYRO_INTEGRATED_RV 0x2a
+#define SH2_IZRO_MOTION_REQUEST 0x2b
+#define SH2_MAX_SENSOR_ID 0x2e
+
+#define SH2_CAL_ACCEL 0x01
+#define SH2_CAL_GYRO 0x02
+#define SH2_CAL_MAG 0x04
+#define SH2_CAL_PLANAR 0x08
+
+#define SH2_TARE_X 1
+#define SH2_TARE_Y 2
+#define SH2_TARE_Z 4
+
+#define STABILITY_CLASSIFIER_UNKNOWN 0
+#define STABILITY_CLASSIFIER_ON_TABLE 1
+#define STABILITY_CLASSIFIER_STATIONARY 2
+#define STABILITY_CLASSIFIER_STABLE 3
+#define STABILITY_CLASSIFIER_MOTION 4
+
+#define USER_RECORD 0x74b4
+#define SYSTEM_ORIENTATION 0x2d3e
+
+#define SH2_MAX_SENSOR_EVENT_LEN 60
+
+typedef uint8_t sh2_SensorId_t;
+
+typedef enum
+{
+    SH2_TARE_BASIS_ROTATION_VECTOR = 0,
+    SH2_TARE_BASIS_GAMING_ROTATION_VECTOR = 1,
+    SH2_TARE_BASIS_GEOMAGNETIC_ROTATION_VECTOR = 2
+} sh2_TareBasis_t;
+
+typedef struct { double x, y, z, w; } sh2_Quaternion_t;
+typedef struct { float x, y, z; } sh2_Accelerometer_t;
+typedef struct { float x, y, z; } sh2_Gyroscope_t;
+typedef struct { float x, y, z; } sh2_MagneticField_t;
+typedef struct { int16_t x, y, z; uint32_t timestamp; } sh2_RawAccelerometer_t;
+typedef struct { int16_t x, y, z, temperature; uint32_t timestamp; } sh2_RawGyroscope_t;
+typedef struct { int16_t x, y, z; uint32_t timestamp; } sh2_RawMagnetometer_t;
+typedef struct { float i, j, k, real, accuracy; } sh2_RotationVectorWAcc_t;
+typedef struct { float i, j, k, real; } sh2_RotationVector_t;
+typedef struct { uint8_t classification; } sh2_StabilityClassifier_t;
+
+typedef struct
+{
+    uint8_t sensorId;
+    uint8_t sequence;
+    uint8_t status;
+    uint64_t timestamp;
+    uint32_t delay;
+
+    union
+    {
+        sh2_RawAccelerometer_t rawAccelerometer;
+        sh2_Accelerometer_t accelerometer;
+        sh2_Accelerometer_t linearAcceleration;
+        sh2_Accelerometer_t gravity;
+        sh2_RawGyroscope_t rawGyroscope;
+        sh2_Gyroscope_t gyroscope;
+        sh2_RawMagnetometer_t rawMagnetometer;
+        sh2_MagneticField_t magneticField;
+        sh2_RotationVectorWAcc_t rotationVector;
+        sh2_RotationVector_t gameRotationVector;
+        sh2_RotationVectorWAcc_t geoMagRotationVector;
+        sh2_RotationVectorWAcc_t arvrStabilizedRV;
+        sh2_RotationVector_t arvrStabilizedGRV;
+        sh2_StabilityClassifier_t stabilityClassifier;
+    } un;
+} sh2_SensorValue_t;
+
+typedef struct
+{
+    uint64_t timestamp_uS;
+    int64_t delay_uS;
+    uint8_t len;
+    uint8_t reportId;
+    uint8_t report[SH2_MAX_SENSOR_EVENT_LEN];
+} sh2_SensorEvent_t;
+
+typedef void (sh2_SensorCallback_t) (void* cookie, sh2_SensorEvent_t* event);
+
+// sh-2 api subset used by the firmware
+int sh2_setSensorCallback (sh2_SensorCallback_t* callback, void* cookie);
+void sh2_service();
+int sh2_decodeSensorEvent (sh2_SensorValue_t* value, const sh2_SensorEvent_t* event);
+int sh2_reinitialize();
+int sh2_devReset();
+int sh2_devOn();
+int sh2_devSleep();
+int sh2_setTareNow (uint8_t axes, sh2_TareBasis_t basis);
+int sh2_clearTare();
+int sh2_persistTare();
+int sh2_setReorientation (sh2_Quaternion_t* orientation);
+int sh2_saveDcdNow();
+int sh2_clearDcdAndReset();
+int sh2_setCalConfig (uint8_t sensors);
+int sh2_getCalConfig (uint8_t* sensors);
+int sh2_getFrs (uint16_t recordType, uint32_t* data, uint16_t* words);
+int sh2_setFrs (uint16_t recordType, uint32_t* data, uint16_t words);
+
+
+/* The simulated sensor asserts the interrupt pin (config::BNO08x::intPin)
+   whenever an enabled report is due on the virtual clock and delivers
+   one report per sh2_service() call. Motion and stalls are scripted on
+   the command line, see imag_sim.h.
+*/
+class Adafruit_BNO08x
+{
+public:
+    Adafruit_BNO08x (int8_t resetPin = -1) { (void) resetPin; }
+    virtual ~Adafruit_BNO08x() = default;
+
+    bool begin_I2C (uint8_t addr = 0x4a, TwoWire* wire = &Wire, int32_t sensorId = 0);
+    bool begin_UART (Uart* serial, int32_t sensorId = 0);
+    bool begin_SPI (uint8_t csPin, uint8_t intPin, SPIClass* spi = &SPI, int32_t sensorId = 0);
+
+    void hardwareReset();
+    bool wasReset();
+
+    bool enableReport (sh2_SensorId_t sensor, uint32_t interval_us = 10000);
+    bool getSensorEvent (sh2_SensorValue_t* value);
+};
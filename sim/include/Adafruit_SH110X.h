@@ -0,0 +1,72 @@
+/* Adafruit_SH110X.h
+ * 
+ * imagination sensor firmware
+ * host simulation: SH1107 stand-in drawing into a framebuffer
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Wire.h>
+
+#include <vector>
+
+#define SH110X_BLACK 0
+#define SH110X_WHITE 1
+#define SH110X_INVERSE 2
+
+#define SH110X_DISPLAYOFF 0xAE
+#define SH110X_DISPLAYON 0xAF
+
+/* Draws in rotated coordinates into a 1 bit framebuffer, which is
+   written as pbm image to the file given by --display on every
+   display() call. Text is drawn as filled placeholder cells of the
+   6x8 font grid, enough to check layout.
+*/
+class Adafruit_SH1107 : public Print
+{
+public:
+    Adafruit_SH1107 (uint16_t w, uint16_t h, TwoWire* twi = &Wire, int8_t rst = -1);
+
+    bool begin (uint8_t addr = 0x3c, bool reset = true);
+
+    void oled_command (uint8_t c);
+    void display();
+    void clearDisplay() { std::fill (buffer.begin(), buffer.end(), 0); }
+
+    void setRotation (uint8_t r) { rotation = r & 3; }
+    int16_t width() const { return rotation & 1 ? rawHeight : rawWidth; }
+    int16_t height() const { return rotation & 1 ? rawWidth : rawHeight; }
+
+    void cp437 (bool) {}
+    void setTextSize (uint8_t s) { textSize = std::max<uint8_t> (s, 1); }
+    void setTextColor (uint16_t c) { textColor = c; }
+    void setCursor (int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+    int16_t getCursorX() const { return cursorX; }
+    int16_t getCursorY() const { return cursorY; }
+
+    void drawPixel (int16_t x, int16_t y, uint16_t color);
+    void drawFastVLine (int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect (x, y, 1, h, color); }
+    void drawFastHLine (int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect (x, y, w, 1, color); }
+    void drawLine (int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void drawRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+
+    size_t write (uint8_t c) override;
+    using Print::write;
+
+    uint8_t* getBuffer() { return buffer.data(); }
+    bool isOn() const { return on; }
+
+private:
+    int16_t rawWidth, rawHeight;
+    std::vector<uint8_t> buffer; // one byte per pixel
+
+    uint8_t rotation = 0;
+    uint8_t textSize = 1;
+    uint16_t textColor = SH110X_WHITE;
+    int16_t cursorX = 0, cursorY = 0;
+    bool on = true;
+};
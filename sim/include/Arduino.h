@@ -0,0 +1,228 @@
+/* Arduino.h
+ * 
+ * imagination sensor firmware
+ * host simulation: arduino core stand-in
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// feather m0 pins as used by the firmware
+#define LED_BUILTIN 13
+#define A0 14
+#define A7 9
+
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*> (string_literal))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline long map (long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// virtual clock, see imag_sim.h
+uint32_t millis();
+uint32_t micros();
+void delay (uint32_t ms);
+void delayMicroseconds (uint32_t us);
+
+// scripted pins
+void pinMode (uint8_t pin, uint8_t mode);
+int digitalRead (uint8_t pin);
+void digitalWrite (uint8_t pin, int value);
+int analogRead (uint8_t pin);
+void analogReadResolution (int bits);
+
+void attachInterrupt (int interrupt, void (*isr)(), int mode);
+void detachInterrupt (int interrupt);
+inline int digitalPinToInterrupt (int pin) { return pin; }
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// cpu idle: advances the virtual clock to the next event
+namespace imag::sim { void waitForInterrupt(); }
+#define __WFI() imag::sim::waitForInterrupt()
+#define __DSB() do {} while (0)
+#define __disable_irq() do {} while (0)
+#define __enable_irq() do {} while (0)
+
+class __FlashStringHelper;
+
+
+class String
+{
+public:
+    String (const char* str = "") : s (str ? str : "") {}
+    String (const std::string& str) : s (str) {}
+    explicit String (int value) : s (std::to_string (value)) {}
+    explicit String (unsigned value) : s (std::to_string (value)) {}
+    explicit String (long value) : s (std::to_string (value)) {}
+    explicit String (unsigned long value) : s (std::to_string (value)) {}
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned length() const { return unsigned (s.length()); }
+
+    String& operator+= (const String& other) { s += other.s; return *this; }
+
+    friend String operator+ (const String& a, const String& b) { return a.s + b.s; }
+    friend String operator+ (const String& a, const char* b) { return a.s + b; }
+    friend String operator+ (const String& a, int b) { return a.s + std::to_string (b); }
+    friend String operator+ (const String& a, unsigned b) { return a.s + std::to_string (b); }
+    friend String operator+ (const String& a, long b) { return a.s + std::to_string (b); }
+
+    bool operator== (const String& other) const { return s == other.s; }
+
+private:
+    std::string s;
+};
+
+
+class Print;
+
+class Printable
+{
+public:
+    virtual ~Printable() = default;
+    virtual size_t printTo (Print& p) const = 0;
+};
+
+
+class Print
+{
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write (uint8_t c) = 0;
+    virtual size_t write (const uint8_t* buffer, size_t size)
+    {
+        size_t n = 0;
+
+        while (size--)
+            n += write (*buffer++);
+
+        return n;
+    }
+    size_t write (const char* str) { return str ? write (reinterpret_cast<const uint8_t*> (str), strlen (str)) : 0; }
+    size_t write (const char* buffer, size_t size) { return write (reinterpret_cast<const uint8_t*> (buffer), size); }
+
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print (const __FlashStringHelper* str) { return write (reinterpret_cast<const char*> (str)); }
+    size_t print (const String& str) { return write (str.c_str()); }
+    size_t print (const char* str) { return write (str); }
+    size_t print (char c) { return write (uint8_t (c)); }
+    size_t print (unsigned char value, int base = DEC) { return print ((unsigned long) value, base); }
+    size_t print (int value, int base = DEC) { return print (long (value), base); }
+    size_t print (unsigned value, int base = DEC) { return print ((unsigned long) value, base); }
+    size_t print (long value, int base = DEC)
+    {
+        if (base == DEC && value < 0)
+            return print ('-') + print ((unsigned long) (-value), base);
+
+        return print ((unsigned long) value, base);
+    }
+    size_t print (unsigned long value, int base = DEC)
+    {
+        char buffer[8 * sizeof (long) + 1];
+        auto* str = &buffer[sizeof (buffer) - 1];
+        *str = 0;
+
+        if (base < 2)
+            base = 10;
+
+        do
+        {
+            const auto digit = char (value % base);
+            value /= base;
+            *--str = digit < 10 ? digit + '0' : digit + 'A' - 10;
+        }
+        while (value);
+
+        return write (str);
+    }
+    size_t print (double value, int digits = 2)
+    {
+        char buffer[64];
+        snprintf (buffer, sizeof (buffer), "%.*f", digits, value);
+        return write (buffer);
+    }
+    size_t print (const Printable& value) { return value.printTo (*this); }
+
+    size_t println() { return write ("\r\n"); }
+    template <typename T>
+    size_t println (const T& value) { return print (value) + println(); }
+    template <typename T>
+    size_t println (const T& value, int format) { return print (value, format) + println(); }
+};
+
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+
+// usb cdc serial, writes to stdout or the file given by --serial
+class Serial_ : public Stream
+{
+public:
+    void begin (unsigned long) {}
+    void end() {}
+    operator bool() { return true; }
+    int dtr() { return 1; }
+
+    size_t write (uint8_t c) override { return write (&c, 1); }
+    size_t write (const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int availableForWrite() override { return 4096; }
+    void flush() override;
+};
+
+extern Serial_ Serial;
+
+
+class Uart : public Stream
+{
+public:
+    void begin (unsigned long) {}
+    size_t write (uint8_t) override { return 1; }
+    using Print::write;
+};
+
+extern Uart Serial1;
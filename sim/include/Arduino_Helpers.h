@@ -0,0 +1,11 @@
+/* Arduino_Helpers.h
+ * 
+ * imagination sensor firmware
+ * host simulation: Arduino-Helpers stand-in, see AH/Math/Quaternion.hpp
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
@@ -0,0 +1,69 @@
+/* EasyButton.h
+ * 
+ * imagination sensor firmware
+ * host simulation: EasyButton stand-in reading the scripted button pins
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class EasyButton
+{
+public:
+    using callback_t = void (*)();
+
+    EasyButton (uint8_t pin, uint32_t debounce = 35, bool pullup = true, bool invert = true)
+        : pin (pin), invert (invert), pullup (pullup)
+    {
+        (void) debounce;
+    }
+
+    void begin() { pinMode (pin, pullup ? INPUT_PULLUP : INPUT); }
+
+    // pressed callback fires on release, pressed-for callback once while held
+    bool read()
+    {
+        const auto now = millis();
+        const auto state = (digitalRead (pin) == HIGH) != invert;
+
+        if (state && ! pressed)
+        {
+            pressStart = now;
+            heldFired = false;
+        }
+        else if (state && heldCallback && ! heldFired && now - pressStart >= heldDuration)
+        {
+            heldFired = true;
+            heldCallback();
+        }
+        else if (! state && pressed && ! heldFired && pressedCallback)
+        {
+            pressedCallback();
+        }
+
+        pressed = state;
+        return pressed;
+    }
+
+    void onPressed (callback_t callback) { pressedCallback = callback; }
+    void onPressedFor (uint32_t duration, callback_t callback) { heldDuration = duration; heldCallback = callback; }
+
+    bool isPressed() const { return pressed; }
+    bool isReleased() const { return ! pressed; }
+
+private:
+    uint8_t pin;
+    bool invert;
+    bool pullup;
+
+    bool pressed = false;
+    bool heldFired = false;
+    uint32_t pressStart = 0;
+
+    callback_t pressedCallback = nullptr;
+    callback_t heldCallback = nullptr;
+    uint32_t heldDuration = 0;
+};
@@ -0,0 +1,72 @@
+/* LiteOSCParser.h
+ * 
+ * imagination sensor firmware
+ * host simulation: LiteOSCParser stand-in, osc 1.0 messages
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <string>
+#include <vector>
+
+namespace qindesign::osc
+{
+class LiteOSCParser
+{
+public:
+    LiteOSCParser (int bufCapacity, int maxArgs);
+
+    // building
+    bool init (const char* address);
+    bool addInt (int32_t value);
+    bool addFloat (float value);
+    bool addString (const char* value);
+    bool addBlob (const uint8_t* data, int32_t size);
+    bool addTime (uint64_t value);
+
+    const uint8_t* getMessageBuf() const { return buffer.data(); }
+    int getMessageSize() const { return int (buffer.size()); }
+
+    // parsing
+    bool parse (const uint8_t* buf, int32_t size);
+
+    const char* getAddress() const { return address.c_str(); }
+    int getArgCount() const { return int (tags.size()); }
+    char getTag (int index) const { return index < getArgCount() ? tags[index] : 0; }
+
+    bool isInt (int index) const { return getTag (index) == 'i'; }
+    bool isFloat (int index) const { return getTag (index) == 'f'; }
+    bool isString (int index) const { return getTag (index) == 's'; }
+    bool isBlob (int index) const { return getTag (index) == 'b'; }
+    bool isTime (int index) const { return getTag (index) == 't'; }
+
+    int32_t getInt (int index) const;
+    float getFloat (int index) const;
+    const char* getString (int index) const;
+    int getBlobLength (int index) const;
+    const uint8_t* getBlob (int index) const;
+    uint64_t getTime (int index) const;
+
+private:
+    bool add (char tag, const uint8_t* data, size_t size);
+    void compose();
+    uint32_t readWord (size_t offset) const;
+
+    size_t capacity;
+    size_t maxArgs;
+
+    // message parts, each padded to 4 bytes
+    std::string address;
+    std::string tags;
+    std::vector<uint8_t> args;
+    std::vector<size_t> offsets; // of each argument in args
+
+    // composed message: address, type tags, arguments
+    std::vector<uint8_t> buffer;
+};
+
+} // namespace qindesign::osc
@@ -0,0 +1,41 @@
+/* MIDIUSB.h
+ * 
+ * imagination sensor firmware
+ * host simulation: MIDIUSB stand-in, records usb midi packets
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+typedef struct
+{
+    uint8_t header;
+    uint8_t byte1;
+    uint8_t byte2;
+    uint8_t byte3;
+} midiEventPacket_t;
+
+
+// packets are counted and written to the file given by --midi
+class MIDI_
+{
+public:
+    size_t write (const uint8_t* buffer, size_t size);
+    void sendMIDI (midiEventPacket_t event) { write (reinterpret_cast<const uint8_t*> (&event), sizeof (event)); }
+    void flush();
+    midiEventPacket_t read() { return { 0, 0, 0, 0 }; }
+};
+
+extern MIDI_ MidiUSB;
+
+
+class USBDevice_
+{
+public:
+    bool configured() const { return true; }
+};
+
+extern USBDevice_ USBDevice;
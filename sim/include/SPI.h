@@ -0,0 +1,19 @@
+/* SPI.h
+ * 
+ * imagination sensor firmware
+ * host simulation: spi stand-in, no devices on the bus
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class SPIClass
+{
+public:
+    void begin() {}
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,92 @@
+/* WiFi101.h
+ * 
+ * imagination sensor firmware
+ * host simulation: WiFi101 stand-in, access point with a scripted client
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED,
+    WL_AP_LISTENING,
+    WL_AP_CONNECTED,
+    WL_AP_FAILED,
+    WL_PROVISIONING,
+    WL_PROVISIONING_FAILED,
+    WL_NO_SHIELD = 255
+};
+
+
+class IPAddress : public Printable
+{
+public:
+    IPAddress() : IPAddress (0, 0, 0, 0) {}
+    IPAddress (uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes { a, b, c, d } {}
+    IPAddress (uint32_t address) { memcpy (bytes, &address, sizeof (bytes)); }
+
+    operator uint32_t() const { uint32_t address; memcpy (&address, bytes, sizeof (address)); return address; }
+    uint8_t operator[] (int index) const { return bytes[index]; }
+
+    size_t printTo (Print& p) const override
+    {
+        size_t n = 0;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            n += p.print (bytes[i], DEC);
+
+            if (i < 3)
+                n += p.print ('.');
+        }
+
+        return n;
+    }
+
+private:
+    uint8_t bytes[4];
+};
+
+
+// access point, a client connects --connect ms after beginAP()
+class WiFiClass
+{
+public:
+    void setPins (int8_t, int8_t, int8_t, int8_t = -1) {}
+
+    uint8_t status();
+
+    void config (IPAddress address) { localAddress = address; }
+    uint8_t beginAP (const char* ssid, const char* key, uint8_t channel);
+    void end() { apStart = 0; apStatus = WL_IDLE_STATUS; }
+
+    void lowPowerMode() { powerMode = 1; }
+    void maxLowPowerMode() { powerMode = 2; }
+    void noLowPowerMode() { powerMode = 0; }
+    int getPowerMode() const { return powerMode; }
+
+    const char* SSID() const { return ssid.c_str(); }
+    uint32_t localIP() const { return localAddress; }
+    int32_t RSSI() const { return -40; }
+    uint8_t* APClientMacAddress (uint8_t* mac) { for (int i = 0; i < 6; ++i) mac[i] = uint8_t (0x10 + i); return mac; }
+    unsigned long getTime() const { return 0; }
+
+private:
+    std::string ssid;
+    IPAddress localAddress;
+    uint64_t apStart = 0;
+    uint8_t apStatus = WL_IDLE_STATUS;
+    int powerMode = 1;
+};
+
+extern WiFiClass WiFi;
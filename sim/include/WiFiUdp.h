@@ -0,0 +1,48 @@
+/* WiFiUdp.h
+ * 
+ * imagination sensor firmware
+ * host simulation: WiFiUDP stand-in backed by a host udp socket
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <WiFi101.h>
+
+#include <vector>
+
+/* Packets are sent to the target given by --target (default localhost
+   at the port the firmware sends to) and received on the port given by
+   --listen (default firmware port + 1), unless --no-udp is given.
+*/
+class WiFiUDP : public Stream
+{
+public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t begin (uint16_t port);
+    void stop();
+
+    int beginPacket (IPAddress ip, uint16_t port);
+    int endPacket();
+    size_t write (uint8_t c) override { return write (&c, 1); }
+    size_t write (const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    int parsePacket();
+    int available() override { return int (rx.size() - rxPos); }
+    int read() override { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+    int read (uint8_t* buffer, size_t size);
+    int read (char* buffer, size_t size) { return read (reinterpret_cast<uint8_t*> (buffer), size); }
+    IPAddress remoteIP() const { return remoteAddress; }
+    uint16_t remotePort() const { return remotePortNumber; }
+
+private:
+    int fd = -1;
+    uint16_t targetPort = 0;
+    std::vector<uint8_t> tx, rx;
+    size_t rxPos = 0;
+    IPAddress remoteAddress;
+    uint16_t remotePortNumber = 0;
+};
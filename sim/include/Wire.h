@@ -0,0 +1,20 @@
+/* Wire.h
+ * 
+ * imagination sensor firmware
+ * host simulation: i2c stand-in, no devices on the bus
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+    void begin() {}
+    void setClock (uint32_t) {}
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,75 @@
+/* imag_test.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: runner, sim/build/imag_test [name ...]
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include <cstring>
+
+namespace imag::test
+{
+namespace
+{
+const char* currentTest = "";
+unsigned failures = 0;
+} // namespace
+
+
+std::vector<Case>& getCases()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+
+void fail (const char* file, int line, const char* expression, const char* details)
+{
+    ++failures;
+    fprintf (stderr, "%s:%d: %s: check failed: %s%s%s\n", file, line, currentTest, expression,
+             details ? ", " : "", details ? details : "");
+}
+
+
+unsigned getFailures()
+{
+    return failures;
+}
+
+} // namespace imag::test
+
+
+int main (int argc, char** argv)
+{
+    using namespace imag::test;
+
+    auto run = 0u, failed = 0u;
+
+    for (const auto& testCase : getCases())
+    {
+        // optional selection by name
+        auto selected = argc < 2;
+
+        for (int i = 1; i < argc; ++i)
+            selected |= strcmp (argv[i], testCase.name) == 0;
+
+        if (! selected)
+            continue;
+
+        const auto before = getFailures();
+        currentTest = testCase.name;
+        testCase.run();
+        ++run;
+
+        const auto ok = getFailures() == before;
+        failed += ! ok;
+        fprintf (stderr, "%-32s %s\n", testCase.name, ok ? "ok" : "FAILED");
+    }
+
+    fprintf (stderr, "%u tests, %u failed\n", run, failed);
+
+    return run == 0 || failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,61 @@
+/* imag_test.h
+ * 
+ * imagination sensor firmware
+ * host tests: registration and checks
+ * 
+ * 2024 rumori
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+namespace imag::test
+{
+/* Tests register themselves with IMAG_TEST(name) and report failures
+   with the CHECK macros, a failed check does not stop its test. Checks
+   compare firmware modules against exact or float references on the
+   host, they run with the stand-ins of sim/include.
+*/
+
+struct Case
+{
+    const char* name;
+    void (*run)();
+};
+
+std::vector<Case>& getCases();
+
+struct Register
+{
+    Register (const char* name, void (*run)()) { getCases().push_back ({ name, run }); }
+};
+
+// record a failed check of the running test
+void fail (const char* file, int line, const char* expression, const char* details = nullptr);
+
+// failed checks so far
+unsigned getFailures();
+
+} // namespace imag::test
+
+#define IMAG_TEST(name) \
+    static void name(); \
+    static const imag::test::Register name##Register { #name, name }; \
+    static void name()
+
+#define CHECK(expression) \
+    ((expression) ? (void) 0 : imag::test::fail (__FILE__, __LINE__, #expression))
+
+// |a - b| <= tolerance, values printed on failure
+#define CHECK_NEAR(a, b, tolerance) \
+    do { \
+        const double checkA = double (a), checkB = double (b); \
+        if (! (checkA - checkB <= double (tolerance) && checkB - checkA <= double (tolerance))) \
+        { \
+            char checkDetails[96]; \
+            snprintf (checkDetails, sizeof (checkDetails), "%.9g vs %.9g, tolerance %.3g", checkA, checkB, double (tolerance)); \
+            imag::test::fail (__FILE__, __LINE__, #a " ~ " #b, checkDetails); \
+        } \
+    } while (false)
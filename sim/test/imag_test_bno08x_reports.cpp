@@ -0,0 +1,104 @@
+/* imag_test_bno08x_reports.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: sh-2 commands of report changes, against the former full sweep
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_imu.h"
+#include "imag_sim.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using namespace imag;
+using imu::BNO08x;
+using imu::DataType;
+
+uint64_t commands() { return sim::getCounters().sensorCommands; }
+
+/* Report commands of the former update: every report id up to
+   SH2_MAX_SENSOR_ID disabled, then the requested ones enabled, replayed
+   on the stand-in sensor.
+*/
+uint64_t legacySweep (const std::vector<std::pair<uint8_t, uint32_t>>& reports)
+{
+    Adafruit_BNO08x sensor;
+    const auto start = commands();
+
+    for (uint8_t type = 0; type <= SH2_MAX_SENSOR_ID; ++type)
+        sensor.enableReport (type, 0);
+
+    for (const auto& [type, interval] : reports)
+        sensor.enableReport (type, interval);
+
+    return commands() - start;
+}
+
+} // namespace
+
+
+/* The reported transactions are the commands the sensor receives, for
+   mode switches and reinits alike. A reinit sends the calibration
+   config, the changed reports and the reorientation. The former sweep
+   sent 47 disables plus the enables each time.
+*/
+IMAG_TEST(reportUpdatesSendOnlyChanges)
+{
+    auto imu = imu::createImu<BNO08x>();
+    CHECK(imu.setDataTypesToQuery ({ DataType::rotationArvr }));
+    CHECK(imu.setDataRate (DataType::rotationArvr, 100));
+
+    auto start = commands();
+    CHECK(imu::initImu (imu));
+
+    // soft reset, tare record read, then the reinit
+    CHECK(imu.getReinitTiming().transactions == 3);
+    CHECK(commands() - start >= imu.getReinitTiming().transactions);
+
+    // calibration mode: arvr off, game rotation and mag on
+    start = commands();
+    CHECK(imu.beginCalibration());
+    CHECK(imu.getReportUpdateTiming().transactions == 3);
+    CHECK(commands() - start == 1u + imu.getReportUpdateTiming().transactions);
+    CHECK(1u + legacySweep ({ { SH2_GAME_ROTATION_VECTOR, 10000 }, { SH2_MAGNETIC_FIELD_CALIBRATED, 20000 } }) == 50);
+
+    // back: calibration config, game rotation and mag off, arvr on, reorientation
+    start = commands();
+    CHECK(imu.endCalibration());
+    CHECK(imu.getReinitTiming().transactions == 5);
+    CHECK(commands() - start == imu.getReinitTiming().transactions);
+    CHECK(legacySweep ({ { SH2_ARVR_STABILIZED_RV, 10000 } }) + 2 == 50);
+
+    // rate change of a queried report
+    start = commands();
+    CHECK(imu.setDataRate (DataType::rotationArvr, 200));
+    CHECK(imu.getReportUpdateTiming().transactions == 1);
+    CHECK(commands() - start == 1);
+
+    // nothing changed, nothing sent
+    start = commands();
+    CHECK(imu.setDataTypesToQuery ({ DataType::rotationArvr }));
+    CHECK(imu.getReportUpdateTiming().transactions == 0);
+    CHECK(commands() == start);
+
+    // one more report
+    start = commands();
+    CHECK(imu.setDataTypesToQuery ({ DataType::rotationArvr, DataType::gyro }));
+    CHECK(imu.getReportUpdateTiming().transactions == 1);
+    CHECK(commands() - start == 1);
+    CHECK(legacySweep ({ { SH2_ARVR_STABILIZED_RV, 5000 }, { SH2_GYROSCOPE_CALIBRATED, 10000 } }) == 49);
+
+    // stall recovery without reset: sensor state unknown, requested reports sent again
+    start = commands();
+    CHECK(imu.recover (false));
+    CHECK(imu.getReinitTiming().transactions == 4);
+    CHECK(commands() - start == imu.getReinitTiming().transactions);
+    CHECK(legacySweep ({ { SH2_ARVR_STABILIZED_RV, 5000 }, { SH2_GYROSCOPE_CALIBRATED, 10000 } }) + 2 == 51);
+}
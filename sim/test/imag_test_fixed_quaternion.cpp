@@ -0,0 +1,135 @@
+/* imag_test_fixed_quaternion.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: integer midi and float conversion of fixed point components
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_fixed_quaternion.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+using imag::FixedQuaternion;
+
+// previous float path: sh-2 Q14 decode, then (c + 1) * 8192 truncated
+uint16_t floatMidi14 (int16_t raw)
+{
+    const auto c = raw * (1.0f / (1 << 14));
+    return uint16_t ((c + 1.0f) * 8192.0f);
+}
+
+uint32_t bitsOf (float f)
+{
+    uint32_t bits;
+    memcpy (&bits, &f, sizeof (bits));
+    return bits;
+}
+
+// components as the sensor path delivers them: Q14 reports, Q28 fusion
+int32_t fromQ14 (int32_t raw) { return raw * (int32_t (1) << 16); }
+int32_t fromQ28 (int32_t raw) { return raw * 4; }
+
+} // namespace
+
+
+/* All sh-2 Q14 values: identical to the float path on -1..1, except at
+   +1.0, where the float path gave 16384, which wrapped to 0 in the two
+   7-bit bytes, and the integer path clamps to 16383. Outside -1..1 the
+   result is clamped to the 14-bit range.
+*/
+IMAG_TEST(midi14MatchesFloatPathOnQ14)
+{
+    auto mismatches = 0;
+
+    for (int32_t raw = -32768; raw <= 32767; ++raw)
+    {
+        const auto value = FixedQuaternion::toMidi14 (fromQ14 (raw));
+
+        if (raw < -16384)
+            mismatches += value != 0;
+        else if (raw < 16384)
+            mismatches += value != floatMidi14 (int16_t (raw));
+        else
+            mismatches += value != 16383;
+    }
+
+    CHECK(mismatches == 0);
+    CHECK(floatMidi14 (16384) == 16384);
+    CHECK(FixedQuaternion::toMidi14 (FixedQuaternion::one) == 16383);
+}
+
+
+// Q28 fusion output over the full range: floor of the exact value, within one step of the float path
+IMAG_TEST(midi14WithinOneStepOnQ28)
+{
+    auto inexact = 0, maxSteps = 0;
+
+    for (int64_t raw = -(int64_t (1) << 29); raw < (int64_t (1) << 29); raw += 37)
+    {
+        const auto c = fromQ28 (int32_t (raw));
+        const auto value = FixedQuaternion::toMidi14 (c);
+
+        const auto exact = std::clamp (std::floor ((double (c) / FixedQuaternion::one + 1.0) * 8192.0), 0.0, 16383.0);
+        const auto viaFloat = std::clamp ((float (c) / FixedQuaternion::one + 1.0f) * 8192.0f, 0.0f, 16383.0f);
+
+        inexact += value != exact;
+        maxSteps = std::max (maxSteps, std::abs (int (value) - int (viaFloat)));
+    }
+
+    CHECK(inexact == 0);
+    CHECK(maxSteps <= 1);
+}
+
+
+// all sh-2 Q14 values convert exactly, as any float has 24 significant bits
+IMAG_TEST(floatBitsExactOnQ14)
+{
+    auto mismatches = 0;
+
+    for (int32_t raw = -32768; raw <= 32767; ++raw)
+        mismatches += FixedQuaternion::toFloatBits (fromQ14 (raw)) != bitsOf (raw * (1.0f / (1 << 14)));
+
+    CHECK(mismatches == 0);
+}
+
+
+/* Q30 values with more than 24 significant bits are rounded half up,
+   so they match the compiler's round to nearest even except on ties,
+   where they may be one unit in the last place above.
+*/
+IMAG_TEST(floatBitsRoundedOnQ30)
+{
+    auto mismatches = 0, ties = 0;
+
+    for (int64_t c = INT32_MIN; c <= INT32_MAX; c += 4099)
+    {
+        const auto bits = FixedQuaternion::toFloatBits (int32_t (c));
+        const auto expected = bitsOf (float (double (c) / FixedQuaternion::one));
+
+        if (bits == expected)
+            continue;
+
+        // a tie: exactly halfway between two floats, result the one away from zero
+        const auto magnitude = uint32_t (c < 0 ? -c : c);
+        const auto shift = std::max (0, 31 - __builtin_clz (magnitude) - 23);
+        const auto tie = shift > 0 && (magnitude & ((uint32_t (1) << shift) - 1)) == uint32_t (1) << (shift - 1);
+
+        if (tie && bits == expected + 1)
+            ++ties;
+        else
+            ++mismatches;
+    }
+
+    // the extremes and the smallest magnitudes
+    for (const auto c : { INT32_MIN, INT32_MIN + 1, INT32_MAX, -FixedQuaternion::one, FixedQuaternion::one, -1, 1, 0 })
+        mismatches += FixedQuaternion::toFloatBits (c) != bitsOf (float (double (c) / FixedQuaternion::one));
+
+    CHECK(mismatches == 0);
+    CHECK(ties > 0);
+}
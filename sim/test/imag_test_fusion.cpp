@@ -0,0 +1,365 @@
+/* imag_test_fusion.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: fixed-point mahony fusion against a float reference and the true motion
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_imu_fusion.h"
+#include "imag_imu_replay.h"
+#include "imag_imu_base.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+using imag::imu::MahonyFusion;
+using imag::imu::TraceRecord;
+using imag::imu::DataType;
+using Quat = std::array<double, 4>; // w, x, y, z
+
+// sh-2 report resolutions as read by BNO08x::updateFusion()
+constexpr int gyroFracBits = 9;
+constexpr int accelFracBits = 8;
+constexpr int magFracBits = 4;
+
+Quat multiply (const Quat& a, const Quat& b)
+{
+    return { a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+             a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+             a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+             a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0] };
+}
+
+Quat conjugate (const Quat& q)
+{
+    return { q[0], -q[1], -q[2], -q[3] };
+}
+
+// rotate world vector into the sensor frame of rotation q (sensor to world)
+std::array<double, 3> toSensor (const Quat& q, const std::array<double, 3>& v)
+{
+    const auto r = multiply (multiply (conjugate (q), { 0.0, v[0], v[1], v[2] }), q);
+    return { r[1], r[2], r[3] };
+}
+
+// angle between two rotations [deg]
+double angleBetween (const Quat& a, const Quat& b)
+{
+    const auto dot = std::fabs (a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    return 2.0 * std::acos (std::min (1.0, dot)) * 180.0 / M_PI;
+}
+
+// head motion in ENU: yaw sweep around north with pitch and some roll,
+// starting close to the fusion's initial pose (sensor x to north)
+Quat truth (double t)
+{
+    const auto yaw = 0.5 * M_PI + 1.2 * std::sin (2.0 * M_PI * 0.2 * t);
+    const auto pitch = 0.3 * std::sin (2.0 * M_PI * 0.13 * t);
+    const auto roll = 0.15 * std::sin (2.0 * M_PI * 0.31 * t + 1.0);
+
+    const Quat qYaw { std::cos (0.5 * yaw), 0.0, 0.0, std::sin (0.5 * yaw) };
+    const Quat qPitch { std::cos (0.5 * pitch), std::sin (0.5 * pitch), 0.0, 0.0 };
+    const Quat qRoll { std::cos (0.5 * roll), 0.0, std::sin (0.5 * roll), 0.0 };
+
+    return multiply (multiply (qYaw, qPitch), qRoll);
+}
+
+/* Trace of the motion in the replay format, as the sensor reports it at
+   100 Hz: calibrated gyro with a small bias, accelerometer (gravity only)
+   and magnetic field with an inclination, each with deterministic noise.
+   The true rotation is recorded as rotation report.
+*/
+std::vector<TraceRecord> makeTrace (double seconds)
+{
+    static constexpr auto rate = 100.0;
+    static constexpr std::array<double, 3> gravity { 0.0, 0.0, 9.81 };  // [m/s^2], reaction force
+    static constexpr std::array<double, 3> field { 0.0, 20.0, -40.0 };  // [uT], north and down
+    static constexpr std::array<double, 3> gyroBias { 0.004, -0.003, 0.002 }; // [rad/s]
+
+    std::vector<TraceRecord> trace;
+    uint32_t noise = 12345;
+
+    // uniform in -amplitude..amplitude
+    auto next = [&noise] (double amplitude)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        return amplitude * (double (noise >> 8) / double (1 << 23) - 1.0);
+    };
+
+    for (size_t n = 0; n < size_t (seconds * rate); ++n)
+    {
+        const auto t = n / rate;
+        const auto time = uint32_t (std::lround (t * 1e6));
+        const auto q = truth (t);
+
+        // body rate from the rotation over a small step
+        static constexpr auto h = 1e-5;
+        const auto step = multiply (conjugate (q), truth (t + h));
+        const auto scale = 2.0 / h * (step[0] < 0.0 ? -1.0 : 1.0);
+
+        const auto a = toSensor (q, gravity);
+        const auto m = toSensor (q, field);
+
+        trace.push_back ({ time, uint8_t (DataType::accel), { float (a[0] + next (0.05)), float (a[1] + next (0.05)), float (a[2] + next (0.05)), 0.0f } });
+        trace.push_back ({ time, uint8_t (DataType::mag), { float (m[0] + next (0.5)), float (m[1] + next (0.5)), float (m[2] + next (0.5)), 0.0f } });
+        trace.push_back ({ time, uint8_t (DataType::gyro), { float (scale * step[1] + gyroBias[0] + next (0.002)),
+                                                              float (scale * step[2] + gyroBias[1] + next (0.002)),
+                                                              float (scale * step[3] + gyroBias[2] + next (0.002)), 0.0f } });
+        trace.push_back ({ time, uint8_t (DataType::rotation), { float (q[0]), float (q[1]), float (q[2]), float (q[3]) } });
+    }
+
+    return trace;
+}
+
+int32_t toRaw (float value, int fracBits)
+{
+    return int32_t (std::lround (std::fmax (-32768.0, std::fmin (32767.0, value * (1 << fracBits)))));
+}
+
+// mahony in double precision, same gains, settling and frames as MahonyFusion
+class Reference
+{
+public:
+    void update (const std::array<double, 3>& gyro, std::array<double, 3> a, std::array<double, 3> m, double dt)
+    {
+        dt = std::fmin (dt, MahonyFusion::maxTimeStep * 1e-6);
+
+        const auto [q0, q1, q2, q3] = q;
+        double halfex = 0.0, halfey = 0.0, halfez = 0.0;
+
+        if (normalise (a))
+        {
+            const auto halfvx = q1 * q3 - q0 * q2;
+            const auto halfvy = q0 * q1 + q2 * q3;
+            const auto halfvz = q0 * q0 - 0.5 + q3 * q3;
+
+            halfex = a[1] * halfvz - a[2] * halfvy;
+            halfey = a[2] * halfvx - a[0] * halfvz;
+            halfez = a[0] * halfvy - a[1] * halfvx;
+
+            if (normalise (m))
+            {
+                const auto hx = 2.0 * (m[0] * (0.5 - q2 * q2 - q3 * q3) + m[1] * (q1 * q2 - q0 * q3) + m[2] * (q1 * q3 + q0 * q2));
+                const auto hy = 2.0 * (m[0] * (q1 * q2 + q0 * q3) + m[1] * (0.5 - q1 * q1 - q3 * q3) + m[2] * (q2 * q3 - q0 * q1));
+                const auto bx = std::sqrt (hx * hx + hy * hy);
+                const auto bz = 2.0 * (m[0] * (q1 * q3 - q0 * q2) + m[1] * (q2 * q3 + q0 * q1) + m[2] * (0.5 - q1 * q1 - q2 * q2));
+
+                const auto halfwx = bx * (0.5 - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2);
+                const auto halfwy = bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3);
+                const auto halfwz = bx * (q0 * q2 + q1 * q3) + bz * (0.5 - q1 * q1 - q2 * q2);
+
+                halfex += m[1] * halfwz - m[2] * halfwy;
+                halfey += m[2] * halfwx - m[0] * halfwz;
+                halfez += m[0] * halfwy - m[1] * halfwx;
+            }
+        }
+
+        // proportional gain raised by 16 while settling, as the fixed point version
+        const auto twoKp = settleRemaining > 0.0 ? 16.0 : 1.0;
+        settleRemaining -= std::fmin (settleRemaining, dt);
+
+        const std::array<double, 3> halfe { halfex, halfey, halfez };
+        std::array<double, 3> g;
+
+        for (size_t i = 0; i < 3; ++i)
+            g[i] = (gyro[i] + twoKp * halfe[i]) * 0.5 * dt;
+
+        q[0] += -q1 * g[0] - q2 * g[1] - q3 * g[2];
+        q[1] +=  q0 * g[0] + q2 * g[2] - q3 * g[1];
+        q[2] +=  q0 * g[1] - q1 * g[2] + q3 * g[0];
+        q[3] +=  q0 * g[2] + q1 * g[1] - q2 * g[0];
+
+        const auto norm = std::sqrt (q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+        for (auto& c : q)
+            c /= norm;
+    }
+
+    // ENU world frame, +90 deg around z from the fusion frame
+    Quat getEnu() const
+    {
+        return multiply ({ M_SQRT1_2, 0.0, 0.0, M_SQRT1_2 }, q);
+    }
+
+private:
+    static bool normalise (std::array<double, 3>& v)
+    {
+        const auto norm = std::sqrt (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+        if (norm == 0.0)
+            return false;
+
+        for (auto& c : v)
+            c /= norm;
+
+        return true;
+    }
+
+    Quat q { 1.0, 0.0, 0.0, 0.0 };
+    double settleRemaining = MahonyFusion::settleTime * 1e-6;
+};
+
+Quat getEnu (const MahonyFusion& fusion)
+{
+    const auto [w, x, y, z] = fusion.getFixedEnu();
+    static constexpr auto scale = 1.0 / MahonyFusion::one;
+
+    return { w * scale, x * scale, y * scale, z * scale };
+}
+
+} // namespace
+
+
+/* Replays the trace through the fusion the way BNO08x::updateFusion()
+   feeds it: raw sh-2 values, an update per gyro report with the latest
+   accel and mag. After settling, the fixed point fusion has to follow
+   the double precision reference closely and the true motion within
+   the accuracy the inputs allow.
+*/
+IMAG_TEST(fusionTracksReferenceAndTruth)
+{
+    static constexpr auto settled = 5000000u; // [us]
+
+    const auto trace = makeTrace (30.0);
+
+    MahonyFusion fusion;
+    Reference reference;
+
+    std::array<int32_t, 3> accel {}, mag {};
+    std::array<double, 3> accelRef {}, magRef {};
+    uint32_t lastGyro = 0;
+    Quat truthEnu { 1.0, 0.0, 0.0, 0.0 };
+
+    double maxToReference = 0.0, maxToTruth = 0.0, sumToTruth = 0.0;
+    size_t compared = 0;
+
+    for (const auto& record : trace)
+    {
+        const auto* v = record.values;
+
+        switch (DataType (record.type))
+        {
+        case DataType::accel:
+            accel = { toRaw (v[0], accelFracBits), toRaw (v[1], accelFracBits), toRaw (v[2], accelFracBits) };
+            accelRef = { v[0], v[1], v[2] };
+            break;
+
+        case DataType::mag:
+            mag = { toRaw (v[0], magFracBits), toRaw (v[1], magFracBits), toRaw (v[2], magFracBits) };
+            magRef = { v[0], v[1], v[2] };
+            break;
+
+        case DataType::gyro:
+        {
+            static constexpr auto gyroShift = MahonyFusion::gyroFracBits - gyroFracBits;
+            const auto dt = lastGyro > 0 ? record.time - lastGyro : 0;
+            lastGyro = record.time;
+
+            const std::array<int32_t, 3> raw { toRaw (v[0], gyroFracBits), toRaw (v[1], gyroFracBits), toRaw (v[2], gyroFracBits) };
+
+            fusion.update ({ raw[0] * (int32_t (1) << gyroShift), raw[1] * (int32_t (1) << gyroShift), raw[2] * (int32_t (1) << gyroShift) },
+                           accel, mag, dt);
+
+            // reference sees the same quantised gyro, full precision accel and mag
+            reference.update ({ std::ldexp (raw[0], -gyroFracBits), std::ldexp (raw[1], -gyroFracBits), std::ldexp (raw[2], -gyroFracBits) },
+                              accelRef, magRef, dt * 1e-6);
+            break;
+        }
+
+        case DataType::rotation:
+        {
+            truthEnu = { v[0], v[1], v[2], v[3] };
+
+            if (record.time < settled)
+                break;
+
+            const auto fixedEnu = getEnu (fusion);
+            const auto toTruth = angleBetween (fixedEnu, truthEnu);
+
+            maxToReference = std::fmax (maxToReference, angleBetween (fixedEnu, reference.getEnu()));
+            maxToTruth = std::fmax (maxToTruth, toTruth);
+            sumToTruth += toTruth;
+            ++compared;
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    CHECK(compared > 2000);
+
+    // fixed point arithmetic error [deg]
+    CHECK_NEAR(maxToReference, 0.0, 0.25);
+
+    // filter error with noisy, biased inputs [deg]
+    CHECK_NEAR(maxToTruth, 0.0, 3.0);
+    CHECK_NEAR(sumToTruth / compared, 0.0, 1.0);
+
+    // unit norm kept by the single newton step
+    const auto q = fusion.getFixed();
+    const auto norm = std::sqrt (double (q[0]) * q[0] + double (q[1]) * q[1] + double (q[2]) * q[2] + double (q[3]) * q[3]) / MahonyFusion::one;
+    CHECK_NEAR(norm, 1.0, 1e-5);
+}
+
+
+/* From a pose off the initial one, the raised gain while settling
+   removes most of the error, the regular gain the rest. The magnetic
+   correction only acts on the horizontal field (here 20 of 45 uT), so
+   heading converges with a time constant of some 20 s afterwards.
+*/
+IMAG_TEST(fusionSettlesFromIdentity)
+{
+    MahonyFusion fusion;
+
+    // at rest, 30 deg right of north and 20 deg pitch
+    const auto q = multiply (Quat { std::cos (M_PI / 6.0), 0.0, 0.0, std::sin (M_PI / 6.0) },
+                             Quat { std::cos (M_PI / 18.0), std::sin (M_PI / 18.0), 0.0, 0.0 });
+    const auto a = toSensor (q, { 0.0, 0.0, 9.81 });
+    const auto m = toSensor (q, { 0.0, 20.0, -40.0 });
+
+    const std::array<int32_t, 3> accel { toRaw (a[0], accelFracBits), toRaw (a[1], accelFracBits), toRaw (a[2], accelFracBits) };
+    const std::array<int32_t, 3> mag { toRaw (m[0], magFracBits), toRaw (m[1], magFracBits), toRaw (m[2], magFracBits) };
+
+    const auto initial = angleBetween (getEnu (fusion), q);
+    auto t = 0u;
+
+    for (; t < MahonyFusion::settleTime; t += 10000)
+        fusion.update ({ 0, 0, 0 }, accel, mag, 10000);
+
+    CHECK(angleBetween (getEnu (fusion), q) < 0.35 * initial);
+
+    for (; t < 60000000; t += 10000)
+        fusion.update ({ 0, 0, 0 }, accel, mag, 10000);
+
+    CHECK_NEAR(angleBetween (getEnu (fusion), q), 0.0, 0.5);
+}
+
+
+// missing accel and mag leave pure gyro integration, gaps are clamped
+IMAG_TEST(fusionIntegratesGyroOnly)
+{
+    MahonyFusion fusion;
+
+    // 1 rad/s around z for 1 s in 10 ms steps
+    const auto rate = MahonyFusion::toFixed (1.0, MahonyFusion::gyroFracBits);
+
+    for (int i = 0; i < 100; ++i)
+        fusion.update ({ 0, 0, rate }, { 0, 0, 0 }, { 0, 0, 0 }, 10000);
+
+    const auto q = fusion.getFixed();
+    CHECK_NEAR(2.0 * std::atan2 (double (q[3]), double (q[0])), 1.0, 1e-3);
+
+    // a 1 s gap counts as maxTimeStep
+    fusion.update ({ 0, 0, rate }, { 0, 0, 0 }, { 0, 0, 0 }, 1000000);
+
+    const auto after = fusion.getFixed();
+    CHECK_NEAR(2.0 * std::atan2 (double (after[3]), double (after[0])), 1.0 + MahonyFusion::maxTimeStep * 1e-6, 1e-3);
+}
@@ -0,0 +1,193 @@
+/* imag_test_midi_sysex.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: sysex rotation packets through tools/imag_midi_sysex.py
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_midi_usb.h"
+#include "imag_sim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+using imag::FixedQuaternion;
+using imag::midi::UsbMidi;
+
+// python decoder next to the firmware, found relative to this source
+std::string toolPath (const char* tool)
+{
+    std::string path = __FILE__;
+    path.erase (path.rfind ("sim/test/"));
+    return path + "tools/" + tool;
+}
+
+// run the decoder, output lines of "device d: w .. x .. y .. z .."
+std::vector<std::string> runTool (const std::string& arguments)
+{
+    std::vector<std::string> lines;
+    const auto command = "python3 " + toolPath ("imag_midi_sysex.py") + " " + arguments;
+
+    if (auto* pipe = popen (command.c_str(), "r"))
+    {
+        char line[256];
+
+        while (fgets (line, sizeof (line), pipe) != nullptr)
+            lines.emplace_back (line);
+
+        if (pclose (pipe) != 0)
+            imag::test::fail (__FILE__, __LINE__, command.c_str(), "exit code");
+    }
+
+    return lines;
+}
+
+// deterministic pseudo random components in -2..2, the Q30 range
+struct Random
+{
+    uint32_t state = 36;
+
+    int32_t next()
+    {
+        state = state * 1664525u + 1013904223u;
+        return int32_t (state);
+    }
+};
+
+// the component a sysex value decodes to, as the decoder computes it
+double decoded (uint32_t value)
+{
+    return value / double (1 << (UsbMidi::sysexBits - 1)) - 1.0;
+}
+
+} // namespace
+
+
+/* Rotations are packed by the firmware, written through the sim's usb
+   midi sink and decoded from its packet log by the host tool. Each
+   component decodes to its 21-bit value, which is at most one step
+   below the exact component, and clamped to -1..1 - 2^-20.
+*/
+IMAG_TEST(sysexRoundTripThroughDecoder)
+{
+    static constexpr auto step = 1.0 / (1 << (UsbMidi::sysexBits - 1));
+
+    std::vector<FixedQuaternion> rotations {
+        {}, { -FixedQuaternion::one, 0, 0, 0 },
+        { 0, FixedQuaternion::one, -FixedQuaternion::one, 1 },
+        { INT32_MAX, INT32_MIN, -FixedQuaternion::one - 1, -1 },
+        { FixedQuaternion::one / 2, -FixedQuaternion::one / 2, FixedQuaternion::one / 3, -FixedQuaternion::one / 3 }
+    };
+
+    Random random;
+
+    for (int i = 0; i < 1000; ++i)
+        rotations.push_back ({ random.next(), random.next(), random.next(), random.next() });
+
+    // sink into a temporary packet log
+    char path[] = "/tmp/imag_test_sysex_XXXXXX";
+    const auto fd = mkstemp (path);
+    CHECK(fd >= 0);
+    close (fd);
+
+    auto options = imag::sim::getOptions();
+    options.midiFile = path;
+    imag::sim::setOptions (options);
+
+    auto sizes = 0;
+
+    for (size_t i = 0; i < rotations.size(); ++i)
+    {
+        uint8_t packets[UsbMidi::sysexPacketsSize];
+        const auto length = UsbMidi::packSysex (UsbMidi::toSysexValues (rotations[i]), uint8_t (i), packets);
+
+        sizes += length != sizeof (packets);
+        MidiUSB.write (packets, length);
+    }
+
+    fflush (nullptr);
+    CHECK(sizes == 0);
+
+    const auto lines = runTool (std::string ("log ") + path);
+    unlink (path);
+
+    CHECK(lines.size() == rotations.size());
+
+    auto mismatches = 0;
+    double maxError = 0.0;
+
+    for (size_t i = 0; i < std::min (lines.size(), rotations.size()); ++i)
+    {
+        const auto& rotation = rotations[i];
+        const auto values = UsbMidi::toSysexValues (rotation);
+
+        int device = -1;
+        double w, x, y, z;
+        mismatches += sscanf (lines[i].c_str(), "device %d: w %lf x %lf y %lf z %lf", &device, &w, &x, &y, &z) != 5;
+        mismatches += device != int (i & 0x7f);
+
+        const double components[] { w, x, y, z };
+        const int32_t exact[] { rotation.w, rotation.x, rotation.y, rotation.z };
+
+        for (size_t k = 0; k < 4; ++k)
+        {
+            // printed with 6 decimals
+            maxError = std::fmax (maxError, std::fabs (components[k] - decoded (values[k])));
+
+            const auto c = std::clamp (double (exact[k]) / FixedQuaternion::one, -1.0, 1.0 - step);
+            mismatches += ! (decoded (values[k]) <= c && decoded (values[k]) > c - step);
+        }
+    }
+
+    CHECK(mismatches == 0);
+    CHECK_NEAR(maxError, 0.0, 5e-7 + 1e-12);
+}
+
+
+// the tool's encoder gives the same bytes as the firmware, clamping included
+IMAG_TEST(sysexEncoderMatchesFirmware)
+{
+    const FixedQuaternion rotations[] {
+        {}, { FixedQuaternion::one, -FixedQuaternion::one, 12345678, -987654321 },
+        { INT32_MAX, INT32_MIN, 1, -1 }
+    };
+
+    for (const auto& rotation : rotations)
+    {
+        uint8_t packets[UsbMidi::sysexPacketsSize];
+        const auto length = UsbMidi::packSysex (UsbMidi::toSysexValues (rotation), 5, packets);
+
+        // message bytes of the packets, without the code index headers
+        std::string expected;
+
+        for (size_t i = 0; i < length; i += 4)
+        {
+            for (size_t k = 1; k < 4 && expected.size() < UsbMidi::sysexLength * 3; ++k)
+            {
+                char hex[4];
+                snprintf (hex, sizeof (hex), "%02x ", packets[i + k]);
+                expected += hex;
+            }
+        }
+
+        expected.back() = '\n';
+
+        // components are exact in double precision
+        char arguments[160];
+        snprintf (arguments, sizeof (arguments), "encode --device 5 -- %.17g %.17g %.17g %.17g",
+                  double (rotation.w) / FixedQuaternion::one, double (rotation.x) / FixedQuaternion::one,
+                  double (rotation.y) / FixedQuaternion::one, double (rotation.z) / FixedQuaternion::one);
+
+        const auto lines = runTool (arguments);
+        CHECK(lines.size() == 1 && lines[0] == expected);
+    }
+}
@@ -0,0 +1,206 @@
+/* imag_test_osc_batch.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: osc rotation batching of the wifi power profiles
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_config.h"
+#include "imag_osc_address.h"
+#include "imag_osc_winc150x.h"
+#include "imag_sim.h"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+using namespace imag;
+using osc::PowerProfile;
+using LiteOSCParser = qindesign::osc::LiteOSCParser;
+
+// host side receiver of the firmware's udp packets
+struct Receiver
+{
+    int fd = -1;
+    uint16_t port = 0;
+
+    Receiver()
+    {
+        fd = socket (AF_INET, SOCK_DGRAM, 0);
+
+        sockaddr_in local {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        socklen_t length = sizeof (local);
+
+        if (fd >= 0 && bind (fd, reinterpret_cast<sockaddr*> (&local), length) == 0 &&
+            getsockname (fd, reinterpret_cast<sockaddr*> (&local), &length) == 0)
+            port = ntohs (local.sin_port);
+    }
+
+    ~Receiver() { if (fd >= 0) close (fd); }
+
+    // next packet, empty if none arrives within a second
+    std::vector<uint8_t> receive() const
+    {
+        std::vector<uint8_t> packet (1024);
+        pollfd poller { fd, POLLIN, 0 };
+
+        const auto size = poll (&poller, 1, 1000) == 1 ? recv (fd, packet.data(), packet.size(), 0) : -1;
+        packet.resize (size > 0 ? size_t (size) : 0);
+
+        return packet;
+    }
+};
+
+uint32_t readWord (const std::vector<uint8_t>& packet, size_t offset)
+{
+    return uint32_t (packet[offset]) << 24 | uint32_t (packet[offset + 1]) << 16 |
+           uint32_t (packet[offset + 2]) << 8 | packet[offset + 3];
+}
+
+// rotations of a packet, elements of a bundle in order: w component and timetag each
+std::vector<std::pair<float, uint64_t>> parseRotations (const std::vector<uint8_t>& packet, bool& bundle)
+{
+    std::vector<std::pair<float, uint64_t>> rotations;
+    LiteOSCParser message (256, 9);
+
+    auto add = [&] (const uint8_t* data, size_t size)
+    {
+        if (message.parse (data, int32_t (size)) && strcmp (message.getAddress(), osc::Address::rotation) == 0 &&
+            message.getArgCount() == 5 && message.isTime (4))
+            rotations.emplace_back (message.getFloat (3), message.getTime (4));
+    };
+
+    static constexpr char header[] = "#bundle";
+    bundle = packet.size() >= 16 && memcmp (packet.data(), header, sizeof (header)) == 0;
+
+    if (! bundle)
+    {
+        add (packet.data(), packet.size());
+        return rotations;
+    }
+
+    // immediate timetag, then size and message per element
+    if (readWord (packet, 8) != 0 || readWord (packet, 12) != 1)
+        return {};
+
+    for (size_t offset = 16; offset + 4 <= packet.size();)
+    {
+        const auto size = readWord (packet, offset);
+        offset += 4;
+
+        if (offset + size > packet.size())
+            return {};
+
+        add (packet.data() + offset, size);
+        offset += size;
+    }
+
+    return rotations;
+}
+
+} // namespace
+
+
+/* Low latency and balanced send every rotation as a message of its own.
+   Longest battery sends pairs of rotations as one bundle, so every
+   sample arrives with its own timetag and nothing is dropped. A held
+   rotation goes out when the profile changes.
+*/
+IMAG_TEST(longestBatteryBatchesEveryRotation)
+{
+    Receiver receiver;
+    CHECK(receiver.port != 0);
+
+    auto options = sim::getOptions();
+    options.udp = true;
+    options.connectDelay = 0;
+    options.targetHost = "127.0.0.1";
+    options.targetPort = receiver.port;
+    sim::setOptions (options);
+
+    osc::WINC150x net { config::Net::localIP, config::Net::localPort };
+    net.setTarget (config::Net::remoteIP, config::Net::remotePort);
+    CHECK(net.init ("test", config::WiFi::key, config::WiFi::channel));
+
+    for (int i = 0; i < 5000 && ! net.isReadyToSend(); ++i)
+    {
+        sim::advance (1000);
+        net.updateConnectionState();
+    }
+
+    CHECK(net.isReadyToSend());
+
+    // sample n: w component n / 16, timetag 1000 + n
+    auto send = [&net] (int n)
+    {
+        const FixedQuaternion rotation { FixedQuaternion::one / 16 * n, 0, 0, 0 };
+        return net.sendQuaternion (osc::Address::rotation, rotation, 1000 + n);
+    };
+
+    std::vector<std::pair<float, uint64_t>> received;
+    std::vector<size_t> bundleSizes;
+
+    auto receive = [&]
+    {
+        auto bundle = false;
+        const auto rotations = parseRotations (receiver.receive(), bundle);
+
+        received.insert (received.end(), rotations.begin(), rotations.end());
+        bundleSizes.push_back (bundle ? rotations.size() : 0);
+    };
+
+    // one message per rotation
+    net.setPowerProfile (PowerProfile::balanced);
+
+    for (int n = 0; n < 3; ++n)
+    {
+        CHECK(send (n) && net.isRotationSent());
+        receive();
+    }
+
+    // pairs as bundle, the first of each is held
+    net.setPowerProfile (PowerProfile::longestBattery);
+
+    for (int n = 3; n < 8; ++n)
+    {
+        CHECK(send (n));
+        CHECK(net.isRotationSent() == (n % 2 == 0));
+
+        if (net.isRotationSent())
+            receive();
+    }
+
+    // held rotation sent on profile change
+    net.setPowerProfile (PowerProfile::lowLatency);
+    receive();
+
+    CHECK(net.isRotationSent());
+    CHECK((bundleSizes == std::vector<size_t> { 0, 0, 0, 2, 2, 1 }));
+    CHECK(received.size() == 8);
+
+    auto mismatches = 0;
+
+    for (size_t n = 0; n < received.size(); ++n)
+        mismatches += received[n].first != n / 16.0f || received[n].second != 1000 + n;
+
+    CHECK(mismatches == 0);
+
+    // send statistics per packet
+    const auto& stats = net.getSendStats (PowerProfile::longestBattery);
+    CHECK(stats.duration.getCount() == 2);
+
+    options.udp = false;
+    sim::setOptions (options);
+}
@@ -0,0 +1,249 @@
+/* imag_test_stats.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: streaming statistics against exact two-pass references
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+using namespace imag;
+
+// deterministic pseudo random samples
+struct Random
+{
+    uint32_t state = 38;
+
+    // uniform in 0..1, excluding 0
+    double uniform()
+    {
+        state = state * 1664525u + 1013904223u;
+        return (state + 1.0) / 4294967296.0;
+    }
+
+    // Box-Muller
+    double normal() { return std::sqrt (-2.0 * std::log (uniform())) * std::cos (2.0 * M_PI * uniform()); }
+
+    double exponential() { return -std::log (uniform()); }
+};
+
+// sample distributions, float as on the firmware
+std::vector<std::vector<float>> makeSamples (size_t n)
+{
+    Random random;
+    std::vector<std::vector<float>> sets (4);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        sets[0].push_back (float (random.normal()));
+        sets[1].push_back (float (100.0 + 10.0 * random.exponential())); // skewed, like a send duration [us]
+        sets[2].push_back (float (10000.0 + 50.0 * random.normal()));    // large offset, like a send interval with jitter [us]
+        sets[3].push_back (float (i));                                   // sorted input
+    }
+
+    return sets;
+}
+
+// fraction of samples below value
+double rankOf (const std::vector<float>& sorted, float value)
+{
+    return double (std::lower_bound (sorted.begin(), sorted.end(), value) - sorted.begin()) / sorted.size();
+}
+
+} // namespace
+
+
+// cumulative mean while count <= 1 / alpha, the exponential recursion from then on
+IMAG_TEST(expMeanMatchesExactMean)
+{
+    static constexpr size_t length = 99;
+
+    auto mean = stats::ExpMean<float>::fromLength (length);
+    CHECK(mean.get() == 0.0f && mean.getCount() == 0);
+
+    Random random;
+    const auto alpha = 2.0 / (length + 1);
+    double sum = 0.0, reference = 0.0;
+    double warmupError = 0.0, maxError = 0.0;
+
+    for (uint32_t count = 1; count <= 10000; ++count)
+    {
+        const auto value = 5.0f + float (random.normal());
+        mean.add (value);
+
+        if (count <= length / 2 + 1)
+        {
+            sum += value;
+            reference = sum / count;
+            warmupError = std::fmax (warmupError, std::fabs (mean.get() - reference));
+        }
+        else
+        {
+            reference += alpha * (value - reference);
+        }
+
+        maxError = std::fmax (maxError, std::fabs (mean.get() - reference));
+    }
+
+    CHECK(mean.getCount() == 10000);
+    CHECK_NEAR(warmupError, 0.0, 1e-5);
+    CHECK_NEAR(maxError, 0.0, 1e-5);
+
+    // a constant is kept exactly, no bias towards the initial state
+    mean.reset();
+
+    for (int i = 0; i < 10; ++i)
+        mean.add (3.25f);
+
+    CHECK(mean.get() == 3.25f);
+}
+
+
+// mean and population variance against two passes in double precision
+IMAG_TEST(welfordMatchesTwoPass)
+{
+    for (const auto& samples : makeSamples (100000))
+    {
+        stats::Welford<float> moments;
+        stats::MinMax<float> extremes;
+
+        for (const auto value : samples)
+        {
+            moments.add (value);
+            extremes.add (value);
+        }
+
+        double mean = 0.0, variance = 0.0;
+
+        for (const auto value : samples)
+            mean += value;
+
+        mean /= samples.size();
+
+        for (const auto value : samples)
+            variance += (value - mean) * (value - mean);
+
+        variance /= samples.size();
+
+        CHECK(moments.getCount() == samples.size());
+        CHECK_NEAR(moments.getMean(), mean, 1e-3 * std::sqrt (variance) + 1e-5 * std::fabs (mean));
+        CHECK_NEAR(moments.getVariance() / variance, 1.0, 1e-3);
+        CHECK_NEAR(moments.getStdDev(), std::sqrt (variance), 1e-3 * std::sqrt (variance));
+
+        CHECK(extremes.getMin() == *std::min_element (samples.begin(), samples.end()));
+        CHECK(extremes.getMax() == *std::max_element (samples.begin(), samples.end()));
+    }
+
+    // fewer than two samples have no variance
+    stats::Welford<float> moments;
+    CHECK(moments.getVariance() == 0.0f && moments.getMean() == 0.0f);
+    moments.add (7.0f);
+    CHECK(moments.getVariance() == 0.0f && moments.getMean() == 7.0f);
+
+    stats::MinMax<float> extremes;
+    CHECK(extremes.getRange() == 0.0f);
+}
+
+
+/* Integer summary of us timings against two passes in double precision:
+   mean and deviation exact to float rounding, also with a large offset
+   and a first value far off the others, extremes exact.
+*/
+IMAG_TEST(integerSummaryMatchesTwoPass)
+{
+    Random random;
+    std::vector<std::vector<uint32_t>> sets (4);
+
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        sets[0].push_back (uint32_t (100.0 + 10.0 * random.exponential()));        // send duration
+        sets[1].push_back (uint32_t (10000.0 + 50.0 * std::fabs (random.normal()))); // send interval with jitter
+        sets[2].push_back (i == 0 ? 5000000 : uint32_t (5000.0 + random.normal()));  // first interval after a pause
+        sets[3].push_back (i);                                                        // sorted input
+    }
+
+    for (const auto& samples : sets)
+    {
+        stats::IntegerSummary summary;
+
+        for (const auto value : samples)
+            summary.add (value);
+
+        double mean = 0.0, variance = 0.0;
+
+        for (const auto value : samples)
+            mean += value;
+
+        mean /= samples.size();
+
+        for (const auto value : samples)
+            variance += (value - mean) * (value - mean);
+
+        variance /= samples.size();
+
+        CHECK(summary.getCount() == samples.size());
+        CHECK_NEAR(summary.getMean() / mean, 1.0, 1e-6);
+        CHECK_NEAR(summary.getVariance() / variance, 1.0, 1e-6);
+        CHECK_NEAR(summary.getStdDev() / std::sqrt (variance), 1.0, 1e-6);
+        CHECK(summary.getMin() == *std::min_element (samples.begin(), samples.end()));
+        CHECK(summary.getMax() == *std::max_element (samples.begin(), samples.end()));
+    }
+
+    // empty and single values
+    stats::IntegerSummary summary;
+    CHECK(summary.getMin() == 0 && summary.getMax() == 0 && summary.getMean() == 0.0f);
+    summary.add (7);
+    CHECK(summary.getMean() == 7.0f && summary.getVariance() == 0.0f && summary.getMin() == 7);
+}
+
+
+/* P-square estimates of the median, p90 and p99: the fraction of
+   samples below the estimate is within 0.2 % of p, for unimodal, skewed
+   and sorted input. Exact (nearest rank) for the first five samples.
+*/
+IMAG_TEST(quantileMatchesSortedRank)
+{
+    double maxRankError = 0.0;
+
+    for (const auto& samples : makeSamples (100000))
+    {
+        auto sorted = samples;
+        std::sort (sorted.begin(), sorted.end());
+
+        for (const auto p : { 0.5f, 0.9f, 0.99f })
+        {
+            stats::Quantile<float> quantile (p);
+
+            for (const auto value : samples)
+                quantile.add (value);
+
+            CHECK(quantile.getCount() == samples.size());
+            maxRankError = std::fmax (maxRankError, std::fabs (rankOf (sorted, quantile.get()) - p));
+        }
+    }
+
+    CHECK_NEAR(maxRankError, 0.0, 0.002);
+
+    // nearest rank while fewer than five samples
+    stats::Quantile<float> median (0.5f);
+    CHECK(median.get() == 0.0f);
+
+    const float first[] { 4.0f, 1.0f, 3.0f, 2.0f, 5.0f };
+    const float expected[] { 4.0f, 4.0f, 3.0f, 3.0f, 3.0f };
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+        median.add (first[i]);
+        CHECK(median.get() == expected[i]);
+    }
+}
@@ -0,0 +1,174 @@
+/* imag_test_trig.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: lookup table trigonometry against libm
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_trig.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+using namespace imag;
+
+// Angle to radians in double precision
+double radians (trig::Angle angle)
+{
+    return angle * 2.0 * M_PI / trig::fullTurn;
+}
+
+// difference of two angles in Angle steps, wrapped to -halfTurn..halfTurn
+int angleSteps (trig::Angle a, trig::Angle b)
+{
+    return int16_t (uint16_t (a - b));
+}
+
+// exact angle of (x, y) in Angle steps, rounded
+trig::Angle exactAngle (double y, double x)
+{
+    return trig::Angle (int32_t (std::lround (std::atan2 (y, x) * trig::fullTurn / (2.0 * M_PI))));
+}
+
+// deterministic pseudo random numbers
+struct Random
+{
+    uint32_t state = 2024;
+
+    uint32_t next()
+    {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    }
+
+    // uniform in -1..1
+    double unit() { return int32_t (next()) / 2147483648.0; }
+};
+
+} // namespace
+
+
+// every angle, including the table ends (sin 90 deg, cos 0)
+IMAG_TEST(sinCosMatchLibm)
+{
+    static constexpr auto scale = 1.0 / (1 << trig::fracBits);
+    double maxError = 0.0;
+
+    for (uint32_t a = 0; a < trig::fullTurn; ++a)
+    {
+        const auto angle = trig::Angle (a);
+
+        maxError = std::fmax (maxError, std::fabs (trig::sin (angle) * scale - std::sin (radians (angle))));
+        maxError = std::fmax (maxError, std::fabs (trig::cos (angle) * scale - std::cos (radians (angle))));
+    }
+
+    CHECK_NEAR(maxError, 0.0, 5e-5);
+
+    // Q15 saturates just below 1
+    CHECK(trig::sin (trig::quarterTurn) == 32767);
+    CHECK(trig::cos (0) == 32767);
+    CHECK(trig::sin (trig::halfTurn + trig::quarterTurn) == -32767);
+    CHECK(trig::sin (0) == 0 && trig::sin (trig::halfTurn) == 0);
+}
+
+
+// directions all around, on the diagonals (table end), the axes and at extreme magnitudes
+IMAG_TEST(atan2MatchesLibm)
+{
+    auto maxSteps = 0;
+
+    auto check = [&maxSteps] (int32_t y, int32_t x)
+    {
+        maxSteps = std::max (maxSteps, std::abs (angleSteps (trig::atan2 (y, x), exactAngle (y, x))));
+    };
+
+    for (uint32_t a = 0; a < trig::fullTurn; a += 7)
+    {
+        for (const auto radius : { 100.0, 30000.0, 1073741824.0, 2147483000.0 })
+            check (int32_t (std::lround (radius * std::sin (radians (a)))), int32_t (std::lround (radius * std::cos (radians (a)))));
+    }
+
+    for (const auto v : { 1, 3, 16384, 1 << 30, INT32_MAX })
+    {
+        check (v, v);
+        check (v, -v);
+        check (-v, v);
+        check (-v, -v);
+        check (v, 0);
+        check (0, v);
+        check (-v, 0);
+        check (0, -v);
+    }
+
+    check (INT32_MIN, INT32_MIN);
+    check (INT32_MIN, 1);
+
+    CHECK(maxSteps <= 2);
+    CHECK(trig::atan2 (0, 0) == 0);
+    CHECK(trig::atan2 (5, 5) == trig::fromDegrees (45.0));
+}
+
+
+// integer square root, always the floor of the exact length
+IMAG_TEST(hypotIsExactFloor)
+{
+    Random random;
+    auto mismatches = 0;
+
+    auto check = [&mismatches] (int32_t x, int32_t y)
+    {
+        const auto square = (long double) x * x + (long double) y * y;
+        const auto root = trig::hypot (x, y);
+
+        mismatches += ! ((long double) root * root <= square && ((long double) root + 1) * (root + 1) > square);
+    };
+
+    for (int i = 0; i < 100000; ++i)
+        check (int32_t (random.next()), int32_t (random.next()) >> (random.next() & 31));
+
+    for (const auto v : { 0, 1, -1, 46340, 46341, INT32_MAX, INT32_MIN })
+    {
+        check (v, 0);
+        check (v, v);
+        check (v, INT32_MIN);
+    }
+
+    CHECK(mismatches == 0);
+    CHECK(trig::hypot (3, 4) == 5);
+}
+
+
+// yaw of random rotations, same as EulerAngles (q).yaw in double precision
+IMAG_TEST(yawMatchesEulerAngles)
+{
+    Random random;
+    auto maxSteps = 0;
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        double w = random.unit(), x = random.unit(), y = random.unit(), z = random.unit();
+        const auto norm = std::sqrt (w * w + x * x + y * y + z * z);
+
+        if (norm < 1e-3)
+            continue;
+
+        w /= norm, x /= norm, y /= norm, z /= norm;
+
+        const auto q = FixedQuaternion::fromQuaternion (Quaternion (float (w), float (x), float (y), float (z)));
+        const auto expected = exactAngle (2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z));
+
+        maxSteps = std::max (maxSteps, std::abs (angleSteps (trig::yaw (q), expected)));
+    }
+
+    CHECK(maxSteps <= 2);
+
+    // quarter turns around z
+    const auto quarter = FixedQuaternion::fromQuaternion (Quaternion (M_SQRT1_2, 0.0f, 0.0f, M_SQRT1_2));
+    CHECK(std::abs (angleSteps (trig::yaw (quarter), trig::quarterTurn)) <= 1);
+    CHECK(trig::yaw (FixedQuaternion {}) == 0);
+}
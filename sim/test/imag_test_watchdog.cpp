@@ -0,0 +1,111 @@
+/* imag_test_watchdog.cpp
+ * 
+ * imagination sensor firmware
+ * host tests: sensor stall watchdog on a fake millisecond clock
+ * 
+ * 2024 rumori
+ */
+
+#include "imag_test.h"
+
+#include "imag_config.h"
+#include "imag_imu_watchdog.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using imag::imu::Watchdog;
+using Action = Watchdog::Action;
+using Imu = imag::config::Imu;
+
+// checks every ms from begin to end, excluding, actions taken with their time
+std::vector<std::pair<uint32_t, Action>> step (Watchdog& watchdog, uint32_t begin, uint32_t end)
+{
+    std::vector<std::pair<uint32_t, Action>> actions;
+
+    for (auto now = begin; now != end; ++now)
+    {
+        const auto action = watchdog.check (now);
+
+        if (action != Action::none)
+            actions.emplace_back (now, action);
+    }
+
+    return actions;
+}
+
+} // namespace
+
+
+// nothing happens before the first sample, however long it takes
+IMAG_TEST(watchdogIdleBeforeFirstFeed)
+{
+    Watchdog watchdog;
+
+    CHECK(step (watchdog, 0, 10 * (Imu::stallTimeout + Imu::recoveryInterval)).empty());
+    CHECK(! watchdog.isStalled());
+    CHECK(watchdog.getStalls() == 0 && watchdog.getReinits() == 0 && watchdog.getResets() == 0);
+}
+
+
+/* Samples within stallTimeout keep it quiet. Without samples it
+   re-enables the reports at stallTimeout, then resets the sensor every
+   recoveryInterval. A sample ends the stall, recovery times count from
+   detection. Started shortly before the millis() wrap around.
+*/
+IMAG_TEST(watchdogReinitThenResetsUntilFed)
+{
+    static constexpr uint32_t start = UINT32_MAX - 500;
+
+    Watchdog watchdog;
+    watchdog.feed (start);
+
+    // regular samples, just inside the timeout
+    auto now = start;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        CHECK(step (watchdog, now, now + Imu::stallTimeout).empty());
+        now += Imu::stallTimeout - 1;
+        watchdog.feed (now);
+    }
+
+    CHECK(watchdog.getStalls() == 0);
+
+    // samples stop: reinit at the timeout, three resets an interval apart
+    const auto detected = now + Imu::stallTimeout;
+    const auto actions = step (watchdog, now, detected + 3 * Imu::recoveryInterval + Imu::recoveryInterval / 2);
+
+    const std::vector<std::pair<uint32_t, Action>> expected {
+        { detected, Action::reinit },
+        { detected + Imu::recoveryInterval, Action::reset },
+        { detected + 2 * Imu::recoveryInterval, Action::reset },
+        { detected + 3 * Imu::recoveryInterval, Action::reset },
+    };
+
+    CHECK(actions == expected);
+    CHECK(watchdog.isStalled());
+    CHECK(watchdog.getStalls() == 1 && watchdog.getReinits() == 1 && watchdog.getResets() == 3);
+    CHECK(watchdog.getLastRecovery() == 0 && watchdog.getMaxRecovery() == 0);
+
+    // back after the third reset
+    const auto firstRecovery = 3 * Imu::recoveryInterval + 200;
+    now = detected + firstRecovery;
+    watchdog.feed (now);
+
+    CHECK(! watchdog.isStalled());
+    CHECK(watchdog.getLastRecovery() == firstRecovery && watchdog.getMaxRecovery() == firstRecovery);
+    CHECK(step (watchdog, now, now + Imu::stallTimeout).empty());
+
+    // a second, shorter stall ends after the reinit alone
+    now += Imu::stallTimeout;
+    CHECK(watchdog.check (now) == Action::reinit);
+    CHECK(step (watchdog, now + 1, now + 50).empty());
+    watchdog.feed (now + 50);
+
+    CHECK(watchdog.getStalls() == 2 && watchdog.getReinits() == 2 && watchdog.getResets() == 3);
+    CHECK(watchdog.getLastRecovery() == 50 && watchdog.getMaxRecovery() == firstRecovery);
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""imag_capture.py
+
+imagination sensor firmware
+host tool for binary sensor report captures (see imag_capture.h)
+
+  record  PORT FILE        store capture stream from usb serial port
+  inspect FILE [--dump]    print statistics or all frames
+  replay  FILE [--speed S] send rotation reports as osc /rot via udp
+  export  FILE OUT.cpp     generate trace source for the replay imu backend
+
+2024 rumori
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+from collections import Counter, defaultdict
+
+SYNC = 0xA5
+KIND_START, KIND_REPORT, KIND_LOOP = 0x01, 0x02, 0x03
+
+# sh2 report ids, see imag::imu::DataType
+ROTATION_IDS = {0x05: "rotation", 0x08: "rotationGame", 0x09: "rotationGeo",
+                0x28: "rotationArvr", 0x29: "rotationGameArvr"}
+VECTOR_IDS = {0x01: "accel", 0x02: "gyro", 0x03: "mag", 0x04: "linearAccel", 0x06: "gravity"}
+
+
+def frames(data):
+    """yield (kind, payload) for each valid frame, resyncing on errors"""
+    i, n = 0, len(data)
+    while i + 4 <= n:
+        if data[i] != SYNC:
+            i += 1
+            continue
+        kind, length = data[i + 1], data[i + 2]
+        end = i + 3 + length
+        if end >= n:
+            break
+        payload = data[i + 3:end]
+        if (kind + length + sum(payload)) & 0xFF != data[end]:
+            yield None, None  # checksum error
+            i += 1
+            continue
+        yield kind, payload
+        i = end + 1
+
+
+def decode(data):
+    """decode capture into report and loop dicts"""
+    reports, loops, errors, version = [], [], 0, None
+    for kind, payload in frames(data):
+        if kind is None:
+            errors += 1
+        elif kind == KIND_START and payload[:7] == b"IMAGCAP":
+            version = payload[7]
+        elif kind == KIND_REPORT:
+            sensor_id, seq, status, _, sensor_ts, host_ts = struct.unpack_from("<BBBBII", payload)
+            values = payload[12:]
+            if sensor_id in ROTATION_IDS:
+                values = struct.unpack("<5f", values)
+            elif sensor_id in VECTOR_IDS:
+                values = struct.unpack("<3f", values)
+            reports.append(dict(id=sensor_id, seq=seq, status=status,
+                                sensor_ts=sensor_ts, host_ts=host_ts, values=values))
+        elif kind == KIND_LOOP:
+            start, duration, count, dropped = struct.unpack("<IIHH", payload)
+            loops.append(dict(start=start, duration=duration, reports=count, dropped=dropped))
+    return version, reports, loops, errors
+
+
+def type_name(sensor_id):
+    return ROTATION_IDS.get(sensor_id) or VECTOR_IDS.get(sensor_id) or f"0x{sensor_id:02x}"
+
+
+def cmd_record(args):
+    try:
+        import serial  # pyserial
+        port = serial.Serial(args.port, 115200, timeout=0.1)
+        read = lambda: port.read(4096)
+    except ImportError:
+        port = open(args.port, "rb", buffering=0)
+        read = lambda: port.read(4096)
+    with open(args.file, "wb") as out:
+        print(f"recording {args.port} to {args.file}, ctrl-c to stop", file=sys.stderr)
+        try:
+            while True:
+                out.write(read())
+        except KeyboardInterrupt:
+            pass
+
+
+def cmd_inspect(args):
+    version, reports, loops, errors = decode(open(args.file, "rb").read())
+    if args.dump:
+        for r in reports:
+            print(f"{r['host_ts']:>10} {r['sensor_ts']:>10} {type_name(r['id']):<16} "
+                  f"seq {r['seq']:>3} status {r['status'] & 3} {r['values']}")
+        for l in loops:
+            print(f"loop {l['start']:>10} {l['duration']:>6} us reports {l['reports']} dropped {l['dropped']}")
+        return
+
+    print(f"capture version {version}, {len(reports)} reports, {len(loops)} loops, {errors} checksum errors")
+
+    by_id = defaultdict(list)
+    for r in reports:
+        by_id[r["id"]].append(r)
+    for sensor_id, rs in sorted(by_id.items()):
+        gaps = sum((b["seq"] - a["seq"]) % 256 - 1 for a, b in zip(rs, rs[1:]))
+        span = (rs[-1]["sensor_ts"] - rs[0]["sensor_ts"]) * 1e-6
+        rate = (len(rs) - 1) / span if span > 0 else 0.0
+        print(f"  {type_name(sensor_id):<16} {len(rs):>7} reports {rate:8.1f} Hz, {gaps} sequence gaps")
+
+    if loops:
+        durations = sorted(l["duration"] for l in loops)
+        mean = sum(durations) / len(durations)
+        p99 = durations[min(len(durations) - 1, int(0.99 * len(durations)))]
+        print(f"  loop duration us: min {durations[0]} mean {mean:.0f} p99 {p99} max {durations[-1]}, "
+              f"frames dropped {loops[-1]['dropped']}")
+        print(f"  reports per loop: {dict(sorted(Counter(l['reports'] for l in loops).items()))}")
+
+
+def osc_message(address, *floats):
+    def pad(b):
+        return b + b"\0" * (4 - len(b) % 4)
+    return pad(address.encode()) + pad(b"," + b"f" * len(floats)) + struct.pack(f">{len(floats)}f", *floats)
+
+
+def cmd_replay(args):
+    _, reports, _, _ = decode(open(args.file, "rb").read())
+    rotations = [r for r in reports if r["id"] in ROTATION_IDS]
+    if not rotations:
+        sys.exit("no rotation reports in capture")
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    target = (args.host, args.port)
+    t0, start = rotations[0]["sensor_ts"], time.monotonic()
+
+    for r in rotations:
+        due = start + (r["sensor_ts"] - t0) * 1e-6 / args.speed
+        delay = due - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        i, j, k, real, _ = r["values"]
+        sock.sendto(osc_message("/rot", i, j, k, real), target)
+
+    print(f"replayed {len(rotations)} rotation reports to {args.host}:{args.port}", file=sys.stderr)
+
+
+def cmd_export(args):
+    _, reports, _, _ = decode(open(args.file, "rb").read())
+    reports = [r for r in reports if r["id"] in ROTATION_IDS or r["id"] in VECTOR_IDS]
+    if not reports:
+        sys.exit("no supported reports in capture")
+
+    t0 = reports[0]["sensor_ts"]
+    with open(args.out, "w") as out:
+        out.write(f"// generated by tools/imag_capture.py from {args.file}\n\n")
+        out.write('#include "imag_imu_replay.h"\n\nnamespace imag::imu\n{\n')
+        out.write("const TraceRecord replayTrace[] {\n")
+        for r in reports:
+            if r["id"] in ROTATION_IDS:
+                i, j, k, real, _ = r["values"]
+                values = (real, i, j, k)
+            else:
+                values = (*r["values"], 0.0)
+            floats = ", ".join(f"{v:.8e}f" for v in values)
+            out.write(f"    {{ {(r['sensor_ts'] - t0) & 0xFFFFFFFF}, 0x{r['id']:02x}, {{ {floats} }} }},\n")
+        out.write("};\n\nconst size_t replayTraceSize = sizeof (replayTrace) / sizeof (replayTrace[0]);\n")
+        out.write("} // namespace imag::imu\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("record")
+    p.add_argument("port")
+    p.add_argument("file")
+    p.set_defaults(func=cmd_record)
+
+    p = sub.add_parser("inspect")
+    p.add_argument("file")
+    p.add_argument("--dump", action="store_true", help="print all frames")
+    p.set_defaults(func=cmd_inspect)
+
+    p = sub.add_parser("replay")
+    p.add_argument("file")
+    p.add_argument("--speed", type=float, default=1.0, help="replay speed factor")
+    p.add_argument("--host", default="127.0.0.1")
+    p.add_argument("--port", type=int, default=9336)
+    p.set_defaults(func=cmd_replay)
+
+    p = sub.add_parser("export")
+    p.add_argument("file")
+    p.add_argument("out")
+    p.set_defaults(func=cmd_export)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""imag_log.py
+
+imagination sensor firmware
+host decoder for binary debug log records (see imag_log.h)
+
+  decode ELF FILE          format records stored in FILE
+  monitor ELF PORT         format records received from usb serial port (needs pyserial)
+
+ELF is the firmware elf file of the running build, string literals are
+resolved from it. Set config::Log::binary in imag_config.h to send records.
+
+2024 rumori
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = 0xD7
+KIND_NEWLINE, KIND_LITERAL, KIND_TEXT, KIND_SINT, KIND_UINT, KIND_REAL, KIND_HEX, KIND_DROPPED = range(8)
+NEWLINE_BIT, TIMESTAMP_BIT, LEVEL_SHIFT = 0x10, 0x80, 5
+
+# see imag::log::Module and imag::config::Log::Level
+MODULES = ("main", "imu", "net", "display", "battery", "midi", "power")
+LEVELS = ("error: ", "warning: ", "info: ", "")
+
+
+class Elf:
+    """string lookup in the allocated sections of a 32-bit little endian elf file"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            sys.exit(f"{path}: not a 32-bit little endian elf file")
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.data = data
+        self.sections = []
+        for i in range(shnum):
+            _, kind, flags, addr, offset, size = struct.unpack_from("<IIIIII", data, shoff + i * shentsize)
+            if kind == 1 and flags & 0x2:  # progbits, alloc
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b"\0", start, offset + size)
+                return self.data[start:end].decode("latin-1")
+        return f"<literal 0x{address:08x}>"
+
+
+def payload_size(kind, data, at):
+    if kind == KIND_NEWLINE:
+        return 0
+    if kind == KIND_TEXT:
+        return 1 + data[at] if at < len(data) else None
+    if kind == KIND_DROPPED:
+        return 2
+    return 4
+
+
+def records(data):
+    """yield (header, module, timestamp, payload) per record, return unconsumed rest"""
+    i, n = 0, len(data)
+    while i + 3 <= n:
+        header, module = data[i + 1], data[i + 2]
+        kind = header & 0x0F
+        if data[i] != SYNC or kind > KIND_DROPPED or module >= len(MODULES):
+            i += 1  # resync
+            continue
+        at = i + 3 + (4 if header & TIMESTAMP_BIT else 0)
+        size = payload_size(kind, data, at)
+        if size is None or at + size > n:
+            break
+        stamp = struct.unpack_from("<I", data, i + 3)[0] if header & TIMESTAMP_BIT else None
+        yield header, module, stamp, data[at:at + size]
+        i = at + size
+    return data[i:]
+
+
+def format_record(elf, header, module, stamp, payload):
+    """text of one record, as formatted on the sensor in text mode"""
+    text = ""
+    if stamp is not None:
+        text = f"{stamp // 1000}.{stamp % 1000:03} {MODULES[module]}: {LEVELS[header >> LEVEL_SHIFT & 0x03]}"
+    kind = header & 0x0F
+    if kind == KIND_LITERAL:
+        text += elf.string(struct.unpack("<I", payload)[0])
+    elif kind == KIND_TEXT:
+        text += payload[1:].decode("latin-1")
+    elif kind == KIND_SINT:
+        text += str(struct.unpack("<i", payload)[0])
+    elif kind == KIND_UINT:
+        text += str(struct.unpack("<I", payload)[0])
+    elif kind == KIND_REAL:
+        text += f"{struct.unpack('<f', payload)[0]:.2f}"
+    elif kind == KIND_HEX:
+        text += f"{struct.unpack('<I', payload)[0]:X}"
+    elif kind == KIND_DROPPED:
+        text += f"<{struct.unpack('<H', payload)[0]} log records dropped>"
+    if header & NEWLINE_BIT:
+        text += "\n"
+    return text
+
+
+def decode(elf, data):
+    """format all records, return unconsumed rest of data"""
+    gen = records(data)
+    while True:
+        try:
+            sys.stdout.write(format_record(elf, *next(gen)))
+        except StopIteration as stop:
+            sys.stdout.flush()
+            return stop.value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("decode")
+    p.add_argument("elf")
+    p.add_argument("file")
+    p = sub.add_parser("monitor")
+    p.add_argument("elf")
+    p.add_argument("port")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+
+    if args.command == "decode":
+        with open(args.file, "rb") as f:
+            decode(elf, f.read())
+    elif args.command == "monitor":
+        import serial  # pyserial
+        port = serial.Serial(args.port, 115200, timeout=0.1)
+        rest = b""
+        try:
+            while True:
+                rest = decode(elf, rest + port.read(4096))
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()
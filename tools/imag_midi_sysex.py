@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""imag_midi_sysex.py
+
+imagination sensor firmware
+host encoder/decoder for the sysex rotation format (see imag_midi_usb.h)
+
+  decode HEX...          decode sysex message(s) given as hex bytes
+  encode W X Y Z [DEV]   print sysex message for a quaternion
+  log FILE               decode the usb midi packets logged by imag_sim --midi
+  monitor [PORT]         print rotations received on a midi input (needs mido)
+
+2024 rumori
+"""
+
+import argparse
+import sys
+
+MANUFACTURER, TAG = 0x7D, 0x49
+BITS = 21
+MAX_VALUE = (1 << BITS) - 1
+LENGTH = 4 + 4 * 3 + 1
+
+
+def encode(quat, device=0):
+    """sysex bytes for quaternion (w, x, y, z), same rounding as the firmware"""
+    msg = [0xF0, MANUFACTURER, TAG, device & 0x7F]
+    for c in quat:
+        fixed = int(c * (1 << 30))  # Q30 as on the sensor
+        value = min(max(fixed + (1 << 30), 0) >> (31 - BITS), MAX_VALUE)
+        msg += [value >> 14 & 0x7F, value >> 7 & 0x7F, value & 0x7F]
+    return bytes(msg + [0xF7])
+
+
+def decode(msg):
+    """(device, (w, x, y, z)) of a sysex message, None if not a rotation message"""
+    msg = bytes(msg)
+    if len(msg) != LENGTH or msg[0] != 0xF0 or msg[-1] != 0xF7 or msg[1:3] != bytes((MANUFACTURER, TAG)):
+        return None
+    quat = []
+    for i in range(4, 16, 3):
+        value = msg[i] << 14 | msg[i + 1] << 7 | msg[i + 2]
+        quat.append(value / (1 << (BITS - 1)) - 1.0)
+    return msg[3], tuple(quat)
+
+
+def from_packets(packets):
+    """sysex messages of usb midi event packets (4 bytes each), other packets are skipped"""
+    message = []
+    for packet in packets:
+        cin = packet[0] & 0x0F
+        if cin == 0x04:  # sysex starts or continues
+            message += packet[1:4]
+        elif 0x05 <= cin <= 0x07:  # sysex ends with 1, 2 or 3 bytes
+            yield bytes(message + list(packet[1:cin - 3]))
+            message = []
+
+
+def read_log(lines):
+    """usb midi event packets of an imag_sim --midi log: time [s] and 4 hex bytes per line"""
+    for line in lines:
+        fields = line.split()
+        if len(fields) == 5:
+            yield bytes(int(field, 16) for field in fields[1:])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("decode")
+    p.add_argument("hex", nargs="+")
+    p = sub.add_parser("encode")
+    p.add_argument("quat", nargs=4, type=float)
+    p.add_argument("--device", type=int, default=0)
+    p = sub.add_parser("log")
+    p.add_argument("file")
+    p = sub.add_parser("monitor")
+    p.add_argument("port", nargs="?")
+    args = parser.parse_args()
+
+    if args.command == "decode":
+        res = decode(bytes.fromhex("".join(args.hex)))
+        if res is None:
+            sys.exit("not a rotation sysex message")
+        print("device %d: w %+.6f x %+.6f y %+.6f z %+.6f" % (res[0], *res[1]))
+
+    elif args.command == "encode":
+        print(encode(args.quat, args.device).hex(" "))
+
+    elif args.command == "log":
+        with open(args.file) as file:
+            for msg in from_packets(read_log(file)):
+                res = decode(msg)
+                if res is not None:
+                    print("device %d: w %+.6f x %+.6f y %+.6f z %+.6f" % (res[0], *res[1]))
+
+    elif args.command == "monitor":
+        try:
+            import mido
+        except ImportError:
+            sys.exit("monitor needs mido (pip install mido python-rtmidi)")
+        with mido.open_input(args.port) as port:
+            for message in port:
+                if message.type != "sysex":
+                    continue
+                res = decode([0xF0, *message.data, 0xF7])
+                if res is not None:
+                    print("device %d: w %+.6f x %+.6f y %+.6f z %+.6f" % (res[0], *res[1]), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""imag_sync.py
+
+imagination sensor firmware
+host side of the clock synchronisation (see imag_clock_sync.h)
+
+Pings the sensor with /sync, so it can estimate offset and drift of its
+clock against the host clock, and reports every interval:
+
+  round trip      min and median of the exchanges [ms]
+  latency         one-way latency estimate, half the minimum round trip [ms]
+  offset          sensor minus host clock of the fastest exchange [s]
+  drift           change of that offset over the run [ppm]
+  sync error      sensor's host time of its reply minus the host's estimate [ms]
+  sample latency  /rot arrival minus its timetag, i.e. sample read to arrival [ms]
+
+The sensor sends to its configured target, so run this there (by default
+192.168.1.100, port 9336).
+
+2024 rumori
+"""
+
+import argparse
+import socket
+import statistics
+import struct
+import time
+
+NTP_EPOCH = 2208988800  # 1900 to 1970 [s]
+
+
+def now_timetag():
+    ns = time.time_ns() + NTP_EPOCH * 1_000_000_000
+    return (ns // 1_000_000_000) << 32 | (ns % 1_000_000_000 << 32) // 1_000_000_000
+
+
+def timetag_seconds(timetag):
+    return (timetag >> 32) + (timetag & 0xFFFFFFFF) / 2 ** 32
+
+
+def pad(b):
+    return b + b"\0" * (4 - len(b) % 4)
+
+
+def osc_message(address, *timetags):
+    return pad(address.encode()) + pad(b"," + b"t" * len(timetags)) + b"".join(struct.pack(">Q", t) for t in timetags)
+
+
+def parse_osc(data):
+    """(address, [args]) of floats, ints, timetags and strings, None if malformed"""
+    try:
+        end = data.index(b"\0")
+        address = data[:end].decode()
+        i = (end + 4) & ~3
+        end = data.index(b"\0", i)
+        tags = data[i + 1:end].decode()
+        i = (end + 4) & ~3
+        args = []
+        for tag in tags:
+            if tag == "f":
+                args.append(struct.unpack_from(">f", data, i)[0])
+                i += 4
+            elif tag == "i":
+                args.append(struct.unpack_from(">i", data, i)[0])
+                i += 4
+            elif tag == "t":
+                args.append(struct.unpack_from(">Q", data, i)[0])
+                i += 8
+            elif tag == "s":
+                end = data.index(b"\0", i)
+                args.append(data[i:end].decode())
+                i = (end + 4) & ~3
+            else:
+                return None
+        return address, args
+    except (ValueError, struct.error, UnicodeDecodeError):
+        return None
+
+
+def parse_packet(data):
+    """messages of a packet, the elements of a bundle in order, malformed ones skipped"""
+    if not data.startswith(b"#bundle\0"):
+        msg = parse_osc(data)
+        return [msg] if msg else []
+    messages, i = [], 16
+    while i + 4 <= len(data):
+        size = struct.unpack_from(">i", data, i)[0]
+        messages += parse_packet(data[i + 4:i + 4 + size])
+        i += 4 + size
+    return messages
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="192.168.1.1", help="sensor address")
+    parser.add_argument("--port", type=int, default=9336, help="sensor port")
+    parser.add_argument("--listen", type=int, default=9336, help="local port the sensor sends to")
+    parser.add_argument("--rate", type=float, default=10.0, help="pings per second")
+    parser.add_argument("--interval", type=float, default=5.0, help="report interval [s]")
+    parser.add_argument("--seconds", type=float, default=0.0, help="run time [s], 0 runs until interrupted")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.listen))
+    sock.settimeout(0.01)
+    target = (args.host, args.port)
+
+    # last ping sent (t1), previous ping whose reply arrived (t1, t4), as timetags
+    pending, previous = None, None
+    round_trips, errors, latencies = [], [], []
+
+    # fastest exchange of each interval: (host time, offset)
+    fastest, history = None, []
+    start = time.monotonic()
+    next_ping, next_report = start, start + args.interval
+
+    try:
+        while args.seconds <= 0 or time.monotonic() - start < args.seconds:
+            now = time.monotonic()
+
+            if now >= next_ping:
+                t1 = now_timetag()
+                sock.sendto(osc_message("/sync", t1, *previous) if previous else osc_message("/sync", t1), target)
+                pending, previous = t1, None
+                next_ping += 1.0 / args.rate
+
+            if now >= next_report:
+                if fastest:
+                    history.append(fastest[:2])
+                report(round_trips, errors, latencies, history)
+                round_trips, errors, latencies, fastest = [], [], [], None
+                next_report += args.interval
+
+            try:
+                data = sock.recv(1024)
+            except socket.timeout:
+                continue
+
+            t4 = now_timetag()
+
+            for address, values in parse_packet(data):
+                if address == "/sync" and len(values) >= 3 and values[0] == pending:
+                    t1, t2, t3 = (timetag_seconds(v) for v in values[:3])
+                    host_receive = timetag_seconds(t4)
+                    round_trip = (host_receive - t1) - (t3 - t2)
+                    offset = ((t2 - t1) + (t3 - host_receive)) / 2
+                    round_trips.append(round_trip)
+                    pending, previous = None, (values[0], t4)
+                    if not fastest or round_trip < fastest[2]:
+                        fastest = (host_receive, offset, round_trip)
+                    if len(values) >= 4:
+                        errors.append(timetag_seconds(values[3]) - (host_receive - round_trip / 2))
+
+                elif address == "/rot" and len(values) >= 5 and isinstance(values[4], int):
+                    latencies.append(timetag_seconds(t4) - timetag_seconds(values[4]))
+    except KeyboardInterrupt:
+        pass
+
+    if fastest:
+        history.append(fastest[:2])
+    report(round_trips, errors, latencies, history)
+
+
+def report(round_trips, errors, latencies, history):
+    if not round_trips:
+        print("no /sync replies", flush=True)
+        return
+
+    ms = 1000.0
+    line = (f"round trip ms min {min(round_trips) * ms:.2f} median {statistics.median(round_trips) * ms:.2f}, "
+            f"latency ms {min(round_trips) / 2 * ms:.2f}, offset s {history[-1][1]:+.6f}")
+
+    if len(history) >= 2 and history[-1][0] - history[0][0] >= 10.0:
+        drift = (history[-1][1] - history[0][1]) / (history[-1][0] - history[0][0])
+        line += f", drift ppm {drift * 1e6:+.2f}"
+
+    if errors:
+        line += (f", sync error ms median {statistics.median(errors) * ms:+.3f} "
+                 f"max {max(errors, key=abs) * ms:+.3f}")
+    else:
+        line += ", sensor not synchronised"
+
+    if latencies:
+        line += f", sample latency ms median {statistics.median(latencies) * ms:.2f} ({len(latencies)} samples)"
+
+    print(line, flush=True)
+
+
+if __name__ == "__main__":
+    main()